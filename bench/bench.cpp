@@ -0,0 +1,478 @@
+#include "vkdev/assetloader.h"
+#include "vkdev/commandpool.h"
+#include "vkdev/demoscene.h"
+#include "vkdev/device.h"
+#include "vkdev/framepacer.h"
+#include "vkdev/instance.h"
+#include "vkdev/jobsystem.h"
+#include "vkdev/querypool.h"
+#include "vkdev/rendercommand.h"
+#include "vkdev/rendertarget.h"
+#include "vkdev/swapchain.h"
+#include "vkdev/uploadmanager.h"
+
+#include <glm/glm.hpp>
+
+#include <nlohmann/json.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <string.h>
+
+constexpr uint32_t WIDTH = 800;
+constexpr uint32_t HEIGHT = 600;
+
+struct BenchmarkOptions {
+    uint32_t frameCount = 1000;
+    uint32_t warmupFrameCount = 50;
+    uint32_t framesInFlight = vkdev::SwapChain::DEFAULT_FRAMES_IN_FLIGHT;
+    double targetFps = 0.0; // 0 renders uncapped
+    std::string outputPath = "bench_output.json";
+    std::string modelPath = "models/chalet.model";
+    std::string texturePath = "textures/chalet.jpg";
+    uint32_t gpuInstanceCount = 0; // instances culled and drawn by the GPU, 0 disables GPU culling
+    uint32_t instanceCount = 0; // instances drawn with hardware instancing, 0 draws a single instance culled on the CPU
+    uint32_t drawCount = 0; // copies of the mesh drawn as separate packets, used to measure command recording
+    uint32_t assetCopyCount = 0; // extra copies of the texture and mesh loaded at startup, used to measure asset loading
+    uint32_t textureBudget = 0; // megabytes the streamed texture may use, 0 loads the whole texture up front
+    uint32_t streamUploadLimit = 4096; // kilobytes of texture data staged for streaming each frame
+    uint32_t threadCount = 0; // threads running jobs, including the main thread.  0 uses the hardware concurrency
+    bool pinThreads = false;
+    uint32_t recordThreadCount = 0; // maximum number of ranges a frame is split into for recording, 0 makes one for each job thread
+    bool enableValidation = false;
+};
+
+using Clock = std::chrono::high_resolution_clock;
+
+inline double millisecondsBetween(Clock::time_point start, Clock::time_point end) {
+    return std::chrono::duration<double, std::chrono::milliseconds::period>(end - start).count();
+}
+
+// nearest rank percentile of an already sorted sample set
+double percentile(const std::vector<double>& sortedSamples, double p) {
+    if (sortedSamples.empty()) {
+        return 0.0;
+    }
+
+    size_t rank = static_cast<size_t>(std::ceil(p / 100.0 * sortedSamples.size()));
+    rank = std::clamp<size_t>(rank, 1, sortedSamples.size());
+
+    return sortedSamples[rank - 1];
+}
+
+/**
+Renders the chalet scene into an offscreen target and records CPU frame times.
+The scene is the same vkdev::DemoScene drawn by vulkantest, with every init phase timed individually.
+*/
+class BenchmarkApplication {
+public:
+    explicit BenchmarkApplication(const BenchmarkOptions& options_) : options(options_) {}
+
+    void run() {
+        init();
+        renderFrames();
+        cleanup();
+        writeResults();
+    }
+
+private:
+    void timePhase(const std::string& name, const std::function<void()>& phase) {
+        auto start = Clock::now();
+        phase();
+        phaseTimes.emplace_back(name, millisecondsBetween(start, Clock::now()));
+    }
+
+    void init() {
+        timePhase("job_system", [this]() {
+            jobSystem.create(options.threadCount, options.pinThreads);
+            jobThreadCount = jobSystem.getThreadCount();
+        });
+
+        timePhase("instance", [this]() {
+            instance.create(options.enableValidation, true);
+        });
+
+        timePhase("device", [this]() {
+            device = std::make_unique<vkdev::Device>(instance);
+            device->create({});
+        });
+
+        timePhase("command_pool", [this]() {
+            commandPool = std::make_unique<vkdev::CommandPool>(*device, device->graphicsQueue);
+            commandPool->create();
+
+            timestamps = std::make_unique<vkdev::TimestampQueryPool>(*device);
+            timestamps->create(*commandPool, options.framesInFlight, 4);
+            commandPool->timestamps = timestamps.get();
+
+            uploadManager = std::make_unique<vkdev::UploadManager>(*device);
+            uploadManager->create();
+            uploadManager->timestamps = timestamps.get();
+        });
+
+        timePhase("render_target", [this]() {
+            renderTarget = std::make_unique<vkdev::OffscreenRenderTarget>(*device);
+            renderTarget->msaaSampleCount = std::min(VK_SAMPLE_COUNT_4_BIT, device->getMaxSupportedSampleCount());
+            renderTarget->create({ WIDTH, HEIGHT }, VK_FORMAT_B8G8R8A8_UNORM, options.framesInFlight);
+        });
+
+        timePhase("load_assets", [this]() {
+            loadAssets();
+        });
+
+        memoryAfterInit = device->memory->toJson();
+
+        timePhase("pipeline", [this]() {
+            scene->createPipeline(*renderTarget);
+        });
+
+        timePhase("descriptor", [this]() {
+            scene->createDescriptor();
+        });
+
+        if (options.instanceCount > 0) {
+            timePhase("instances", [this]() {
+                scene->createInstanceBatcher();
+            });
+        }
+
+        timePhase("render_queues", [this]() {
+            scene->createRenderQueues();
+        });
+
+        timePhase("command_buffers", [this]() {
+            renderCommand = std::make_unique<vkdev::RenderCommand>(*device, device->graphicsQueue);
+            renderCommand->jobSystem = &jobSystem;
+            renderCommand->threadCount = options.recordThreadCount;
+            renderCommand->create(*renderTarget, options.framesInFlight, timestamps.get());
+        });
+
+        timePhase("sync_objects", [this]() {
+            renderTarget->createSyncObjects();
+        });
+    }
+
+    void loadAssets() {
+        scene = std::make_unique<vkdev::DemoScene>(*device, *uploadManager, jobSystem);
+        scene->modelPath = options.modelPath;
+        scene->texturePath = options.texturePath;
+        scene->framesInFlight = options.framesInFlight;
+        scene->gpuInstanceCount = options.gpuInstanceCount;
+        scene->instanceCount = options.instanceCount;
+        scene->drawCount = options.drawCount;
+        scene->textureBudget = options.textureBudget;
+        scene->streamUploadLimit = options.streamUploadLimit;
+
+        vkdev::AssetLoader assetLoader(*device, *uploadManager, jobSystem, scene->assets);
+        scene->loadAssets(assetLoader);
+
+        // extra copies are loaded alongside the scene but never drawn, so that load time can be measured with many assets
+        for (uint32_t i = 0; i < options.assetCopyCount; i++) {
+            assetLoader.loadTexture("texture_copy_" + std::to_string(i), options.texturePath);
+            assetLoader.loadMesh("mesh_copy_" + std::to_string(i), options.modelPath);
+        }
+
+        // every asset must be ready before it is used for rendering
+        assetLoader.waitAll();
+
+        scene->createInstances();
+    }
+
+    void renderFrame(uint32_t frameNumber, bool recordGpuTimes) {
+        uint32_t frameIndex = 0;
+        renderTarget->aquireFrame(frameIndex);
+        framePacer.beginFrame();
+
+        // results for this slot belong to the frame that last used it, which has now completed
+        if (timestamps->collect(frameIndex) && recordGpuTimes) {
+            for (const auto& scope : timestamps->getResults()) {
+                gpuTimes[scope.first].push_back(scope.second);
+            }
+        }
+
+        // Animate based on the frame number rather than wall time so that every run renders the same sequence.  Streaming
+        // stages its uploads within the update, so their cost shows up in the frame times.
+        scene->update(frameIndex, frameNumber * glm::radians(0.5f), renderTarget->extent);
+
+        VkCommandBuffer commandBuffer = renderCommand->record(frameIndex, frameIndex, scene->getRenderQueue(frameIndex));
+        renderTarget->drawFrame(frameIndex, commandBuffer);
+        framePacer.endFrame();
+
+        if (recordGpuTimes) {
+            submitLatencies.push_back(framePacer.getLastLatencyMilliseconds());
+            recordTimes.push_back(renderCommand->getLastRecordMilliseconds());
+            recordRanges = renderCommand->getLastRangeCount();
+        }
+    }
+
+    // The CPU frame time covers waiting on the frame's fence through submission, so once the GPU becomes the bottleneck it is reflected here as well.
+    void renderFrames() {
+        framePacer.mode = options.targetFps > 0.0 ? vkdev::FramePacingMode::TargetFps : vkdev::FramePacingMode::Uncapped;
+        framePacer.targetFps = options.targetFps;
+
+        for (uint32_t i = 0; i < options.warmupFrameCount; i++) {
+            renderFrame(i, false);
+        }
+
+        vkDeviceWaitIdle(device->logical);
+
+        frameTimes.reserve(options.frameCount);
+        auto benchmarkStart = Clock::now();
+        auto frameStart = benchmarkStart;
+
+        for (uint32_t i = 0; i < options.frameCount; i++) {
+            renderFrame(options.warmupFrameCount + i, true);
+
+            auto frameEnd = Clock::now();
+            frameTimes.push_back(millisecondsBetween(frameStart, frameEnd));
+            frameStart = frameEnd;
+        }
+
+        vkDeviceWaitIdle(device->logical);
+        totalMilliseconds = millisecondsBetween(benchmarkStart, Clock::now());
+    }
+
+    void cleanup() {
+        uploadMilliseconds = timestamps->getTotalUploadMilliseconds();
+        uploadCount = timestamps->getUploadCount();
+
+        renderQueueStats = renderCommand->getStats();
+
+        if (vkdev::TextureStreamer* textureStreamer = scene->getTextureStreamer()) {
+            streamingResults["resident_level"] = textureStreamer->getResidentLevel(scene->getStreamedTexture());
+            streamingResults["resident_kb"] = textureStreamer->getResidentSize() / 1024;
+            streamingResults["uploaded_kb"] = textureStreamer->getTotalUploadBytes() / 1024;
+            streamingResults["max_frame_upload_kb"] = textureStreamer->getMaxFrameUploadBytes() / 1024;
+            streamingResults["evictions"] = textureStreamer->getEvictionCount();
+        }
+
+        drawIndirectCount = scene->getGpuCuller() != nullptr && scene->getGpuCuller()->usesDrawCount();
+
+        renderCommand->cleanup();
+        scene->cleanupPipeline();
+        scene->cleanup();
+
+        renderTarget->cleanupSyncObjects();
+        renderTarget->cleanup();
+        renderTarget->cleanupAttachmentMemory();
+        uploadManager->cleanup();
+        commandPool->timestamps = nullptr;
+        timestamps->cleanup();
+        commandPool->cleanup();
+
+        // everything has been released at this point, so any memory still reported here has leaked
+        memoryAtShutdown = device->memory->toJson();
+
+        device->cleanup();
+        instance.cleanup();
+
+        jobSystem.cleanup();
+    }
+
+    void writeResults() {
+        auto summarize = [](std::vector<double> samples) {
+            std::sort(samples.begin(), samples.end());
+
+            nlohmann::json summary;
+            summary["min"] = samples.empty() ? 0.0 : samples.front();
+            summary["max"] = samples.empty() ? 0.0 : samples.back();
+            summary["p50"] = percentile(samples, 50.0);
+            summary["p95"] = percentile(samples, 95.0);
+            summary["p99"] = percentile(samples, 99.0);
+
+            return summary;
+        };
+
+        nlohmann::json results;
+        results["frames"] = options.frameCount;
+        results["warmup_frames"] = options.warmupFrameCount;
+        results["frames_in_flight"] = options.framesInFlight;
+        results["target_fps"] = options.targetFps;
+        results["width"] = WIDTH;
+        results["height"] = HEIGHT;
+        results["gpu_instances"] = options.gpuInstanceCount;
+        results["instances"] = options.instanceCount;
+        results["draws"] = options.drawCount;
+        results["asset_copies"] = options.assetCopyCount;
+        results["texture_budget_mb"] = options.textureBudget;
+        results["stream_upload_limit_kb"] = options.streamUploadLimit;
+        results["draw_indirect_count"] = drawIndirectCount;
+        results["total_ms"] = totalMilliseconds;
+        results["frames_per_second"] = totalMilliseconds > 0.0 ? options.frameCount / (totalMilliseconds / 1000.0) : 0.0;
+
+        results["cpu_frame_time_ms"] = summarize(frameTimes);
+
+        // nothing is presented when running headless, so latency is measured from the start of the frame to its submission
+        results["frame_latency_ms"] = summarize(submitLatencies);
+
+        // command buffers are recorded every frame, this is the CPU time spent recording them
+        results["cpu_record_ms"] = summarize(recordTimes);
+        results["record_ranges"] = recordRanges;
+        results["job_threads"] = jobThreadCount;
+
+        // upload timings are accumulated separately since they happen during init rather than per frame
+        nlohmann::json& gpuTimeResults = results["gpu_time_ms"];
+        for (const auto& scope : gpuTimes) {
+            if (scope.first != "upload") {
+                gpuTimeResults[scope.first] = summarize(scope.second);
+            }
+        }
+
+        results["gpu_upload_ms"] = uploadMilliseconds;
+        results["gpu_upload_count"] = uploadCount;
+
+        nlohmann::json& initPhases = results["init_ms"];
+        for (const auto& phase : phaseTimes) {
+            initPhases[phase.first] = phase.second;
+        }
+
+        // counts of the commands recorded for each frame
+        nlohmann::json& renderQueueResults = results["render_queue"];
+        renderQueueResults["packets"] = renderQueueStats.packetCount;
+        renderQueueResults["draws"] = renderQueueStats.drawCount;
+        renderQueueResults["pipeline_binds"] = renderQueueStats.pipelineBinds;
+        renderQueueResults["descriptor_binds"] = renderQueueStats.descriptorBinds;
+        renderQueueResults["mesh_binds"] = renderQueueStats.meshBinds;
+
+        if (!streamingResults.is_null()) {
+            results["texture_streaming"] = streamingResults;
+        }
+
+        results["memory"]["after_init"] = memoryAfterInit;
+        results["memory"]["at_shutdown"] = memoryAtShutdown;
+
+        std::ofstream file(options.outputPath);
+        if (!file) {
+            throw std::runtime_error("unable to write benchmark results: " + options.outputPath);
+        }
+
+        file << results.dump(4) << std::endl;
+        std::cout << results.dump(4) << std::endl;
+    }
+
+private:
+    BenchmarkOptions options;
+
+    vkdev::Instance instance;
+    std::unique_ptr<vkdev::Device> device;
+    std::unique_ptr<vkdev::CommandPool> commandPool;
+    std::unique_ptr<vkdev::OffscreenRenderTarget> renderTarget;
+    std::unique_ptr<vkdev::RenderCommand> renderCommand;
+    vkdev::RenderQueueStats renderQueueStats;
+    std::unique_ptr<vkdev::TimestampQueryPool> timestamps;
+    std::unique_ptr<vkdev::UploadManager> uploadManager;
+
+    vkdev::JobSystem jobSystem;
+    std::unique_ptr<vkdev::DemoScene> scene;
+
+    nlohmann::json streamingResults;
+    bool drawIndirectCount = false;
+
+    nlohmann::json memoryAfterInit;
+    nlohmann::json memoryAtShutdown;
+
+    std::vector<std::pair<std::string, double>> phaseTimes;
+    vkdev::FramePacer framePacer;
+
+    std::vector<double> frameTimes;
+    std::vector<double> submitLatencies;
+    std::vector<double> recordTimes;
+    uint32_t recordRanges = 0;
+    uint32_t jobThreadCount = 0;
+    std::unordered_map<std::string, std::vector<double>> gpuTimes;
+    double totalMilliseconds = 0.0;
+    double uploadMilliseconds = 0.0;
+    uint32_t uploadCount = 0;
+};
+
+// usage: vkdev_bench [--frames N] [--warmup N] [--frames-in-flight N] [--fps N] [--output path] [--model path] [--texture path] [--texture-budget MB] [--stream-upload-limit KB] [--gpu-instances N] [--instances N] [--draws N] [--asset-copies N] [--threads N] [--pin-threads] [--record-threads N] [--validation]
+int main(int argc, char** argv) {
+    BenchmarkOptions options;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc) {
+            options.frameCount = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+        }
+        else if (strcmp(argv[i], "--warmup") == 0 && i + 1 < argc) {
+            options.warmupFrameCount = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+        }
+        else if (strcmp(argv[i], "--frames-in-flight") == 0 && i + 1 < argc) {
+            options.framesInFlight = static_cast<uint32_t>(std::max(1UL, std::strtoul(argv[++i], nullptr, 10)));
+        }
+        else if (strcmp(argv[i], "--fps") == 0 && i + 1 < argc) {
+            options.targetFps = std::strtod(argv[++i], nullptr);
+        }
+        else if (strcmp(argv[i], "--output") == 0 && i + 1 < argc) {
+            options.outputPath = argv[++i];
+        }
+        else if (strcmp(argv[i], "--model") == 0 && i + 1 < argc) {
+            options.modelPath = argv[++i];
+        }
+        else if (strcmp(argv[i], "--texture") == 0 && i + 1 < argc) {
+            options.texturePath = argv[++i];
+        }
+        else if (strcmp(argv[i], "--texture-budget") == 0 && i + 1 < argc) {
+            options.textureBudget = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+        }
+        else if (strcmp(argv[i], "--stream-upload-limit") == 0 && i + 1 < argc) {
+            options.streamUploadLimit = static_cast<uint32_t>(std::max(1UL, std::strtoul(argv[++i], nullptr, 10)));
+        }
+        else if (strcmp(argv[i], "--gpu-instances") == 0 && i + 1 < argc) {
+            options.gpuInstanceCount = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+            options.instanceCount = 0;
+            options.drawCount = 0;
+        }
+        else if (strcmp(argv[i], "--instances") == 0 && i + 1 < argc) {
+            options.instanceCount = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+            options.gpuInstanceCount = 0;
+            options.drawCount = 0;
+        }
+        else if (strcmp(argv[i], "--draws") == 0 && i + 1 < argc) {
+            options.drawCount = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+            options.gpuInstanceCount = 0;
+            options.instanceCount = 0;
+        }
+        else if (strcmp(argv[i], "--asset-copies") == 0 && i + 1 < argc) {
+            options.assetCopyCount = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+        }
+        else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            options.threadCount = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+        }
+        else if (strcmp(argv[i], "--pin-threads") == 0) {
+            options.pinThreads = true;
+        }
+        else if (strcmp(argv[i], "--record-threads") == 0 && i + 1 < argc) {
+            options.recordThreadCount = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+        }
+        else if (strcmp(argv[i], "--validation") == 0) {
+            options.enableValidation = true;
+        }
+        else {
+            std::cerr << "usage: vkdev_bench [--frames N] [--warmup N] [--frames-in-flight N] [--fps N] [--output path] [--model path] [--texture path] [--texture-budget MB] [--stream-upload-limit KB] [--gpu-instances N] [--instances N] [--draws N] [--asset-copies N] [--threads N] [--pin-threads] [--record-threads N] [--validation]" << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+
+    try {
+        BenchmarkApplication app(options);
+        app.run();
+    }
+    catch (const std::exception & e) {
+        std::cerr << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,137 @@
+#include "vkdev/frustumculler.h"
+#include "vkdev/jobsystem.h"
+
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <nlohmann/json.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <string.h>
+
+using Clock = std::chrono::high_resolution_clock;
+
+struct CullBenchmarkOptions {
+    uint32_t iterations = 20;
+    std::string outputPath;
+};
+
+struct CullConfiguration {
+    const char* name;
+    bool useSimd;
+    bool useJobs;
+};
+
+/*
+Instances are scattered uniformly through a cube centered on the camera target, roughly half of which falls inside the
+frustum.  The median time of several iterations is reported to reduce noise from scheduling.
+*/
+double measureInstancesPerMillisecond(vkdev::FrustumCuller& culler, const vkdev::Frustum& frustum, uint32_t iterations, size_t& visibleCount) {
+    std::vector<uint32_t> visible;
+    std::vector<double> times;
+
+    // warm up caches and the output allocation
+    culler.cull(frustum, visible);
+
+    for (uint32_t i = 0; i < iterations; i++) {
+        auto start = Clock::now();
+        visibleCount = culler.cull(frustum, visible);
+        times.push_back(std::chrono::duration<double, std::chrono::milliseconds::period>(Clock::now() - start).count());
+    }
+
+    std::sort(times.begin(), times.end());
+    const double median = times[times.size() / 2];
+
+    return median > 0.0 ? culler.size() / median : 0.0;
+}
+
+// usage: vkdev_cullbench [--iterations N] [--output path]
+int main(int argc, char** argv) {
+    CullBenchmarkOptions options;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--iterations") == 0 && i + 1 < argc) {
+            options.iterations = static_cast<uint32_t>(std::max(1UL, std::strtoul(argv[++i], nullptr, 10)));
+        }
+        else if (strcmp(argv[i], "--output") == 0 && i + 1 < argc) {
+            options.outputPath = argv[++i];
+        }
+        else {
+            std::cerr << "usage: vkdev_cullbench [--iterations N] [--output path]" << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+
+    const glm::mat4 view = glm::lookAt(glm::vec3(0.0f, -50.0f, 0.0f), glm::vec3(0.0f), glm::vec3(0.0f, 0.0f, 1.0f));
+    const glm::mat4 projection = glm::perspective(glm::radians(60.0f), 16.0f / 9.0f, 0.1f, 100.0f);
+    const vkdev::Frustum frustum = vkdev::Frustum::fromViewProjection(projection * view);
+
+    const CullConfiguration configurations[] = {
+        { "scalar", false, false },
+        { vkdev::FrustumCuller::getSimdName(), true, false },
+        { "threaded", true, true }
+    };
+
+    // the threaded configuration culls ranges on every hardware thread
+    vkdev::JobSystem jobSystem;
+    jobSystem.create();
+
+    nlohmann::json results;
+    results["simd"] = vkdev::FrustumCuller::getSimdName();
+    results["iterations"] = options.iterations;
+    results["threads"] = jobSystem.getThreadCount();
+
+    std::mt19937 random(1234);
+    std::uniform_real_distribution<float> position(-50.0f, 50.0f);
+    std::uniform_real_distribution<float> size(0.1f, 2.0f);
+
+    for (size_t instanceCount : { 10000, 100000, 1000000 }) {
+        vkdev::FrustumCuller culler;
+        culler.reserve(instanceCount);
+
+        for (size_t i = 0; i < instanceCount; i++) {
+            const glm::vec3 min(position(random), position(random), position(random));
+            culler.add({ min, min + glm::vec3(size(random)) });
+        }
+
+        nlohmann::json& countResults = results["instances"][std::to_string(instanceCount)];
+
+        for (const auto& configuration : configurations) {
+            culler.useSimd = configuration.useSimd;
+            culler.jobSystem = configuration.useJobs ? &jobSystem : nullptr;
+
+            size_t visibleCount = 0;
+            const double rate = measureInstancesPerMillisecond(culler, frustum, options.iterations, visibleCount);
+
+            countResults[configuration.name]["instances_per_ms"] = rate;
+            countResults["visible"] = visibleCount;
+
+            std::cout << instanceCount << " instances, " << configuration.name << ": " << rate << " instances/ms (" << visibleCount << " visible)" << std::endl;
+        }
+    }
+
+    jobSystem.cleanup();
+
+    if (!options.outputPath.empty()) {
+        std::ofstream file(options.outputPath);
+        if (!file) {
+            std::cerr << "unable to write benchmark results: " << options.outputPath << std::endl;
+            return EXIT_FAILURE;
+        }
+
+        file << results.dump(4) << std::endl;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,164 @@
+#include "vkdev/jobsystem.h"
+
+#include <nlohmann/json.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <string.h>
+
+using Clock = std::chrono::high_resolution_clock;
+
+struct JobBenchmarkOptions {
+    uint32_t jobCount = 20000;
+    uint32_t work = 1000; // iterations of arithmetic performed by each job
+    uint32_t iterations = 20;
+    bool pinThreads = false;
+    std::string outputPath;
+};
+
+// a dependent chain of multiplies which the compiler can not fold away, the result is written out by the caller
+inline uint32_t simulateWork(uint32_t seed, uint32_t work) {
+    uint32_t value = seed;
+
+    for (uint32_t i = 0; i < work; i++) {
+        value = value * 1664525U + 1013904223U;
+    }
+
+    return value;
+}
+
+template <typename Function>
+double medianSeconds(uint32_t iterations, const Function& function) {
+    std::vector<double> times;
+
+    // warm up caches and the job rings
+    function();
+
+    for (uint32_t i = 0; i < iterations; i++) {
+        auto start = Clock::now();
+        function();
+        times.push_back(std::chrono::duration<double>(Clock::now() - start).count());
+    }
+
+    std::sort(times.begin(), times.end());
+    return times[times.size() / 2];
+}
+
+/*
+Measures two ways of using the job system for each thread count.  The first runs every item as its own job, which
+measures the cost of queuing, stealing and completing jobs.  The second splits the same items with parallelFor, which
+shows how close batched work gets to scaling with the number of threads.
+usage: vkdev_jobbench [--jobs N] [--work N] [--iterations N] [--pin-threads] [--output path]
+*/
+int main(int argc, char** argv) {
+    JobBenchmarkOptions options;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--jobs") == 0 && i + 1 < argc) {
+            options.jobCount = static_cast<uint32_t>(std::max(1UL, std::strtoul(argv[++i], nullptr, 10)));
+        }
+        else if (strcmp(argv[i], "--work") == 0 && i + 1 < argc) {
+            options.work = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+        }
+        else if (strcmp(argv[i], "--iterations") == 0 && i + 1 < argc) {
+            options.iterations = static_cast<uint32_t>(std::max(1UL, std::strtoul(argv[++i], nullptr, 10)));
+        }
+        else if (strcmp(argv[i], "--pin-threads") == 0) {
+            options.pinThreads = true;
+        }
+        else if (strcmp(argv[i], "--output") == 0 && i + 1 < argc) {
+            options.outputPath = argv[++i];
+        }
+        else {
+            std::cerr << "usage: vkdev_jobbench [--jobs N] [--work N] [--iterations N] [--pin-threads] [--output path]" << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+
+    const uint32_t hardwareThreads = std::max(1U, std::thread::hardware_concurrency());
+
+    // powers of two up to the hardware concurrency, which is always included
+    std::vector<uint32_t> threadCounts;
+    for (uint32_t threadCount = 1; threadCount < hardwareThreads; threadCount *= 2) {
+        threadCounts.push_back(threadCount);
+    }
+    threadCounts.push_back(hardwareThreads);
+
+    nlohmann::json results;
+    results["jobs"] = options.jobCount;
+    results["work"] = options.work;
+    results["iterations"] = options.iterations;
+    results["pin_threads"] = options.pinThreads;
+    results["hardware_threads"] = hardwareThreads;
+
+    // each item writes its own slot so that the work has a visible result
+    std::vector<uint32_t> output(options.jobCount);
+
+    double baseJobsPerSecond = 0.0;
+    double baseItemsPerSecond = 0.0;
+
+    for (uint32_t threadCount : threadCounts) {
+        vkdev::JobSystem jobSystem;
+        jobSystem.create(threadCount, options.pinThreads);
+
+        const double jobSeconds = medianSeconds(options.iterations, [&]() {
+            vkdev::JobCounter counter;
+
+            for (uint32_t i = 0; i < options.jobCount; i++) {
+                jobSystem.run([&output, &options, i]() { output[i] = simulateWork(i, options.work); }, &counter);
+            }
+
+            jobSystem.wait(counter);
+        });
+
+        const double parallelForSeconds = medianSeconds(options.iterations, [&]() {
+            jobSystem.parallelFor(options.jobCount, 64, [&output, &options](size_t begin, size_t end) {
+                for (size_t i = begin; i < end; i++) {
+                    output[i] = simulateWork(static_cast<uint32_t>(i), options.work);
+                }
+            });
+        });
+
+        jobSystem.cleanup();
+
+        const double jobsPerSecond = jobSeconds > 0.0 ? options.jobCount / jobSeconds : 0.0;
+        const double itemsPerSecond = parallelForSeconds > 0.0 ? options.jobCount / parallelForSeconds : 0.0;
+
+        if (threadCount == 1) {
+            baseJobsPerSecond = jobsPerSecond;
+            baseItemsPerSecond = itemsPerSecond;
+        }
+
+        const double jobsSpeedup = baseJobsPerSecond > 0.0 ? jobsPerSecond / baseJobsPerSecond : 0.0;
+        const double itemsSpeedup = baseItemsPerSecond > 0.0 ? itemsPerSecond / baseItemsPerSecond : 0.0;
+
+        nlohmann::json& threadResults = results["threads"][std::to_string(threadCount)];
+        threadResults["jobs_per_second"] = jobsPerSecond;
+        threadResults["jobs_speedup"] = jobsSpeedup;
+        threadResults["parallel_for_items_per_second"] = itemsPerSecond;
+        threadResults["parallel_for_speedup"] = itemsSpeedup;
+
+        std::cout << threadCount << " thread(s): " << jobsPerSecond << " jobs/s (" << jobsSpeedup << "x), parallelFor "
+                  << itemsPerSecond << " items/s (" << itemsSpeedup << "x)" << std::endl;
+    }
+
+    if (!options.outputPath.empty()) {
+        std::ofstream file(options.outputPath);
+        if (!file) {
+            std::cerr << "unable to write benchmark results: " << options.outputPath << std::endl;
+            return EXIT_FAILURE;
+        }
+
+        file << results.dump(4) << std::endl;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,105 @@
+#pragma once
+
+#include "vkdev/assets.h"
+#include "vkdev/device.h"
+#include "vkdev/jobsystem.h"
+#include "vkdev/uploadmanager.h"
+
+#include <cstdint>
+#include <exception>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace vkdev {
+
+enum class AssetState {
+    Loading,   // the file is being read and decoded on a job
+    Uploading, // the asset has been added to Assets and its upload submitted
+    Ready,     // the upload has completed and the asset may be used for rendering
+    Failed     // the file could not be read or decoded, or the asset could not be created
+};
+
+struct AssetRequest;
+class TextureStreamer;
+
+// Refers to an asset requested from an AssetLoader.  Copies of a handle refer to the same asset.
+class AssetHandle {
+public:
+    AssetState getState() const;
+    inline bool isReady() const { return getState() == AssetState::Ready; }
+
+    const std::string& getName() const;
+
+    // rethrows the error which stopped a failed asset from loading
+    void rethrowError() const;
+
+    // the texture streamer's handle for a texture loaded with loadStreamedTexture, valid once the asset is ready
+    uint32_t getStreamedTexture() const;
+
+private:
+    friend class AssetLoader;
+
+    std::shared_ptr<AssetRequest> request;
+};
+
+/**
+Loads assets in parallel on the job system.
+Each load reads and decodes its files on a job and returns a handle immediately.  Creating device objects and recording
+uploads happens on the thread which calls update, since the upload manager is not thread safe.  Every asset decoded
+since the last update is uploaded in a single batch, and its handle becomes ready once that batch's fence has signaled.
+Startup then costs roughly the slowest single load plus the time to upload everything, rather than the sum of all loads.
+*/
+class AssetLoader {
+public:
+    AssetLoader(Device& device_, UploadManager& uploadManager_, JobSystem& jobSystem_, Assets& assets_)
+        : device(device_), uploadManager(uploadManager_), jobSystem(jobSystem_), assets(assets_) {}
+
+    // The asset is added to Assets under its name once it has been decoded, but must not be used until its handle is ready.
+    // Loads may only be started from the thread which created the job system.
+    AssetHandle loadTexture(const std::string& name, const std::string& path);
+
+    // Loads a texture which is added to the texture streamer rather than to Assets.  Missing mip levels are built on the
+    // decoding job, and the handle becomes ready once the texture's tail levels have been uploaded.
+    AssetHandle loadStreamedTexture(const std::string& name, const std::string& path, TextureStreamer& textureStreamer);
+
+    // Loads a .model file, or the first mesh of a .vkpack mesh pack along with its levels of detail.  The mesh's
+    // description is added to Assets as well.
+    AssetHandle loadMesh(const std::string& name, const std::string& path);
+
+    AssetHandle loadShader(const std::string& name, const std::string& vertexPath, const std::string& fragmentPath, const std::string& infoPath);
+
+    // Creates the assets which have finished decoding, submits their uploads and marks assets whose uploads have completed as ready
+    void update();
+
+    // Waits until every requested asset is ready or has failed, helping to run loading jobs in the meantime.
+    // Rethrows the error of the first asset which failed.
+    void waitAll();
+
+    // Waits for outstanding loading jobs, discarding any assets which have not been created yet
+    void cleanup();
+
+    // number of assets which are not yet ready or failed
+    inline size_t getPendingCount() const { return loading.size() + uploading.size(); }
+
+private:
+    AssetHandle startLoad(std::shared_ptr<AssetRequest> request);
+    void createAsset(AssetRequest& request);
+
+private:
+    Device& device;
+    UploadManager& uploadManager;
+    JobSystem& jobSystem;
+    Assets& assets;
+
+    // counts the decoding jobs of every request
+    JobCounter loadCounter;
+
+    std::vector<std::shared_ptr<AssetRequest>> loading;
+    std::vector<std::shared_ptr<AssetRequest>> uploading;
+
+    // error of the first asset which failed since the last waitAll
+    std::exception_ptr firstError;
+};
+
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include "vkdev/device.h"
+#include "vkdev/image.h"
+
+#include <vulkan/vulkan.h>
+
+#include <vk_mem_alloc.h>
+
+#include <cstdint>
+#include <unordered_map>
+
+namespace vkdev {
+
+/**
+Provides memory for render target attachments.
+Each attachment is placed in a numbered slot.  The memory for a slot is kept when its images are destroyed and reused by
+the next image created in the slot if its requirements fit, so recreating attachments on resize does not reallocate
+unless the extent grows.  Images placed in the same slot alias the same memory and must never be in use at the same time.
+Transient attachments prefer lazily allocated memory when the device offers it.
+*/
+class AttachmentAllocator {
+public:
+    explicit AttachmentAllocator(Device& device_) : device(device_) {}
+
+    // Creates an image in the given slot.  All images currently alive in the slot must fit in the memory required by
+    // this image, so when aliasing the largest image should be created first.
+    void createImage(Image& image, uint32_t slot, const VkExtent2D& extent, VkSampleCountFlagBits numSamples, VkFormat format, VkImageUsageFlags usageFlags);
+
+    // frees the memory for every slot.  No images may be using it.
+    void cleanup();
+
+private:
+    bool fits(VmaAllocation allocation, const VkMemoryRequirements& requirements) const;
+
+private:
+    Device& device;
+
+    std::unordered_map<uint32_t, VmaAllocation> slots;
+};
+
+}
@@ -9,4 +9,15 @@ struct Bounds {
     glm::vec3 max;
 };
 
+// Returns the axis aligned box enclosing the transformed box.  The extent is projected onto each axis of the transform.
+inline Bounds transformBounds(const Bounds& bounds, const glm::mat4& transform) {
+    const glm::vec3 center = glm::vec3(transform * glm::vec4((bounds.min + bounds.max) * 0.5f, 1.0f));
+    const glm::vec3 extent = (bounds.max - bounds.min) * 0.5f;
+
+    const glm::mat3 absolute(glm::abs(glm::vec3(transform[0])), glm::abs(glm::vec3(transform[1])), glm::abs(glm::vec3(transform[2])));
+    const glm::vec3 transformedExtent = absolute * extent;
+
+    return { center - transformedExtent, center + transformedExtent };
+}
+
 }
@@ -2,6 +2,7 @@
 
 #include "vkdev/commandpool.h"
 #include "vkdev/device.h"
+#include "vkdev/memorytelemetry.h"
 
 #include <vulkan/vulkan.h>
 
@@ -19,10 +20,17 @@ namespace vkdev {
         VmaAllocation  allocation;
         VkDeviceSize size = 0;
 
+        // only valid for buffers created with createMapped
+        void* mapped = nullptr;
+
         void cleanup();
 
-        void create(VkDeviceSize size, VkBufferUsageFlags usage, VmaMemoryUsage memoryUsage);
-        void createWithData(const void* data, VkDeviceSize size, VkBufferUsageFlags usage, VmaMemoryUsage memoryUsage);
+        // category is used to attribute the allocation in the device's memory telemetry
+        void create(VkDeviceSize size, VkBufferUsageFlags usage, VmaMemoryUsage memoryUsage, MemoryCategory category = MemoryCategory::Other);
+        void createWithData(const void* data, VkDeviceSize size, VkBufferUsageFlags usage, VmaMemoryUsage memoryUsage, MemoryCategory category = MemoryCategory::Other);
+
+        // creates a buffer which stays mapped for its entire lifetime
+        void createMapped(VkDeviceSize size, VkBufferUsageFlags usage, VmaMemoryUsage memoryUsage, MemoryCategory category = MemoryCategory::Other);
 
         static void copy(CommandPool& commandPool, const Buffer& src, Buffer& dst, VkDeviceSize srcOffset = 0, VkDeviceSize dstOffset = 0, VkDeviceSize size = std::numeric_limits<VkDeviceSize>::max());
         static uint32_t findMemoryType(VkPhysicalDevice physicalDevice, uint32_t typeFilter, VkMemoryPropertyFlags properties);
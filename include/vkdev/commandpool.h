@@ -8,6 +8,7 @@
 namespace vkdev {
 
 class SingleUseCommandBuffer;
+class TimestampQueryPool;
 
 // Note that command pools are tied to a specific queue.
 class CommandPool {
@@ -18,11 +19,18 @@ public:
     VkCommandPool handle = VK_NULL_HANDLE;
     const Queue& queue;
 
+    // if set, single use command buffers created from this pool will record upload timestamps
+    TimestampQueryPool* timestamps = nullptr;
+
     SingleUseCommandBuffer createSingleUseBuffer();
 
-    void create();
+    // flags such as VK_COMMAND_POOL_CREATE_TRANSIENT_BIT for pools whose buffers are recorded and released every frame
+    void create(VkCommandPoolCreateFlags flags = 0);
     void cleanup();
 
+    // Returns every command buffer allocated from the pool to the initial state.  None of them may still be pending execution.
+    void reset();
+
 private:
     Device device;
 };
@@ -0,0 +1,141 @@
+#pragma once
+
+#include "vkdev/assetloader.h"
+#include "vkdev/assets.h"
+#include "vkdev/bounds.h"
+#include "vkdev/descriptor.h"
+#include "vkdev/device.h"
+#include "vkdev/frustumculler.h"
+#include "vkdev/gpuculler.h"
+#include "vkdev/instancebatcher.h"
+#include "vkdev/jobsystem.h"
+#include "vkdev/pipeline.h"
+#include "vkdev/renderqueue.h"
+#include "vkdev/rendertarget.h"
+#include "vkdev/swapchain.h"
+#include "vkdev/texturestreamer.h"
+#include "vkdev/uniformarena.h"
+#include "vkdev/uploadmanager.h"
+
+#include <vulkan/vulkan.h>
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace vkdev {
+
+// alignas is used to be explicit in regards to vulkan alignment requirements.  mat4 should be aligned to multiples of 16 bytes
+struct UniformBufferObject {
+    alignas(16) glm::mat4 model;
+    alignas(16) glm::mat4 view;
+    alignas(16) glm::mat4 proj;
+};
+
+/**
+The scene rendered by vulkantest and vkdev_bench: a single textured mesh rotating about the z axis.
+It is drawn once and culled on the CPU by default.  Setting gpuInstanceCount culls and draws that many instances on the
+GPU, instanceCount draws them with hardware instancing and drawCount draws that many copies as separate packets with
+their own uniforms.  Only the last of these set should be non zero.
+The objects are created in steps so that callers may time each of them: loadAssets queues the assets, and once the asset
+loader has finished createInstances, createPipeline, createDescriptor, createInstanceBatcher and createRenderQueues are
+called in that order.
+*/
+class DemoScene {
+public:
+    DemoScene(Device& device_, UploadManager& uploadManager_, JobSystem& jobSystem_): device(device_), uploadManager(uploadManager_), jobSystem(jobSystem_) {}
+
+    // capacity of the render queue of each frame in flight
+    static const uint32_t MAX_DRAW_PACKETS = 1024;
+
+    // transforms placing the instances on a square grid in the xy plane which is centered on the origin
+    static std::vector<glm::mat4> instanceGrid(const Bounds& bounds, uint32_t instanceCount);
+
+    // Queues the texture, mesh and shader on the asset loader, which must have been created with this scene's assets.
+    // When streaming, only the texture's lowest mip levels are loaded and the rest are streamed in as they are needed.
+    void loadAssets(AssetLoader& assetLoader);
+
+    // creates the culler for the loaded mesh and the transforms of its instances
+    void createInstances();
+
+    // The pipeline depends on the render target, so it is created again whenever the render target is.
+    void createPipeline(RenderTarget& renderTarget);
+    void cleanupPipeline();
+
+    // creates the uniform arena and the descriptor shared by every frame in flight
+    void createDescriptor();
+    void createInstanceBatcher();
+    void createRenderQueues();
+
+    // Writes the frame's uniforms with the mesh rotated by angle radians, updates texture streaming and fills the frame's
+    // render queue.  Called once the fence of the frame slot has been waited on.
+    void update(uint32_t frameSlot, float angle, const VkExtent2D& extent);
+
+    inline RenderQueue& getRenderQueue(uint32_t frameSlot) { return *renderQueues[frameSlot]; }
+
+    // null unless the texture is streamed
+    inline TextureStreamer* getTextureStreamer() const { return textureStreamer.get(); }
+    inline uint32_t getStreamedTexture() const { return streamedTexture; }
+
+    // null unless instances are culled on the GPU
+    inline GpuCuller* getGpuCuller() const { return gpuCuller.get(); }
+
+    // Destroys everything but the pipeline, which is destroyed by cleanupPipeline.  The device must be idle.
+    void cleanup();
+
+    // either a .model file or a .vkpack mesh pack
+    std::string modelPath = "models/chalet.model";
+
+    // any image stb_image can read, or a .ktx2 texture with precomputed mip levels
+    std::string texturePath = "textures/chalet.jpg";
+
+    uint32_t framesInFlight = SwapChain::DEFAULT_FRAMES_IN_FLIGHT;
+    uint32_t gpuInstanceCount = 0;
+    uint32_t instanceCount = 0;
+    uint32_t drawCount = 0;
+
+    // Megabytes the streamed texture may use, 0 loads the whole texture.  Kilobytes of texture data staged each frame.
+    uint32_t textureBudget = 0;
+    uint32_t streamUploadLimit = 4096;
+
+    Assets assets;
+
+private:
+    // writes the frame's uniforms to its slice of the uniform arena and returns their dynamic offset
+    uint32_t updateUniforms(uint32_t frameSlot, float angle, const VkExtent2D& extent);
+
+    void buildDrawList(uint32_t frameSlot, uint32_t uniformOffset);
+
+    // Every copy is submitted as its own packet with its own uniforms so that recording cost grows with the draw count.
+    void buildCopiesDrawList(uint32_t frameSlot);
+
+private:
+    Device& device;
+    UploadManager& uploadManager;
+    JobSystem& jobSystem;
+
+    std::unique_ptr<Pipeline> pipeline;
+    std::unique_ptr<Descriptor> descriptor;
+    std::unique_ptr<UniformArena> uniformArena;
+    std::vector<std::unique_ptr<RenderQueue>> renderQueues;
+
+    AssetHandle streamedTextureHandle;
+    std::unique_ptr<TextureStreamer> textureStreamer;
+    uint32_t streamedTexture = 0;
+
+    uint32_t currentLod = 0;
+    float meshDepth = 0.0f;
+
+    FrustumCuller culler;
+    std::vector<uint32_t> visibleInstances;
+    std::unique_ptr<GpuCuller> gpuCuller;
+    std::unique_ptr<InstanceBatcher> instanceBatcher;
+
+    std::vector<glm::mat4> drawTransforms;
+    UniformBufferObject frameUniforms = {};
+};
+
+}
@@ -4,6 +4,7 @@
 #include "vkdev/buffer.h"
 #include "vkdev/device.h"
 #include "vkdev/material.h"
+#include "vkdev/uniformarena.h"
 
 #include <vulkan/vulkan.h>
 
@@ -14,25 +15,39 @@
 
 namespace vkdev {
 
+// Uniform buffers are bound as VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC views into the uniform arena, so a single
+// descriptor set is shared by every frame in flight.  The data for each draw is selected with a dynamic offset when binding.
+// A set can not be written while frames in flight use it, so replacing an image writes a new set and the pool may hold several.
 class Descriptor{
 public:
     explicit Descriptor(Device& device_): device(device_) {}
-    void create(Material& material, Assets& assets, uint32_t count, uint32_t mipLevels);
+    void create(Material& material, Assets& assets, UniformArena& uniformArena, uint32_t mipLevels, uint32_t maxSets = 1);
     void cleanup();
 
-    VkDescriptorPool pool = VK_NULL_HANDLE;
+    // Binds a different image to a combined image sampler.  descriptorSet is replaced by a copy which refers to the new image
+    // and the previous set is kept until releaseRetiredSets is called with a frame number of at least retireFrame.
+    void replaceImage(const std::string& uniformName, const Image& image, uint64_t retireFrame);
+    void releaseRetiredSets(uint64_t frame);
 
-    std::vector<VkDescriptorSet> descriptorSets;
+    VkDescriptorPool pool = VK_NULL_HANDLE;
+    VkDescriptorSet descriptorSet = VK_NULL_HANDLE;
 
-    std::unordered_map<std::string, std::vector<vkdev::Buffer>> uniformBuffers;
     std::unordered_map<std::string, VkSampler> samplers;
 
 private:
     void createPool(const Shader& shaderInfo, uint32_t count);
-    void createDescriptorSets(Material& material, Assets& assets, uint32_t count, uint32_t mipLevels);
+    VkDescriptorSet allocateDescriptorSet();
+    void createDescriptorSet(Material& material, Assets& assets, UniformArena& uniformArena, uint32_t mipLevels);
 
 private:
+    struct RetiredSet {
+        VkDescriptorSet descriptorSet;
+        uint64_t retireFrame;
+    };
+
     Device& device;
+    const Shader* shader = nullptr;
+    std::vector<RetiredSet> retiredSets;
 };
 
 }
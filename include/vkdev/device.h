@@ -1,10 +1,12 @@
 #pragma once
 
 #include "instance.h"
+#include "memorytelemetry.h"
 #include "queue.h"
 
 #include <vk_mem_alloc.h>
 
+#include <memory>
 #include <vector>
 #include <string>
 
@@ -12,7 +14,8 @@ namespace vkdev {
 
 class Device {
 public:
-    Device(Instance& instance_, VkSurfaceKHR surface_): instance(instance_), surface(surface_) {}
+    // A device created without a surface is headless: it does not require presentation support and has no presentation queue.
+    explicit Device(Instance& instance_, VkSurfaceKHR surface_ = VK_NULL_HANDLE): instance(instance_), surface(surface_) {}
 
     VkPhysicalDevice physical = VK_NULL_HANDLE;
     VkDevice logical = VK_NULL_HANDLE;
@@ -22,10 +25,25 @@ public:
     void cleanup();
 
     VkSampleCountFlagBits getMaxSupportedSampleCount();
+    inline bool isHeadless() const { return surface == VK_NULL_HANDLE; }
 
     Queue graphicsQueue;
     Queue presentationQueue;
 
+    // will be the same family as the graphics queue if the device does not expose a dedicated transfer queue
+    Queue transferQueue;
+    inline bool hasDedicatedTransferQueue() const { return transferQueue.index != graphicsQueue.index; }
+
+    // records every allocation made through the allocator by category.  Shared so that copies of the device report to the same place.
+    std::shared_ptr<MemoryTelemetry> memory;
+
+    // Loaded from VK_KHR_draw_indirect_count when the device supports it, otherwise null.
+    // The draw count is then read from a buffer rather than being fixed when recording.
+    PFN_vkCmdDrawIndexedIndirectCountKHR cmdDrawIndexedIndirectCount = nullptr;
+
+    // when false an indirect draw may only read a single command
+    bool multiDrawIndirectSupported = false;
+
 private: 
     void createPhysicalDevice(const std::vector<std::string>& requiredDeviceExtensions);
     void createLogicalDevice(const std::vector<std::string>& requiredDeviceExtensions);
@@ -34,6 +52,7 @@ private:
 private:
     Instance& instance;
     VkSurfaceKHR surface;
+    bool memoryBudgetSupported = false;
 };
 
 }
\ No newline at end of file
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <chrono>
+#include <cstdint>
+
+namespace vkdev {
+
+enum class FramePacingMode {
+    // frames are submitted as soon as a frame in flight becomes available
+    Uncapped,
+
+    // after the frame's fence has been waited on, the pacer sleeps until the next frame deadline
+    TargetFps,
+
+    // the presentation engine paces frames using the selected present mode
+    VSync
+};
+
+/**
+Controls how quickly frames are started and measures the latency between the start of a frame and its present.
+The pacer does not present anything itself, it selects the present mode the swap chain should be created with
+and should be notified when each frame begins and when it has been presented.
+*/
+class FramePacer {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    FramePacingMode mode = FramePacingMode::VSync;
+    double targetFps = 60.0;
+
+    // present mode requested when in VSync mode.  One of FIFO, MAILBOX or IMMEDIATE.  The swap chain falls back to FIFO if it is unsupported
+    VkPresentModeKHR vsyncPresentMode = VK_PRESENT_MODE_MAILBOX_KHR;
+
+    // Returns the present mode the swap chain should prefer for the current pacing mode.
+    // Uncapped and TargetFps modes prefer IMMEDIATE so that presentation never blocks.
+    VkPresentModeKHR getPresentMode() const;
+
+    // Call after the fence for the frame has been waited on.  In TargetFps mode this will sleep until the next frame deadline.
+    void beginFrame();
+
+    // Call once the frame has been handed to the presentation engine (or submitted when rendering offscreen).
+    void endFrame();
+
+    inline double getLastLatencyMilliseconds() const { return lastLatencyMilliseconds; }
+    inline double getMaxLatencyMilliseconds() const { return maxLatencyMilliseconds; }
+    inline double getAverageLatencyMilliseconds() const { return frameCount > 0 ? totalLatencyMilliseconds / frameCount : 0.0; }
+    inline uint64_t getFrameCount() const { return frameCount; }
+
+private:
+    void waitUntil(Clock::time_point deadline) const;
+
+private:
+    Clock::time_point frameStart;
+    Clock::time_point nextFrameDeadline;
+    bool started = false;
+
+    double lastLatencyMilliseconds = 0.0;
+    double maxLatencyMilliseconds = 0.0;
+    double totalLatencyMilliseconds = 0.0;
+    uint64_t frameCount = 0;
+};
+
+}
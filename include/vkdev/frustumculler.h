@@ -0,0 +1,71 @@
+#pragma once
+
+#include "vkdev/bounds.h"
+#include "vkdev/jobsystem.h"
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace vkdev {
+
+struct Frustum {
+    // Planes are stored as (normal, distance) with normals pointing inwards, so a point p is inside when dot(normal, p) + distance >= 0
+    glm::vec4 planes[6];
+
+    // Extracts the planes of a Vulkan projection, which has a depth range of 0 to 1.  Planes are in the space that
+    // viewProjection transforms from.
+    static Frustum fromViewProjection(const glm::mat4& viewProjection);
+};
+
+/**
+Tests axis aligned bounding boxes against a frustum.
+Boxes are stored as separate arrays of center and extent components so that 4 (SSE) or 8 (AVX) boxes can be tested
+against a plane at once.  The box is outside when its projected radius on the plane normal is still behind the plane.
+Large instance counts are split into ranges which are culled as jobs, each producing a list of visible indices for its
+range.  The lists are concatenated in range order, so the output is sorted by instance index.
+*/
+class FrustumCuller {
+public:
+    void reserve(size_t instanceCount);
+    void clear();
+
+    // Adds a box in the space of the frustum which will be tested and returns its instance index
+    uint32_t add(const Bounds& bounds);
+    void set(uint32_t index, const Bounds& bounds);
+
+    inline size_t size() const { return centerX.size(); }
+
+    // Writes the indices of every instance intersecting the frustum to visible and returns the count
+    size_t cull(const Frustum& frustum, std::vector<uint32_t>& visible);
+
+    // when false the scalar path is used even if SIMD is available
+    bool useSimd = true;
+
+    // if set, large instance counts are culled in parallel on the threads of the job system
+    JobSystem* jobSystem = nullptr;
+
+    // maximum number of ranges culled in parallel, 0 makes one for each thread of the job system
+    uint32_t threadCount = 0;
+
+    // instance counts below this are culled on the calling thread
+    size_t parallelThreshold = 32 * 1024;
+
+    // name of the SIMD instruction set compiled in, or "scalar"
+    static const char* getSimdName();
+
+private:
+    void cullRange(const Frustum& frustum, size_t begin, size_t end, std::vector<uint32_t>& visible) const;
+    void cullRangeScalar(const Frustum& frustum, size_t begin, size_t end, std::vector<uint32_t>& visible) const;
+    void cullRangeSimd(const Frustum& frustum, size_t begin, size_t end, std::vector<uint32_t>& visible) const;
+
+private:
+    std::vector<float> centerX, centerY, centerZ;
+    std::vector<float> extentX, extentY, extentZ;
+
+    std::vector<std::vector<uint32_t>> rangeVisible;
+};
+
+}
@@ -0,0 +1,96 @@
+#pragma once
+
+#include "vkdev/bounds.h"
+#include "vkdev/buffer.h"
+#include "vkdev/device.h"
+#include "vkdev/mesh.h"
+
+#include <vulkan/vulkan.h>
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <string>
+
+namespace vkdev {
+
+// per instance data read by the cull shader and the vertex shader, laid out to match std430
+struct GpuInstance {
+    glm::mat4 model;
+    glm::vec4 boundsCenter;
+    glm::vec4 boundsExtent;
+};
+
+/**
+Culls and selects a level of detail for every instance of a mesh in a compute shader, which writes the indirect draws
+consumed by the graphics pass.  Instances are drawn with a single indirect call whatever their number, so the CPU cost
+of drawing does not grow with the instance count.
+When the device supports VK_KHR_draw_indirect_count visible draws are packed together and the draw count is read from
+a buffer.  Otherwise a draw is written for every instance slot, with culled instances drawing nothing.
+The draw and count buffers hold one region per frame in flight so that a frame may be culled while another is drawn.
+*/
+class GpuCuller {
+public:
+    static const uint32_t MAX_LODS = 8;
+    static const uint32_t WORKGROUP_SIZE = 64;
+
+    explicit GpuCuller(Device& device_): instanceBuffer(device_), paramsBuffer(device_), drawBuffer(device_), countBuffer(device_), device(device_) {}
+
+    void create(Mesh& mesh_, uint32_t maxInstances_, uint32_t frameCount, const std::string& shaderPath = "shaders/cull.comp.spv");
+    void cleanup();
+
+    // Instance data is shared by every frame in flight, it should be set before drawing or while the device is idle.
+    // Bounds default to the mesh bounds.
+    void setInstance(uint32_t index, const glm::mat4& model);
+    void setInstance(uint32_t index, const glm::mat4& model, const Bounds& bounds);
+
+    // only the first instanceCount instances are culled and drawn
+    void setInstanceCount(uint32_t instanceCount_);
+    inline uint32_t getInstanceCount() const { return instanceCount; }
+    inline uint32_t getMaxInstances() const { return maxInstances; }
+
+    // Writes the frustum and level of detail parameters used by the given frame in flight.
+    // The projection should not have the y axis flipped.
+    void update(uint32_t frameIndex, const glm::mat4& view, const glm::mat4& projection, float viewportHeight);
+
+    // Records the cull dispatch.  This must be recorded outside of a render pass and before recordDraw.
+    void recordCull(VkCommandBuffer commandBuffer, uint32_t frameIndex);
+
+    // Records the indirect draw.  The mesh buffers and the pipeline must already be bound, the instance descriptor set
+    // is bound to the given set index of the pipeline layout.
+    void recordDraw(VkCommandBuffer commandBuffer, uint32_t frameIndex, VkPipelineLayout pipelineLayout, uint32_t setIndex = 1);
+
+    inline bool usesDrawCount() const { return device.cmdDrawIndexedIndirectCount != nullptr; }
+
+    // maximum error in pixels when selecting a level of detail
+    float pixelError = 1.0f;
+
+    // the layout of the vertex stage descriptor set holding the instance buffer, pipelines drawing through the culler include it
+    VkDescriptorSetLayout instanceLayout = VK_NULL_HANDLE;
+
+    Buffer instanceBuffer;
+    Buffer paramsBuffer;
+    Buffer drawBuffer;
+    Buffer countBuffer;
+
+private:
+    void createDescriptors();
+    void createPipeline(const std::string& shaderPath);
+
+private:
+    Device& device;
+    Mesh* mesh = nullptr;
+
+    uint32_t maxInstances = 0;
+    uint32_t instanceCount = 0;
+
+    VkDescriptorSetLayout cullLayout = VK_NULL_HANDLE;
+    VkDescriptorPool descriptorPool = VK_NULL_HANDLE;
+    VkDescriptorSet cullDescriptorSet = VK_NULL_HANDLE;
+    VkDescriptorSet instanceDescriptorSet = VK_NULL_HANDLE;
+
+    VkPipelineLayout pipelineLayout = VK_NULL_HANDLE;
+    VkPipeline pipeline = VK_NULL_HANDLE;
+};
+
+}
@@ -6,14 +6,22 @@
 
 #include <vulkan/vulkan.h>
 
+#include <vk_mem_alloc.h>
+
 namespace vkdev {
+
+// location of one mip level's tightly packed data within a buffer or file
+struct ImageLevel {
+    VkDeviceSize offset = 0;
+    VkDeviceSize size = 0;
+};
     
 class Image {
 public:
     explicit Image(Device& device_): device(device_) {}
 
     VkImage handle = VK_NULL_HANDLE;
-    VkDeviceMemory memory = VK_NULL_HANDLE;
+    VmaAllocation allocation = VK_NULL_HANDLE;
     VkImageView view = VK_NULL_HANDLE;
 
     uint32_t width = 0;
@@ -21,10 +29,21 @@ public:
     uint32_t mipLevels = 0;
     VkFormat format = VK_FORMAT_UNDEFINED;
 
-    void create(uint32_t width_, uint32_t height_, uint32_t mipLevels_, VkSampleCountFlagBits numSamples, VkFormat format_, VkImageTiling tiling, VkImageUsageFlags usageFlags, VkMemoryPropertyFlags memoryPropertyFlags);
+    void create(uint32_t width_, uint32_t height_, uint32_t mipLevels_, VkSampleCountFlagBits numSamples, VkFormat format_, VkImageTiling tiling, VkImageUsageFlags usageFlags, VkMemoryPropertyFlags memoryPropertyFlags, MemoryCategory category = MemoryCategory::Texture);
+
+    // Creates the image without any memory.  bindMemory must be called with memory the image does not own before it is used.
+    // Several images may alias the same memory as long as they are never in use at the same time.
+    void createUnbound(uint32_t width_, uint32_t height_, uint32_t mipLevels_, VkSampleCountFlagBits numSamples, VkFormat format_, VkImageTiling tiling, VkImageUsageFlags usageFlags);
+    void bindMemory(VmaAllocation memory);
     void transitionLayout(CommandPool& commandPool, VkImageLayout oldLayout, VkImageLayout newLayout);
     void loadBufferData(CommandPool& commandPool, const Buffer& buffer);
     void generateMipmaps(CommandPool& commandPool);
+
+    // These variants record into an existing command buffer rather than submitting their own
+    void transitionLayout(VkCommandBuffer commandBuffer, VkImageLayout oldLayout, VkImageLayout newLayout);
+    void loadBufferData(VkCommandBuffer commandBuffer, const Buffer& buffer, VkDeviceSize bufferOffset = 0);
+    void loadBufferRows(VkCommandBuffer commandBuffer, const Buffer& buffer, VkDeviceSize bufferOffset, uint32_t firstRow, uint32_t rowCount, uint32_t mipLevel = 0);
+    void generateMipmaps(VkCommandBuffer commandBuffer);
     void createView(VkImageAspectFlags aspectFlags);
 
     void cleanup();
@@ -35,6 +54,7 @@ public:
 
 private:
     Device& device;
+    bool ownsAllocation = true;
 };
 
 }
@@ -7,7 +7,8 @@ namespace vkdev {
     public:
         VkInstance handle = VK_NULL_HANDLE;
 
-        void create(bool enableValidationLayers);
+        // When headless is true the GLFW surface extensions are not requested, allowing the instance to be created without a display.
+        void create(bool enableValidationLayers, bool headless = false);
         void cleanup();
     };
 }
\ No newline at end of file
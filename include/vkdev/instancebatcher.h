@@ -0,0 +1,87 @@
+#pragma once
+
+#include "vkdev/buffer.h"
+#include "vkdev/descriptor.h"
+#include "vkdev/device.h"
+#include "vkdev/mesh.h"
+
+#include <vulkan/vulkan.h>
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <vector>
+
+namespace vkdev {
+
+// the per instance vertex stream written by InstanceBatcher
+struct InstanceData {
+    glm::mat4 model;
+    uint32_t materialIndex;
+};
+
+// a run of instances sharing a mesh and a material which is drawn with a single instanced draw
+struct InstanceBatch {
+    Mesh* mesh;
+    Descriptor* descriptor;
+    uint32_t firstInstance;
+    uint32_t instanceCount;
+    uint32_t lod;
+};
+
+/**
+Groups instances which share a mesh and a material so that each group is drawn with one instanced draw.
+A material's resources are bound through its descriptor, so instances are grouped by mesh and descriptor.
+Instances are added up front and build orders them by group.  Their transforms and material indices are written to
+a per instance vertex stream every frame with update, and a draw per batch is read from an indirect buffer so that the
+command buffers do not need to be recorded again when instances move or the level of detail changes.
+Pipelines drawing the batches need the stream described by addInstanceBinding.
+*/
+class InstanceBatcher {
+public:
+    explicit InstanceBatcher(Device& device_): instanceBuffer(device_), drawCommands(device_), device(device_) {}
+
+    // Adds an instance and returns its handle.  Instances can only be added before build.
+    uint32_t add(Mesh& mesh, Descriptor& descriptor, const glm::mat4& model, uint32_t materialIndex = 0);
+
+    // Groups the instances into batches and creates the instance and draw buffers, with one region per frame in flight
+    void build(uint32_t frameCount_);
+    void cleanup();
+
+    void setInstance(uint32_t handle, const glm::mat4& model, uint32_t materialIndex = 0);
+    void setLod(uint32_t batch, uint32_t lod);
+
+    // Writes the instance stream and draws for the given frame in flight.  The frame's previous submission must have completed.
+    void update(uint32_t frameIndex);
+
+    // Records a draw for every batch.  The pipeline must be bound, the descriptor of each batch is bound to set 0 with the given dynamic offset.
+    void record(VkCommandBuffer commandBuffer, uint32_t frameIndex, VkPipelineLayout pipelineLayout, uint32_t dynamicOffset) const;
+
+    // adds the InstanceData stream to a mesh description and returns its binding
+    static uint32_t addInstanceBinding(MeshDescription& meshDescription);
+
+    inline const std::vector<InstanceBatch>& getBatches() const { return batches; }
+    inline uint32_t getInstanceCount() const { return static_cast<uint32_t>(instances.size()); }
+
+    Buffer instanceBuffer;
+    Buffer drawCommands;
+
+private:
+    struct Instance {
+        Mesh* mesh;
+        Descriptor* descriptor;
+        InstanceData data;
+    };
+
+    Device& device;
+
+    std::vector<Instance> instances;
+
+    // position of each instance within the batched stream, indexed by handle
+    std::vector<uint32_t> slots;
+    std::vector<InstanceBatch> batches;
+
+    uint32_t frameCount = 0;
+};
+
+}
@@ -0,0 +1,138 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace vkdev {
+
+struct Job;
+
+/*
+Tracks the completion of a group of jobs.  The counter is incremented when a job is run with it and decremented once the
+job has finished, so it is done when every job run with it has finished.  Jobs run with the counter as a dependency are
+held back until it is done.  A counter must outlive the jobs which refer to it.
+*/
+class JobCounter {
+public:
+    inline bool isDone() const { return pending.load(std::memory_order_acquire) == 0; }
+
+private:
+    friend class JobSystem;
+
+    std::atomic<uint32_t> pending = { 0 };
+};
+
+/**
+A work stealing thread pool.
+Every thread, including the one which created the system, owns a fixed size lock free deque (Chase-Lev).  A thread
+pushes and pops jobs at the bottom of its own deque and, when it runs out, steals from the top of another thread's deque,
+so jobs stay on the thread which created them unless another thread is idle.  Idle workers sleep until jobs are queued.
+Jobs are allocated from a ring owned by the thread which queues them, so queuing a job does not allocate unless the
+function's captures are too large for std::function to store inline.  A thread may have at most JOB_CAPACITY jobs
+outstanding.
+Waiting on a counter runs queued jobs on the waiting thread rather than blocking it.
+*/
+class JobSystem {
+public:
+    using JobFunction = std::function<void()>;
+
+    static const uint32_t JOB_CAPACITY = 4096;
+
+    JobSystem();
+    ~JobSystem();
+
+    // Starts threadCount - 1 workers, which run jobs along with the calling thread.  0 uses the hardware concurrency.
+    // When pinThreads is set each worker is bound to a single CPU, which is not supported on every platform.
+    void create(uint32_t threadCount = 0, bool pinThreads = false);
+
+    // Stops the workers.  Every job must have finished.
+    void cleanup();
+
+    // Queues a job on the calling thread.  The counter, if given, is incremented immediately.
+    // When a dependency is given the job is not queued until the dependency is done.
+    // Jobs may only be run from the thread which created the system or from within other jobs, and must not throw.
+    void run(JobFunction function, JobCounter* counter = nullptr, JobCounter* dependency = nullptr);
+
+    // Runs queued jobs on the calling thread until the counter is done
+    void wait(const JobCounter& counter);
+
+    // Calls function(begin, end) for ranges covering [0, count) in parallel and returns once all of them have finished.
+    // Ranges hold at least minBatchSize items, a few are made for each thread so that threads finishing early can steal the rest.
+    template <typename Function>
+    void parallelFor(size_t count, size_t minBatchSize, const Function& function);
+
+    // number of threads running jobs, including the thread which created the system
+    inline uint32_t getThreadCount() const { return static_cast<uint32_t>(threads.size()); }
+
+    // index of the calling thread within this system, 0 for the thread which created it
+    uint32_t getThreadIndex() const;
+
+    static const uint32_t INVALID_THREAD_INDEX = UINT32_MAX;
+
+private:
+    struct Thread;
+
+    Job* allocateJob(Thread& thread);
+    void queueJob(Thread& thread, Job* job);
+    Job* findJob(Thread& thread);
+    void execute(Thread& thread, Job* job);
+    void releaseDependents(Thread& thread);
+    void workerLoop(uint32_t index, bool pinThread);
+
+private:
+    std::vector<std::unique_ptr<Thread>> threads;
+
+    // Jobs held back until their dependency is done.  The list lives here rather than in the counter, since a counter
+    // may be destroyed as soon as a waiting thread sees it is done.
+    struct DependentJob {
+        Job* job;
+        JobCounter* dependency;
+    };
+
+    std::mutex dependentMutex;
+    std::vector<DependentJob> dependentJobs;
+    std::atomic<uint32_t> dependentCount = { 0 };
+
+    // jobs which are queued but have not been taken by a thread, used to decide whether workers may sleep
+    std::atomic<uint32_t> queuedCount = { 0 };
+    std::atomic<uint32_t> sleepingCount = { 0 };
+    std::atomic<bool> stopping = { false };
+
+    std::mutex sleepMutex;
+    std::condition_variable wakeCondition;
+};
+
+template <typename Function>
+void JobSystem::parallelFor(size_t count, size_t minBatchSize, const Function& function) {
+    const size_t batchLimit = static_cast<size_t>(getThreadCount()) * 4;
+    const size_t batchCount = std::min((count + std::max<size_t>(minBatchSize, 1) - 1) / std::max<size_t>(minBatchSize, 1), batchLimit);
+
+    if (batchCount <= 1) {
+        if (count > 0) {
+            function(size_t(0), count);
+        }
+
+        return;
+    }
+
+    const size_t batchSize = (count + batchCount - 1) / batchCount;
+    JobCounter counter;
+
+    // the calling thread takes the first range itself
+    for (size_t begin = batchSize; begin < count; begin += batchSize) {
+        const size_t end = std::min(begin + batchSize, count);
+        run([&function, begin, end]() { function(begin, end); }, &counter);
+    }
+
+    function(size_t(0), batchSize);
+    wait(counter);
+}
+
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace vkdev {
+
+/**
+Maps a file read only into the address space of the process.
+The contents are paged in by the OS as they are accessed so no copy of the file is made in user memory.
+The mapping remains valid until cleanup is called or the object is destroyed.
+*/
+class MappedFile {
+public:
+    MappedFile() = default;
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    MappedFile(MappedFile&& other) noexcept;
+    MappedFile& operator=(MappedFile&& other) noexcept;
+
+    void open(const std::string& path);
+    void cleanup();
+
+    inline const uint8_t* data() const { return mappedData; }
+    inline size_t size() const { return mappedSize; }
+    inline bool isOpen() const { return mappedData != nullptr; }
+
+private:
+    const uint8_t* mappedData = nullptr;
+    size_t mappedSize = 0;
+
+#ifdef _WIN32
+    void* fileHandle = nullptr;
+    void* mappingHandle = nullptr;
+#endif
+};
+
+}
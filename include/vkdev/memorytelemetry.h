@@ -0,0 +1,82 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <vk_mem_alloc.h>
+
+#include <nlohmann/json.hpp>
+
+#include <array>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace vkdev {
+
+enum class MemoryCategory : uint32_t {
+    Mesh,
+    Texture,
+    Uniform,
+    Staging,
+    Attachment,
+    Other,
+    Count
+};
+
+const char* memoryCategoryName(MemoryCategory category);
+
+struct MemoryCategoryStats {
+    VkDeviceSize bytes = 0;
+    VkDeviceSize peakBytes = 0;
+    uint32_t allocationCount = 0;
+};
+
+struct MemoryHeapStats {
+    VkDeviceSize size = 0;
+    bool deviceLocal = false;
+
+    // reported by VK_EXT_memory_budget.  These cover every process using the heap, not only this one.
+    VkDeviceSize budget = 0;
+    VkDeviceSize usage = 0;
+};
+
+/**
+Tracks the size of every VMA allocation made by vkdev along with the category of resource it backs.
+Allocations are registered by Buffer, Image and AttachmentAllocator so that the live byte and allocation counts per
+category can be inspected at any time.  Allocations that are still registered at shutdown indicate a leak.
+Heap budgets are read with VK_EXT_memory_budget when the device supports it.
+*/
+class MemoryTelemetry {
+public:
+    void create(VkPhysicalDevice physical_, VmaAllocator allocator_, bool budgetSupported_);
+
+    void track(VmaAllocation allocation, MemoryCategory category);
+    void untrack(VmaAllocation allocation);
+
+    MemoryCategoryStats getCategoryStats(MemoryCategory category) const;
+    std::vector<MemoryHeapStats> getHeapStats() const;
+
+    inline bool isBudgetSupported() const { return budgetSupported; }
+
+    nlohmann::json toJson() const;
+    void writeJson(const std::string& path) const;
+
+private:
+    struct TrackedAllocation {
+        MemoryCategory category;
+        VkDeviceSize size;
+    };
+
+    VkPhysicalDevice physical = VK_NULL_HANDLE;
+    VmaAllocator allocator = VK_NULL_HANDLE;
+    bool budgetSupported = false;
+
+    // allocations may be made from loader threads
+    mutable std::mutex mutex;
+    std::unordered_map<VmaAllocation, TrackedAllocation> allocations;
+    std::array<MemoryCategoryStats, static_cast<size_t>(MemoryCategory::Count)> categories;
+};
+
+}
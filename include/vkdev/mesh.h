@@ -1,8 +1,9 @@
 #pragma once
 
 #include "vkdev/buffer.h"
-#include "vkdev/commandpool.h"
 #include "vkdev/device.h"
+#include "vkdev/mappedfile.h"
+#include "vkdev/uploadmanager.h"
 #include "vkdev/bounds.h"
 
 #include <vulkan/vulkan.h>
@@ -14,30 +15,84 @@
 
 namespace vkdev {
 
+/*
+The quantized flags select a compact encoding for the corresponding attribute:
+QuantizedPositions: R16G16B16A16_UNORM relative to the mesh bounds.  Mesh::getDequantizeTransform maps them back to object space.
+QuantizedNormals: octahedral encoding stored as R16G16_SNORM.  Shaders reading normals must decode them.
+QuantizedTexCoords: R16G16_UNORM, only usable when every coordinate is within [0, 1].
+*/
 enum MeshVertexAttributes: uint32_t {
     Unset = 0,
     Positions = 1,
     Normals = 2,
-    TexCoords = 4
+    TexCoords = 4,
+    QuantizedPositions = 8,
+    QuantizedNormals = 16,
+    QuantizedTexCoords = 32
+};
+
+// an attribute of a per instance stream, given by its format and its offset within the instance
+struct InstanceAttribute {
+    VkFormat format;
+    uint32_t offset;
 };
 
 struct MeshDescription {
     VkVertexInputBindingDescription bindingDescription;
     std::vector<VkVertexInputAttributeDescription> attributeDescriptions;
+
+    // Streams advanced once per instance rather than once per vertex.  They use bindings 1 onwards, in the order they were added.
+    std::vector<VkVertexInputBindingDescription> instanceBindingDescriptions;
+
+    // Adds a VK_VERTEX_INPUT_RATE_INSTANCE binding and returns its index.  Its attributes are assigned the shader locations
+    // following the existing attributes.  Matrices are passed as one attribute per column.
+    uint32_t addInstanceBinding(uint32_t stride, const std::vector<InstanceAttribute>& attributes);
+
+    // the per vertex binding followed by any per instance bindings
+    std::vector<VkVertexInputBindingDescription> getBindingDescriptions() const;
 };
 
+/**
+Vertex and element data for a single mesh.
+When loaded from a file the data pointers refer directly into a read only mapping of the file which is owned by this
+object, so they remain valid only as long as it is alive.  Mesh::create copies the data from the mapping straight into
+staging memory.
+*/
 struct MeshData {
-    MeshVertexAttributes vertexAttributes;
-    std::vector<uint8_t> vertexBuffer;
-    uint32_t vertexCount;
+    MeshVertexAttributes vertexAttributes = MeshVertexAttributes::Unset;
+    const uint8_t* vertexData = nullptr;
+    uint32_t vertexDataSize = 0;
+    uint32_t vertexCount = 0;
 
-    std::vector<uint8_t> elementBuffer;
-    uint32_t elementCount;
-    uint32_t elementSize;
+    const uint8_t* elementData = nullptr;
+    uint32_t elementDataSize = 0;
+    uint32_t elementCount = 0;
+    uint32_t elementSize = 0;
 
     Bounds bounds;
 
+    // object space error of this level of detail relative to the full detail mesh
+    float lodError = 0.0f;
+
     void loadFromFile(const std::string& path);
+    void writeToFile(const std::string& path) const;
+
+private:
+    friend class MeshPack;
+
+    MappedFile file;
+
+    // holds decoded data when the source streams were compressed
+    std::vector<uint8_t> vertexStorage;
+    std::vector<uint8_t> elementStorage;
+};
+
+// A range of the mesh's index buffer along with the offset of its vertices in the vertex buffer
+struct MeshLod {
+    uint32_t firstIndex = 0;
+    uint32_t indexCount = 0;
+    int32_t vertexOffset = 0;
+    float error = 0.0f;
 };
 
 class Mesh {
@@ -45,11 +100,42 @@ public:
     explicit Mesh(Device& device_) : vertexBuffer(device_), indexBuffer(device_), device(device_) {}
 
     void cleanup();
-    void create(const MeshData& meshData, CommandPool& commandPool);
+    void create(const MeshData& meshData, UploadManager& uploadManager);
+
+    // Creates a mesh with a level of detail chain ordered from most to least detailed.
+    // All levels are stored in the same vertex and index buffers so they must share a vertex format and element size.
+    void create(const std::vector<MeshData>& lodData, UploadManager& uploadManager);
+
+    /*
+    Selects the least detailed level whose error projects to at most pixelError pixels on screen.  modelView must map
+    object space, before dequantization, to view space.  To avoid popping at the boundary a coarser level is only
+    selected once its error is below pixelError * (1 - hysteresis), and the current level is kept until its error
+    exceeds pixelError * (1 + hysteresis).
+    */
+    uint32_t selectLod(const glm::mat4& modelView, const glm::mat4& projection, float viewportHeight, uint32_t currentLod,
+        float pixelError = 1.0f, float hysteresis = 0.25f) const;
+
+    // error of the given level in pixels at the current view
+    float getProjectedError(uint32_t lod, const glm::mat4& modelView, const glm::mat4& projection, float viewportHeight) const;
+
+    // diameter of the bounds in pixels at the current view, measured at their nearest point so it is never underestimated
+    float getProjectedSize(const glm::mat4& modelView, const glm::mat4& projection, float viewportHeight) const;
 
     uint32_t vertexSize() const;
     MeshDescription getMeshDescription() const;
 
+    // size of a vertex with the given attributes
+    static uint32_t vertexSize(uint32_t vertexAttributes);
+
+    // every defined attribute flag, files using any other bit are rejected
+    static const uint32_t VERTEX_ATTRIBUTE_MASK = Positions | Normals | TexCoords | QuantizedPositions | QuantizedNormals | QuantizedTexCoords;
+
+    // 16 bit indices are used whenever the element size allows it
+    inline VkIndexType indexType() const { return elementSize == sizeof(uint16_t) ? VK_INDEX_TYPE_UINT16 : VK_INDEX_TYPE_UINT32; }
+
+    // Transform from vertex positions to object space.  This should be applied before the model matrix.
+    glm::mat4 getDequantizeTransform() const;
+
     Buffer vertexBuffer;
     Buffer indexBuffer;
 
@@ -59,8 +145,11 @@ public:
     uint32_t elementSize = 0;
 
     Bounds bounds;
+    std::vector<MeshLod> lods;
 
 private:
+    void createLods(const MeshData* lodData, size_t lodCount, UploadManager& uploadManager);
+
     VkVertexInputBindingDescription getBindingDescription() const;
     std::vector<VkVertexInputAttributeDescription> getAttributeDescriptions() const;
 
@@ -0,0 +1,114 @@
+#pragma once
+
+#include "vkdev/mappedfile.h"
+#include "vkdev/mesh.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace vkdev {
+
+enum class StreamEncoding : uint32_t {
+    None = 0,
+    MeshoptVertex = 1,
+    MeshoptIndex = 2
+};
+
+/*
+The structures below are stored directly in .vkpack files and must not change without bumping MeshPack::VERSION.
+All values are little endian.
+*/
+struct MeshPackHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t entryCount;
+    uint32_t entryOffset;
+};
+
+struct MeshPackStream {
+    uint64_t offset;
+    uint32_t size;
+    uint32_t decodedSize;
+    uint32_t stride;
+    StreamEncoding encoding;
+};
+
+struct MeshPackEntry {
+    char name[64];
+    uint32_t lod;
+    float lodError;
+
+    uint32_t vertexAttributes;
+    uint32_t vertexCount;
+    uint32_t elementCount;
+    uint32_t elementSize;
+
+    float boundsMin[3];
+    float boundsMax[3];
+
+    MeshPackStream vertexStream;
+    MeshPackStream elementStream;
+};
+
+static_assert(sizeof(MeshPackHeader) == 16, "MeshPackHeader layout is part of the file format");
+static_assert(sizeof(MeshPackStream) == 24, "MeshPackStream layout is part of the file format");
+static_assert(sizeof(MeshPackEntry) == 160, "MeshPackEntry layout is part of the file format");
+
+/**
+A container holding any number of meshes and their levels of detail.
+The header is followed by a table of contents with one entry per mesh LOD, which allows a single mesh to be located and
+decoded without touching the rest of the file.  Each vertex and element stream is stored either raw or compressed with
+the meshoptimizer vertex and index codecs, which decode considerably faster than the data can be read from disk.
+The file is memory mapped, so raw streams are uploaded directly from the mapping.
+*/
+class MeshPack {
+public:
+    static const uint32_t MAGIC = 0x504D4B56; // "VKMP"
+    static const uint32_t VERSION = 1;
+
+    void open(const std::string& path);
+    void cleanup();
+
+    inline uint32_t getEntryCount() const { return static_cast<uint32_t>(entries.size()); }
+    inline const MeshPackEntry& getEntry(uint32_t index) const { return entries[index]; }
+
+    // returns the index of the entry with the given name and LOD or -1 if there is none
+    int32_t findEntry(const std::string& name, uint32_t lod = 0) const;
+
+    // Fills meshData with the entry's data, decoding compressed streams.  Raw streams reference the mapping of the pack
+    // so meshData must not outlive it.
+    void loadMesh(uint32_t index, MeshData& meshData) const;
+
+    // Loads every level of detail of the named mesh in order, as expected by Mesh::create.  Returns the number of levels.
+    uint32_t loadMeshLods(const std::string& name, std::vector<MeshData>& lodData) const;
+
+private:
+    void validateEntry(const MeshPackEntry& entry) const;
+    void validateStream(const MeshPackStream& stream, uint32_t count, uint32_t stride) const;
+
+private:
+    std::string path;
+    MappedFile file;
+    std::vector<MeshPackEntry> entries;
+};
+
+/**
+Builds a .vkpack file in memory.  Meshes are compressed as they are added.
+*/
+class MeshPackWriter {
+public:
+    void addMesh(const std::string& name, uint32_t lod, float lodError, const MeshData& meshData, bool compress = true);
+    void write(const std::string& path) const;
+
+    inline uint32_t getEntryCount() const { return static_cast<uint32_t>(entries.size()); }
+
+private:
+    MeshPackStream addStream(const uint8_t* data, uint32_t size, uint32_t count, uint32_t stride, StreamEncoding encoding);
+
+private:
+    std::vector<MeshPackEntry> entries;
+    std::vector<uint8_t> streamData;
+};
+
+}
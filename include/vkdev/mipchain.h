@@ -0,0 +1,18 @@
+#pragma once
+
+#include <cstdint>
+
+namespace vkdev::MipChain {
+    // number of levels in a full mip chain, down to 1x1
+    uint32_t getLevelCount(uint32_t width, uint32_t height);
+
+    /*
+    Halves a tightly packed RGBA8 image with a 2x2 box filter, writing rows [firstRow, lastRow) of the destination so that a
+    level can be split across threads.  For sRGB images the color channels are converted to linear before they are
+    averaged and back afterwards, alpha is always averaged as stored.  Odd dimensions drop the source's last row or column.
+    */
+    void downsample(const uint8_t* source, uint32_t sourceWidth, uint32_t sourceHeight, uint8_t* destination, uint32_t firstRow, uint32_t lastRow, bool srgb);
+
+    // name of the instruction set the kernels were compiled for
+    const char* getSimdName();
+}
@@ -6,6 +6,7 @@
 #include "vkdev/shader.h"
 
 #include <memory>
+#include <vector>
 
 namespace vkdev {
 
@@ -22,6 +23,8 @@ private:
     Device& device;
 };
 
-std::unique_ptr<Pipeline> createDefaultPipeline(Device& device, Shader& shader, MeshDescription& meshDescription, SwapChainRenderTarget& renderTarget);
+// additional set layouts are appended after the shader's descriptor set layout, which is always set 0
+std::unique_ptr<Pipeline> createDefaultPipeline(Device& device, Shader& shader, MeshDescription& meshDescription, RenderTarget& renderTarget,
+                                                const std::vector<VkDescriptorSetLayout>& additionalSetLayouts = {});
 
 }
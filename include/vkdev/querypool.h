@@ -0,0 +1,78 @@
+#pragma once
+
+#include "vkdev/device.h"
+
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace vkdev {
+
+class CommandPool;
+
+/**
+Records GPU timestamps around named scopes (render passes, uploads, etc).
+The pool is divided into a ring of slots, one per frame in flight, so that results for a frame can be read back
+once that frame's fence has signaled without waiting on frames that are still executing.
+An additional slot is reserved for upload command buffers which are timed individually.
+*/
+class TimestampQueryPool {
+public:
+    explicit TimestampQueryPool(Device& device_) : device(device_) {}
+
+    // slotCount should match the number of frames in flight.  maxScopes is the number of scopes that can be timed per slot
+    void create(CommandPool& commandPool, uint32_t slotCount, uint32_t maxScopes);
+    void cleanup();
+
+    // returns false if the graphics queue does not support timestamps, in which case all recording functions are no-ops
+    inline bool isSupported() const { return supported; }
+
+    // resets all queries belonging to the slot.  Must be recorded outside of a render pass and before any scopes for the slot are written
+    void reset(VkCommandBuffer commandBuffer, uint32_t slot);
+    void beginScope(VkCommandBuffer commandBuffer, uint32_t slot, const std::string& name, VkPipelineStageFlagBits stage = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT);
+    void endScope(VkCommandBuffer commandBuffer, uint32_t slot, const std::string& name, VkPipelineStageFlagBits stage = VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT);
+
+    // Reads back results for the slot without blocking.  Scopes whose queries are not yet available keep their previous value.
+    // This should be called after the fence for the frame that used the slot has been waited on.
+    bool collect(uint32_t slot);
+
+    // used by SingleUseCommandBuffer to time individual uploads
+    void beginUpload(VkCommandBuffer commandBuffer);
+    void endUpload(VkCommandBuffer commandBuffer);
+    void collectUpload();
+
+    // returns the most recently collected GPU time for the scope, or 0 if no results have been collected yet
+    double getMilliseconds(const std::string& name) const;
+    inline const std::unordered_map<std::string, double>& getResults() const { return results; }
+
+    inline double getTotalUploadMilliseconds() const { return totalUploadMilliseconds; }
+    inline uint32_t getUploadCount() const { return uploadCount; }
+
+    VkQueryPool handle = VK_NULL_HANDLE;
+
+private:
+    uint32_t getScopeIndex(const std::string& name);
+    inline uint32_t queryIndex(uint32_t slot, uint32_t scope, uint32_t end) const { return (slot * maxScopes + scope) * 2 + end; }
+    double ticksToMilliseconds(uint64_t begin, uint64_t end) const;
+
+private:
+    Device& device;
+
+    bool supported = false;
+    uint32_t slotCount = 0;
+    uint32_t maxScopes = 0;
+    uint32_t uploadSlot = 0;
+    double timestampPeriod = 1.0; // nanoseconds per tick
+    uint64_t timestampMask = ~0ULL;
+
+    std::vector<std::string> scopeNames;
+    std::unordered_map<std::string, double> results;
+
+    double totalUploadMilliseconds = 0.0;
+    uint32_t uploadCount = 0;
+};
+
+}
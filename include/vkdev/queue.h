@@ -14,6 +14,9 @@ struct Queue {
 
     static uint32_t findGraphicsQueueIndex(VkPhysicalDevice physicalDevice);
     static uint32_t findPresentationQueueIndex(VkPhysicalDevice physicalDevice, VkSurfaceKHR surface);
+
+    // returns the index of a transfer only queue family if the device exposes one, otherwise the graphics queue family index
+    static uint32_t findTransferQueueIndex(VkPhysicalDevice physicalDevice);
 };
 
 }
@@ -1,27 +1,93 @@
 #pragma once
 
 #include "vkdev/commandpool.h"
-#include "vkdev/descriptor.h"
 #include "vkdev/device.h"
-#include "vkdev/mesh.h"
-#include "vkdev/pipeline.h"
+#include "vkdev/jobsystem.h"
+#include "vkdev/querypool.h"
+#include "vkdev/queue.h"
+#include "vkdev/renderqueue.h"
 #include "vkdev/rendertarget.h"
 
+#include <chrono>
+#include <memory>
 #include <vector>
 
 namespace vkdev{
 
+/**
+Records the commands drawn by each frame in flight.
+Every frame in flight has its own command pool, created with VK_COMMAND_POOL_CREATE_TRANSIENT_BIT, and a single command
+buffer allocated from it.  Each frame the pool is reset and the buffer is recorded again from that frame's render queue,
+so the commands always match the scene being drawn.  Resetting the pool releases everything recorded into it at once
+rather than resetting buffers one at a time.
+Large render queues are split into contiguous ranges of sorted packets which are recorded in parallel as jobs.  Each
+range is recorded into a secondary command buffer allocated from its own pool for the frame, since a pool may only be
+used by one thread at a time, and the primary buffer executes them in range order with vkCmdExecuteCommands.
+The CPU time spent recording each frame is measured.
+*/
 class RenderCommand{
 public:
-    RenderCommand(Device& device_, CommandPool& commandPool_): device(device_), commandPool(commandPool_) {}
+    using Clock = std::chrono::steady_clock;
 
-    void create(SwapChainRenderTarget& renderTarget, Pipeline& piepline, Mesh& mesh, Descriptor& descriptor);
+    RenderCommand(Device& device_, const Queue& queue_): device(device_), queue(queue_) {}
+
+    // Creates the command pools and command buffers of each frame in flight.  The frame in flight also selects which timestamp query slot is written.
+    void create(RenderTarget& renderTarget_, uint32_t frameCount, TimestampQueryPool* timestamps_ = nullptr);
     void cleanup();
 
+    // Resets the frame's command pools and records the render queue into the frame's command buffer, drawing into the given render target image.
+    // The queue should already be sorted.  The frame's previous submission must have completed.
+    VkCommandBuffer record(uint32_t frameIndex, uint32_t imageIndex, RenderQueue& renderQueue);
+
+    inline VkCommandBuffer getCommandBuffer(uint32_t frameIndex) const { return commandBuffers[frameIndex]; }
+
+    // counts of the commands recorded by the last record
+    inline const RenderQueueStats& getStats() const { return stats; }
+
+    // number of ranges the last record was split into, 1 when it was recorded inline into the primary buffer
+    inline uint32_t getLastRangeCount() const { return lastRangeCount; }
+
+    inline double getLastRecordMilliseconds() const { return lastRecordMilliseconds; }
+    inline double getMaxRecordMilliseconds() const { return maxRecordMilliseconds; }
+    inline double getAverageRecordMilliseconds() const { return recordCount > 0 ? totalRecordMilliseconds / recordCount : 0.0; }
+    inline uint64_t getRecordCount() const { return recordCount; }
+
+    // if set, large render queues are recorded in parallel on the threads of the job system.  Must be set before create.
+    JobSystem* jobSystem = nullptr;
+
+    // maximum number of ranges recorded in parallel, 0 makes one for each thread of the job system.  Must be set before create.
+    uint32_t threadCount = 0;
+
+    // render queues with fewer packets than this are recorded on the calling thread
+    size_t parallelThreshold = 1024;
+
+    // indexed by frame in flight
     std::vector<VkCommandBuffer> commandBuffers;
+
+private:
+    void recordSecondary(uint32_t frameIndex, uint32_t range, VkFramebuffer framebuffer, const RenderQueue& renderQueue, size_t first, size_t count);
+
 private:
     Device& device;
-    CommandPool& commandPool;
+    const Queue& queue;
+
+    RenderTarget* renderTarget = nullptr;
+    TimestampQueryPool* timestamps = nullptr;
+    std::vector<std::unique_ptr<CommandPool>> commandPools;
+
+    // one pool and secondary buffer per range for each frame in flight, indexed by frameIndex * maxRanges + range
+    uint32_t maxRanges = 1;
+    std::vector<std::unique_ptr<CommandPool>> rangePools;
+    std::vector<VkCommandBuffer> secondaryBuffers;
+    std::vector<RenderQueueStats> rangeStats;
+
+    RenderQueueStats stats;
+    uint32_t lastRangeCount = 0;
+
+    double lastRecordMilliseconds = 0.0;
+    double maxRecordMilliseconds = 0.0;
+    double totalRecordMilliseconds = 0.0;
+    uint64_t recordCount = 0;
 };
 
 }
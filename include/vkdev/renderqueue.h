@@ -0,0 +1,110 @@
+#pragma once
+
+#include "vkdev/descriptor.h"
+#include "vkdev/gpuculler.h"
+#include "vkdev/instancebatcher.h"
+#include "vkdev/mesh.h"
+#include "vkdev/pipeline.h"
+
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+namespace vkdev {
+
+/*
+A single draw submitted to a render queue.  The descriptor is bound to set 0 with the dynamic offset.
+If gpuCuller or instanceBatcher is set the draw is delegated to it, in which case the mesh is not bound by the queue.
+Depth should be a non negative distance from the camera, packets which otherwise share state are drawn front to back.
+*/
+struct DrawPacket {
+    Pipeline* pipeline = nullptr;
+    Descriptor* descriptor = nullptr;
+    uint32_t dynamicOffset = 0;
+    Mesh* mesh = nullptr;
+
+    uint32_t lod = 0;
+    uint32_t instanceCount = 1;
+    float depth = 0.0f;
+
+    GpuCuller* gpuCuller = nullptr;
+    InstanceBatcher* instanceBatcher = nullptr;
+};
+
+// counts of the commands recorded by RenderQueue::record
+struct RenderQueueStats {
+    uint32_t packetCount = 0;
+    uint32_t pipelineBinds = 0;
+    uint32_t descriptorBinds = 0;
+    uint32_t meshBinds = 0;
+    uint32_t drawCount = 0;
+};
+
+/**
+A list of draw packets for a single frame in flight which is sorted to minimize state changes before it is recorded.
+Each packet is given a 64 bit key holding, from the most significant bits, the pipeline, descriptor set, mesh and
+depth, so that sorting the keys groups packets by the most expensive state first.  The keys are sorted with an 8 bit
+LSD radix sort, skipping digits which are the same for every key.  Recording then only binds state which differs from
+the previous packet.
+The queue is cleared and filled again every frame, so each packet carries the level of detail and instance count it is drawn with.
+*/
+class RenderQueue {
+public:
+    void create(uint32_t maxPackets_);
+    void cleanup();
+
+    // removes every packet.  Ids given to pipelines, descriptors and meshes are kept so keys stay stable between frames.
+    void clear();
+
+    // Forgets the ids given to pipelines, descriptors and meshes.  Must be called when any of them are destroyed, since a
+    // new object may be created at the address of a destroyed one.
+    void resetIds();
+
+    // Adds a packet and returns its handle, which is valid until the queue is cleared
+    uint32_t submit(const DrawPacket& packet);
+
+    void sort();
+
+    // Records work which must happen outside of a render pass, such as the dispatches of GPU culled packets
+    void recordCompute(VkCommandBuffer commandBuffer, uint32_t frameIndex);
+
+    // Records count packets in sorted order, starting from the first, into a render pass and returns the counts of the recorded commands.
+    // No state is assumed to be bound beforehand.  Ranges which do not overlap can be recorded into different command buffers concurrently.
+    RenderQueueStats record(VkCommandBuffer commandBuffer, uint32_t frameIndex, size_t first, size_t count) const;
+
+    inline size_t size() const { return packets.size(); }
+    inline bool hasComputeWork() const { return gpuCulledPacketCount > 0; }
+
+    // bit widths of the key fields.  Ids which do not fit wrap around, which only costs redundant binds.
+    static const uint32_t PIPELINE_BITS = 12;
+    static const uint32_t DESCRIPTOR_BITS = 16;
+    static const uint32_t MESH_BITS = 16;
+    static const uint32_t DEPTH_BITS = 20;
+
+    static uint64_t makeKey(uint32_t pipelineId, uint32_t descriptorId, uint32_t meshId, float depth);
+
+private:
+    uint32_t getId(std::unordered_map<const void*, uint32_t>& ids, const void* object);
+
+private:
+    uint32_t maxPackets = 0;
+
+    std::vector<DrawPacket> packets;
+    std::vector<uint64_t> keys;
+
+    // packet indices in draw order, along with scratch space for the radix sort
+    std::vector<uint32_t> order;
+    std::vector<uint64_t> sortKeys;
+    std::vector<uint64_t> keyScratch;
+    std::vector<uint32_t> orderScratch;
+
+    std::unordered_map<const void*, uint32_t> pipelineIds;
+    std::unordered_map<const void*, uint32_t> descriptorIds;
+    std::unordered_map<const void*, uint32_t> meshIds;
+
+    uint32_t gpuCulledPacketCount = 0;
+};
+
+}
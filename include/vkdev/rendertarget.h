@@ -1,6 +1,7 @@
 #pragma once
 
 #include "vkdev/assets.h"
+#include "vkdev/attachmentallocator.h"
 #include "vkdev/commandpool.h"
 #include "vkdev/device.h"
 #include "vkdev/swapchain.h"
@@ -17,30 +18,73 @@ VkFramebuffer defines which VkImageView is to be which attachment.
 VkImageView defines which part of VkImage to use.
 VkImage defines which VkMemory is used and a format of the texel
 */
-class SwapChainRenderTarget {
+class RenderTarget {
 public:
-    explicit SwapChainRenderTarget(Device& device_) : device(device_) {}
+    explicit RenderTarget(Device& device_) : device(device_), attachmentAllocator(device_) {}
+    virtual ~RenderTarget() = default;
 
-    void create(SwapChain& swapchain_, CommandPool& commandPool);
+    // Destroys the render pass, framebuffers and attachments.  The attachment memory is kept for reuse if the target is created again.
+    virtual void cleanup();
 
-    void cleanup();
+    // Frees the memory kept for the attachments.  Call after the final cleanup.
+    void cleanupAttachmentMemory();
 
-    VkRenderPass renderPass;
+    VkRenderPass renderPass = VK_NULL_HANDLE;
     std::vector<VkFramebuffer> framebuffers;
 
+    VkExtent2D extent = { 0, 0 };
+    VkFormat colorFormat = VK_FORMAT_UNDEFINED;
     VkSampleCountFlagBits msaaSampleCount = VK_SAMPLE_COUNT_4_BIT;
-    SwapChain* swapchain = nullptr;
 
-private:
-    void createImages(CommandPool& commandPool, VkFormat depthFormat);
-    void createRenderPass(VkFormat depthFormat);
-    void createFramebuffers();
+protected:
+    // creates the multisampled color and depth images which are shared by all framebuffers
+    void createImages(VkFormat depthFormat);
+
+    // finalLayout is the layout the resolved color attachment will be left in at the end of the render pass
+    void createRenderPass(VkFormat depthFormat, VkImageLayout finalLayout);
+    void createFramebuffers(const std::vector<VkImageView>& resolveViews);
+
+    static VkFormat findDepthFormat(Device& device);
 
-private:
+protected:
     Device& device;
+    AttachmentAllocator attachmentAllocator;
 
     std::unique_ptr<vkdev::Image> depthImage;
     std::unique_ptr<vkdev::Image> msaaColorImage;
 };
 
-}
\ No newline at end of file
+class SwapChainRenderTarget : public RenderTarget {
+public:
+    explicit SwapChainRenderTarget(Device& device_) : RenderTarget(device_) {}
+
+    void create(SwapChain& swapchain_);
+
+    SwapChain* swapchain = nullptr;
+};
+
+/**
+Offscreen render target which resolves into device local color images instead of swap chain images.
+This allows rendering without a window or a presentation capable device.
+Since nothing is presented, the target also owns the fences used to pace frames in flight.
+*/
+class OffscreenRenderTarget : public RenderTarget {
+public:
+    explicit OffscreenRenderTarget(Device& device_) : RenderTarget(device_) {}
+
+    void create(const VkExtent2D& extent_, VkFormat colorFormat_, uint32_t imageCount);
+    void cleanup() override;
+
+    void createSyncObjects();
+    void cleanupSyncObjects();
+
+    // mirrors SwapChain::aquireFrame / SwapChain::drawFrame.  No presentation takes place so the result is always VK_SUCCESS
+    VkResult aquireFrame(uint32_t& index);
+    VkResult drawFrame(uint32_t imageIndex, VkCommandBuffer commandBuffer);
+
+    std::vector<std::unique_ptr<vkdev::Image>> colorImages;
+    std::vector<VkFence> inFlightFences;
+    size_t currentFrameIndex = 0;
+};
+
+}
@@ -10,6 +10,9 @@
 
 namespace vkdev {
 
+std::vector<char> readFile(const std::string& path);
+VkShaderModule createShaderModule(const std::vector<char>& code, Device& device);
+
 struct Uniform {
     std::string name;
     VkDescriptorType type;
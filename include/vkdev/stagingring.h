@@ -0,0 +1,59 @@
+#pragma once
+
+#include "vkdev/buffer.h"
+#include "vkdev/device.h"
+
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+#include <deque>
+
+namespace vkdev {
+
+/**
+A fixed size staging buffer which is created and mapped once and sub-allocated as a ring.
+Allocations made since the last call to retire are tagged with the id of the batch that will consume them.
+Once that batch has completed, its regions can be released and reused.
+*/
+class StagingRing {
+public:
+    struct Allocation {
+        VkDeviceSize offset = 0;
+        VkDeviceSize size = 0;
+        uint8_t* data = nullptr;
+    };
+
+    explicit StagingRing(Device& device_) : buffer(device_) {}
+
+    void create(VkDeviceSize capacity);
+    void cleanup();
+
+    // Returns false if there is no contiguous region of the requested size available.
+    bool allocate(VkDeviceSize size, VkDeviceSize alignment, Allocation& allocation);
+
+    // Associates all allocations made since the last call with batchId
+    void retire(uint64_t batchId);
+
+    // Releases the regions of all batches up to and including completedBatchId
+    void release(uint64_t completedBatchId);
+
+    inline VkDeviceSize getCapacity() const { return buffer.size; }
+    inline bool isEmpty() const { return retired.empty() && !hasUnretired; }
+
+    Buffer buffer;
+
+private:
+    struct RetiredRegion {
+        uint64_t batchId;
+        VkDeviceSize end;
+    };
+
+    // head is where the next allocation is made, tail is the start of the oldest region still in use
+    VkDeviceSize head = 0;
+    VkDeviceSize tail = 0;
+    bool hasUnretired = false;
+
+    std::deque<RetiredRegion> retired;
+};
+
+}
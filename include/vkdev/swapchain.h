@@ -18,13 +18,23 @@ namespace vkdev {
         void cleanupImages();
         void cleanupSyncObjects();
 
+        // waits until the current frame in flight is no longer in use by the GPU
+        void waitForFrame();
+
+        // waitForFrame must have been called for the current frame, the frame's fence is not waited on again here
         VkResult aquireFrame(uint32_t& index);
         VkResult drawFrame(uint32_t imageIndex, VkCommandBuffer commandBuffer);
 
         void createSyncObjects();
 
-        static const int MAX_SIMULTANEOUS_FRAMES = 2;
+        static const uint32_t DEFAULT_FRAMES_IN_FLIGHT = 2;
     public:
+        // both of these should be set before calling create / createSyncObjects.
+        // If the preferred present mode is not supported by the surface, MAILBOX then FIFO will be used.
+        VkPresentModeKHR preferredPresentMode = VK_PRESENT_MODE_MAILBOX_KHR;
+        uint32_t framesInFlight = DEFAULT_FRAMES_IN_FLIGHT;
+
+        VkPresentModeKHR presentMode = VK_PRESENT_MODE_FIFO_KHR;
         VkSwapchainKHR handle;
         VkFormat imageFormat;
         VkExtent2D extent;
@@ -1,11 +1,79 @@
 #pragma once
 
-#include "vkdev/commandpool.h"
 #include "vkdev/device.h"
 #include "vkdev/image.h"
+#include "vkdev/mappedfile.h"
+#include "vkdev/uploadmanager.h"
 
+#include <cstdint>
+#include <memory>
 #include <string>
+#include <vector>
+
+namespace vkdev {
+
+class JobSystem;
+
+/**
+Texture data decoded from an image file.
+Common image formats are decoded to RGBA8 pixels whose mip levels are generated when the texture is created.  KTX2 files
+are mapped rather than decoded and provide every mip level, possibly in a block compressed format, so that they can be
+copied straight into the image.
+Decoding does not touch the device, so it may happen on any thread.  The data is freed when the object is destroyed.
+*/
+struct TextureData {
+    uint32_t width = 0;
+    uint32_t height = 0;
+    VkFormat format = VK_FORMAT_R8G8B8A8_UNORM;
+
+    // location of each mip level within the data, starting with level 0
+    std::vector<ImageLevel> levels;
+
+    // set when only level 0 is provided and the remaining levels are generated on the GPU
+    bool generateMipmaps = true;
+
+    // loads files with a .ktx2 extension with loadKtx2, and any other image with stb_image
+    void loadFromFile(const std::string& path);
+
+    // Maps a KTX2 file.  Supercompressed files as well as cube maps, arrays and 3D textures are not supported.
+    void loadKtx2(const std::string& path);
+
+    // decodes block compressed data to RGBA8 for devices which can not sample its format
+    TextureData decompress() const;
+
+    // Replaces the mip levels with a full chain built from level 0 on the CPU, filtered in linear space for sRGB formats.
+    // Only RGBA8 data is supported.  Each level's rows are split across the job system's threads when one is given.
+    void buildMipChain(JobSystem* jobSystem = nullptr);
+
+    // writes the data as a KTX2 file which holds every mip level, only RGBA8 data can be written
+    void writeKtx2(const std::string& path) const;
+
+    inline const uint8_t* getData() const { return data; }
+    inline VkDeviceSize getSize() const { return size; }
+
+private:
+    struct PixelDeleter {
+        void operator()(uint8_t* data) const;
+    };
+
+    const uint8_t* data = nullptr;
+    VkDeviceSize size = 0;
+
+    // the data is owned by exactly one of these
+    std::unique_ptr<uint8_t, PixelDeleter> pixels;
+    MappedFile file;
+    std::vector<uint8_t> storage;
+};
+
+namespace Texture {
+    // Creates an image from decoded texture data.  The data is copied into staging memory, so it may be freed once this returns.
+    // Block compressed data is decompressed if the device does not support its format.
+    Image create(const TextureData& data, Device& device, UploadManager& uploadManager);
+
+    Image createFromFile(const std::string& path, Device& device, UploadManager& uploadManager);
+
+    // true if images of the format can be created with optimal tiling and sampled
+    bool isFormatSupported(Device& device, VkFormat format);
+}
 
-namespace vkdev::Texture {
-    Image createFromFile(const std::string& path, Device& device, CommandPool& commandPool);
 }
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+
+namespace vkdev::TextureFormat {
+    // Dimensions in texels of the blocks a format is stored in, 1x1 for uncompressed formats
+    VkExtent2D getBlockExtent(VkFormat format);
+
+    // Size in bytes of one block, or one texel for uncompressed formats.  0 for formats textures can not be loaded in.
+    uint32_t getBlockSize(VkFormat format);
+
+    // size in bytes of a tightly packed image of the given dimensions
+    uint64_t getImageSize(VkFormat format, uint32_t width, uint32_t height);
+
+    bool isBlockCompressed(VkFormat format);
+    bool isSrgb(VkFormat format);
+
+    // BC1, BC3, BC4, BC5 and BC7 blocks can be decoded on the CPU for devices without support for them.  ASTC can not.
+    bool canDecompress(VkFormat format);
+
+    // the RGBA8 format blocks of a decompressible format decode to, keeping its sRGB encoding
+    VkFormat getDecompressedFormat(VkFormat format);
+
+    // Decodes one block into 4x4 RGBA8 texels, row by row.  Formats with fewer channels fill green and blue with 0 and alpha with 255.
+    void decompressBlock(VkFormat format, const uint8_t* block, uint8_t* texels);
+}
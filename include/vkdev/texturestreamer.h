@@ -0,0 +1,183 @@
+#pragma once
+
+#include "vkdev/descriptor.h"
+#include "vkdev/device.h"
+#include "vkdev/image.h"
+#include "vkdev/texture.h"
+#include "vkdev/uploadmanager.h"
+
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace vkdev {
+
+/**
+Keeps only the mip levels of textures which are needed on screen resident, within a memory budget.
+Each texture's data stays on the CPU, usually a mapped KTX2 file, and its tail of levels no larger than tailSize is always
+resident in an image of its own.  More detailed levels are held in a second image covering every level from the most
+detailed one resident down to the level above the tail, which is rebuilt whenever the resident level changes since
+images can not grow.  While a detail image is bound, sampling is clamped to its smallest level rather than reaching
+into the tail.
+Textures are requested every frame with the number of pixels they cover, and the detail image of the most recently
+requested texture missing levels is created with only its new levels staged, a few rows at a time so that no more than
+uploadBytesPerFrame are staged each frame.  The levels which were already resident are copied from the current detail
+image on the GPU.  Once its upload has completed it replaces the current image in every descriptor it is bound to.
+When the budget is exceeded the least recently requested textures holding more levels than they need are trimmed to the
+level they still need by copying it into a smaller image, or drop back to their tail if they are no longer requested.
+Replaced images and descriptor sets are destroyed once the frames in flight which may use them have completed, so
+descriptors bound to streamed textures must be created with room for framesInFlight + 1 sets.
+*/
+class TextureStreamer {
+public:
+    TextureStreamer(Device& device_, UploadManager& uploadManager_): device(device_), uploadManager(uploadManager_) {}
+
+    void create(uint32_t framesInFlight_);
+
+    // Destroys every texture.  The device must be idle.
+    void cleanup();
+
+    // Takes ownership of the texture data and creates its tail image.  Levels which are not provided are built on the CPU.
+    // Returns the texture's handle.
+    uint32_t add(TextureData&& data);
+
+    // the image currently holding the texture's most detailed resident levels
+    Image& getImage(uint32_t texture);
+
+    // The image sampled through the descriptor's uniformName is replaced whenever the texture's resident levels change.
+    // The descriptor should have been created with getImage.
+    void bind(uint32_t texture, Descriptor& descriptor, const std::string& uniformName);
+
+    // Requests the levels needed to draw the texture covering screenPixels pixels this frame, assuming it is mapped once
+    // across that area.  A texture requested several times in a frame uses the largest request.
+    void request(uint32_t texture, float screenPixels);
+
+    // Completes finished uploads, evicts textures when over budget and stages the next rows.  Called once per frame
+    // after the requests were made and after the fence of the frame being recorded has been waited on.
+    void update();
+
+    // most detailed level of the texture which is resident
+    uint32_t getResidentLevel(uint32_t texture) const;
+    inline uint32_t getTextureCount() const { return static_cast<uint32_t>(textures.size()); }
+
+    // memory held by resident images and images being uploaded
+    inline VkDeviceSize getResidentSize() const { return residentSize; }
+
+    // memory held by replaced images until the frames in flight using them have completed, which counts against the budget
+    inline VkDeviceSize getRetiredSize() const { return retiredSize; }
+    inline VkDeviceSize getTotalUploadBytes() const { return totalUploadBytes; }
+    inline VkDeviceSize getMaxFrameUploadBytes() const { return maxFrameUploadBytes; }
+    inline uint64_t getEvictionCount() const { return evictionCount; }
+
+    // memory the images of streamed textures may use
+    VkDeviceSize memoryBudget = 256 * 1024 * 1024;
+
+    // maximum number of bytes staged per update, a single row of blocks is always staged so that uploads progress
+    VkDeviceSize uploadBytesPerFrame = 4 * 1024 * 1024;
+
+    // levels whose width and height are no larger than this are always resident
+    uint32_t tailSize = 64;
+
+private:
+    struct Binding {
+        Descriptor* descriptor;
+        std::string uniformName;
+    };
+
+    struct StreamedTexture {
+        TextureData data;
+        uint32_t levelCount = 0;
+        uint32_t tailLevel = 0;
+
+        std::unique_ptr<Image> tailImage;
+
+        // levels [detailLevel, tailLevel) when set
+        std::unique_ptr<Image> detailImage;
+        uint32_t detailLevel = 0;
+
+        uint32_t requestedLevel = 0;
+        uint64_t requestFrame = 0;
+
+        // The detail image being uploaded, holding levels [pendingLevel, tailLevel).  Levels [pendingLevel, copyLevel)
+        // are staged from the smallest up, uploadLevel and uploadBlockRow are the next rows to stage.  The remaining
+        // levels are copied from the detail image once every row is staged, and batchId is set once that has been submitted.
+        std::unique_ptr<Image> pendingImage;
+        uint32_t pendingLevel = 0;
+        uint32_t copyLevel = 0;
+        uint32_t uploadLevel = 0;
+        uint32_t uploadBlockRow = 0;
+        uint64_t batchId = 0;
+
+        // set while the pending image is a trimmed copy of the detail image
+        bool trimming = false;
+
+        std::vector<Binding> bindings;
+    };
+
+    struct RetiredImage {
+        std::unique_ptr<Image> image;
+        uint64_t retireFrame;
+        VkDeviceSize size;
+    };
+
+    // size of levels [firstLevel, endLevel) of the texture
+    static VkDeviceSize getLevelsSize(const StreamedTexture& texture, uint32_t firstLevel, uint32_t endLevel);
+
+    // size of a detail image holding levels [firstLevel, tailLevel)
+    static VkDeviceSize getDetailSize(const StreamedTexture& texture, uint32_t firstLevel);
+    static uint32_t getResidentLevel(const StreamedTexture& texture);
+
+    // the level the texture needs this frame, unrequested textures only need their tail
+    uint32_t getWantedLevel(const StreamedTexture& texture) const;
+
+    std::unique_ptr<Image> createImage(const StreamedTexture& texture, uint32_t firstLevel, uint32_t endLevel);
+
+    // images bound to descriptors are only replaced once per frame, which bounds the number of descriptor sets in use
+    bool canReplace(const StreamedTexture& texture) const;
+    void replaceDetailImage(StreamedTexture& texture, std::unique_ptr<Image> image, uint32_t level);
+
+    void releaseRetired();
+    void completeUploads();
+
+    // Evicts the least recently requested texture holding more levels than it needs.  Returns false if there is none.
+    bool evict(const StreamedTexture* exclude);
+
+    // records the copy of the resident levels into the texture's pending image, which completes it
+    void finishImage(StreamedTexture& texture);
+
+    // picks the next texture to upload and creates its image, evicting other textures to make room for it
+    StreamedTexture* beginUpload();
+
+    // stages rows of the texture's pending image until uploadBytesPerFrame is reached, returns true once every row is staged
+    bool uploadRows(StreamedTexture& texture, VkDeviceSize& frameUploadBytes);
+
+private:
+    Device& device;
+    UploadManager& uploadManager;
+
+    uint32_t framesInFlight = 0;
+    uint64_t frame = 1;
+
+    std::vector<std::unique_ptr<StreamedTexture>> textures;
+    StreamedTexture* uploading = nullptr;
+
+    // textures whose pending image is complete once the current batch is submitted
+    std::vector<StreamedTexture*> finishedUploads;
+
+    std::vector<RetiredImage> retiredImages;
+
+    // the frame each bound descriptor last had an image replaced
+    std::vector<std::pair<Descriptor*, uint64_t>> descriptorReplaceFrames;
+
+    VkDeviceSize residentSize = 0;
+    VkDeviceSize retiredSize = 0;
+    VkDeviceSize totalUploadBytes = 0;
+    VkDeviceSize maxFrameUploadBytes = 0;
+    uint64_t evictionCount = 0;
+};
+
+}
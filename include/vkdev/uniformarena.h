@@ -0,0 +1,65 @@
+#pragma once
+
+#include "vkdev/buffer.h"
+#include "vkdev/device.h"
+
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+#include <vector>
+
+namespace vkdev {
+
+/**
+A single persistently mapped uniform buffer divided into one region per frame in flight.
+Each region is bump allocated and the resulting offsets are used as dynamic offsets when binding a descriptor set whose
+uniform buffers are of type VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC.  This allows any number of objects to share a
+single descriptor set and never requires the memory to be mapped or unmapped.
+The memory is host visible and device local when the device supports it.
+*/
+class UniformArena {
+public:
+    struct Allocation {
+        // offset from the start of the buffer, suitable for use as a dynamic offset
+        uint32_t offset = 0;
+        void* data = nullptr;
+    };
+
+    explicit UniformArena(Device& device_) : buffer(device_), device(device_) {}
+
+    static const VkDeviceSize DEFAULT_FRAME_CAPACITY = 256 * 1024;
+
+    void create(uint32_t frameCount, VkDeviceSize frameCapacity = DEFAULT_FRAME_CAPACITY);
+    void cleanup();
+
+    // Allocates size bytes from the region for frameIndex.  The offset is aligned to minUniformBufferOffsetAlignment.
+    Allocation allocate(uint32_t frameIndex, VkDeviceSize size);
+
+    template <typename T>
+    uint32_t push(uint32_t frameIndex, const T& value) {
+        Allocation allocation = allocate(frameIndex, sizeof(T));
+        *static_cast<T*>(allocation.data) = value;
+        return allocation.offset;
+    }
+
+    // Releases all allocations for the frame.  Must only be called once the GPU has finished with the frame.
+    void reset(uint32_t frameIndex);
+
+    // Makes writes to the frame's region visible to the device.  This is a no-op for host coherent memory.
+    void flush(uint32_t frameIndex);
+
+    inline uint32_t getFrameCount() const { return static_cast<uint32_t>(frameOffsets.size()); }
+
+    Buffer buffer;
+
+private:
+    Device& device;
+
+    VkDeviceSize alignment = 1;
+    VkDeviceSize frameCapacity = 0;
+
+    std::vector<VkDeviceSize> frameOffsets;
+    std::vector<VkDeviceSize> frameUsed;
+};
+
+}
@@ -0,0 +1,124 @@
+#pragma once
+
+#include "vkdev/buffer.h"
+#include "vkdev/commandpool.h"
+#include "vkdev/device.h"
+#include "vkdev/image.h"
+#include "vkdev/stagingring.h"
+
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <vector>
+
+namespace vkdev {
+
+class TimestampQueryPool;
+
+/**
+Batches buffer and image uploads into a single submission.
+Copies are recorded on the dedicated transfer queue when the device has one.  In that case ownership of the destination
+resources is released by the transfer queue and acquired by the graphics queue in a second command buffer which waits on
+a semaphore signaled by the transfer submission.  Mipmap generation also happens in that second command buffer since
+blits require graphics capability.
+Completion of a batch is signaled with a fence rather than idling the queue.
+Source data is copied through a persistently mapped staging ring.  Uploads larger than a chunk are split into several
+copies, and if the ring is full the current batch is submitted and the oldest batch is waited on to free up space.
+*/
+class UploadManager {
+public:
+    explicit UploadManager(Device& device_) : device(device_), transferPool(device_, device_.transferQueue), graphicsPool(device_, device_.graphicsQueue), stagingRing(device_) {}
+
+    static const VkDeviceSize DEFAULT_STAGING_CAPACITY = 32 * 1024 * 1024;
+
+    void create(VkDeviceSize stagingCapacity = DEFAULT_STAGING_CAPACITY);
+    void cleanup();
+
+    // Records a copy of data into dst.  dstAccess and dstStage describe how the buffer will be consumed after the upload
+    void uploadBuffer(const void* data, VkDeviceSize size, Buffer& dst, VkAccessFlags dstAccess, VkPipelineStageFlags dstStage, VkDeviceSize dstOffset = 0);
+
+    // Records a copy of data into mip level 0 of the image.  The image must have been created with undefined layout and
+    // will be left in VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, with the remaining mip levels generated if requested.
+    void uploadImage(const void* data, VkDeviceSize size, Image& dst, bool generateMipmaps);
+
+    // Records a copy of every mip level of the image, with each level's tightly packed data located within data.  The image
+    // is left in VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL.
+    void uploadImageLevels(const void* data, const std::vector<ImageLevel>& levels, Image& dst);
+
+    // Streamed images are copied in pieces which may be spread across several batches.  beginImageUpload transitions every
+    // mip level for copying, uploadImageRows copies a range of rows of blocks of one level, whose tightly packed data is
+    // levelData, and finishImageUpload leaves the image in VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL.  The image is only
+    // ready once the batch containing finishImageUpload has completed.
+    void beginImageUpload(Image& dst);
+    void uploadImageRows(const void* levelData, VkDeviceSize levelSize, Image& dst, uint32_t mipLevel, uint32_t firstBlockRow, uint32_t blockRowCount);
+    void finishImageUpload(Image& dst, bool generateMipmaps);
+
+    // Finishes an image upload after copying levelCount mip levels of src, starting at srcMipLevel, into dst starting at
+    // dstMipLevel.  The copy is recorded on the graphics queue since src must be owned by it and in
+    // VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL.  src may still be sampled by frames in flight and is left in that layout.
+    void finishImageUpload(Image& dst, Image& src, uint32_t srcMipLevel, uint32_t dstMipLevel, uint32_t levelCount);
+
+    // number of rows of blocks in a mip level of the image
+    static uint32_t getBlockRowCount(const Image& image, uint32_t mipLevel);
+
+    // Submits all uploads recorded since the last submit.  Returns an id which can be used to check for completion.
+    uint64_t submit();
+    bool isComplete(uint64_t batchId);
+    void wait(uint64_t batchId);
+
+    // submits any pending uploads and waits for all of them to complete
+    void flush();
+
+    // if set the most recent batch is timed with GPU timestamps
+    TimestampQueryPool* timestamps = nullptr;
+
+private:
+    struct Batch {
+        uint64_t id = 0;
+        VkCommandBuffer transferCommands = VK_NULL_HANDLE;
+        VkCommandBuffer graphicsCommands = VK_NULL_HANDLE;
+        VkCommandBuffer timingCommands = VK_NULL_HANDLE;
+        VkSemaphore transferComplete = VK_NULL_HANDLE;
+        VkFence fence = VK_NULL_HANDLE;
+        bool timed = false;
+    };
+
+    Batch& getRecordingBatch();
+
+    // Allocates space in the staging ring, submitting and waiting for earlier batches if needed
+    StagingRing::Allocation allocateStaging(VkDeviceSize size);
+
+    // uploads are split into chunks of at most this size so that one upload can never fill the entire ring
+    inline VkDeviceSize getMaxChunkSize() const { return stagingRing.getCapacity() / 2; }
+
+    VkCommandBuffer allocateCommandBuffer(CommandPool& commandPool);
+
+    // copies one mip level of an image in chunks of rows, the image is left in transfer destination layout
+    void recordImageLevel(const uint8_t* source, VkDeviceSize size, Image& dst, uint32_t mipLevel, uint32_t firstBlockRow, uint32_t blockRowCount);
+
+    // command buffer used for commands that must execute on the graphics queue once the transfer has completed
+    VkCommandBuffer ownershipCommands(Batch& batch) const;
+
+    // moves ownership of an image which has been copied into from the transfer queue to the graphics queue
+    void acquireImage(Batch& batch, Image& dst);
+
+    // frees the resources of completed batches
+    void reclaim(bool waitForAll);
+    void releaseBatch(Batch& batch);
+
+private:
+    Device& device;
+
+    CommandPool transferPool;
+    CommandPool graphicsPool;
+    StagingRing stagingRing;
+
+    std::unique_ptr<Batch> recording;
+    std::deque<Batch> pending;
+    uint64_t nextBatchId = 1;
+    uint64_t completedBatchId = 0;
+};
+
+}
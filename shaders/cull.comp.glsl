@@ -0,0 +1,128 @@
+#version 450
+#pragma shader_stage(compute)
+#extension GL_ARB_separate_shader_objects : enable
+
+// must match GpuCuller::MAX_LODS
+#define MAX_LODS 8
+
+layout(local_size_x = 64) in;
+
+struct Instance {
+    mat4 model;
+    vec4 boundsCenter;
+    vec4 boundsExtent;
+};
+
+struct Lod {
+    uint firstIndex;
+    uint indexCount;
+    int vertexOffset;
+    float error;
+};
+
+struct CullParams {
+    vec4 planes[6];
+    mat4 view;
+    float pixelsPerUnit;
+    float pixelError;
+    uint instanceCount;
+    uint lodCount;
+    Lod lods[MAX_LODS];
+};
+
+// matches VkDrawIndexedIndirectCommand
+struct DrawCommand {
+    uint indexCount;
+    uint instanceCount;
+    uint firstIndex;
+    int vertexOffset;
+    uint firstInstance;
+};
+
+layout(std430, binding = 0) readonly buffer Instances {
+    Instance instances[];
+};
+
+layout(std430, binding = 1) readonly buffer Params {
+    CullParams frames[];
+};
+
+layout(std430, binding = 2) writeonly buffer Draws {
+    DrawCommand draws[];
+};
+
+layout(std430, binding = 3) buffer Counts {
+    uint counts[];
+};
+
+layout(push_constant) uniform PushConstants {
+    uint frameIndex;
+    uint drawOffset;
+    uint maxDraws;
+
+    // when set visible draws are packed to the front and counted, otherwise every slot is written
+    uint compact;
+} pc;
+
+float projectedError(uint lod, float scale, float distance) {
+    return frames[pc.frameIndex].lods[lod].error * scale / distance * frames[pc.frameIndex].pixelsPerUnit;
+}
+
+void main() {
+    uint index = gl_GlobalInvocationID.x;
+
+    if (index >= pc.maxDraws) {
+        return;
+    }
+
+    bool visible = index < frames[pc.frameIndex].instanceCount;
+    vec3 center = vec3(0.0);
+    vec3 extent = vec3(0.0);
+    float scale = 1.0;
+
+    if (visible) {
+        mat4 model = instances[index].model;
+        center = vec3(model * vec4(instances[index].boundsCenter.xyz, 1.0));
+
+        // the world space box which encloses the transformed object space box
+        mat3 absolute = mat3(abs(model[0].xyz), abs(model[1].xyz), abs(model[2].xyz));
+        extent = absolute * instances[index].boundsExtent.xyz;
+        scale = max(length(model[0].xyz), max(length(model[1].xyz), length(model[2].xyz)));
+
+        for (int i = 0; i < 6; i++) {
+            vec4 plane = frames[pc.frameIndex].planes[i];
+            visible = visible && dot(plane.xyz, center) + plane.w + dot(abs(plane.xyz), extent) >= 0.0;
+        }
+    }
+
+    if (!visible) {
+        if (pc.compact == 0) {
+            draws[pc.drawOffset + index] = DrawCommand(0u, 0u, 0u, 0, 0u);
+        }
+
+        return;
+    }
+
+    // select the coarsest level whose projected error is within the threshold, this matches Mesh::getProjectedError
+    vec3 viewCenter = vec3(frames[pc.frameIndex].view * vec4(center, 1.0));
+    float radius = length(instances[index].boundsExtent.xyz) * scale;
+    float distance = max(-viewCenter.z - radius, 1e-6);
+
+    uint lod = 0u;
+    while (lod + 1u < frames[pc.frameIndex].lodCount && projectedError(lod + 1u, scale, distance) <= frames[pc.frameIndex].pixelError) {
+        lod += 1u;
+    }
+
+    Lod selected = frames[pc.frameIndex].lods[lod];
+
+    // the first instance carries the instance index to the vertex shader
+    DrawCommand draw = DrawCommand(selected.indexCount, 1u, selected.firstIndex, selected.vertexOffset, index);
+
+    if (pc.compact == 0) {
+        draws[pc.drawOffset + index] = draw;
+    }
+    else {
+        uint slot = atomicAdd(counts[pc.frameIndex], 1u);
+        draws[pc.drawOffset + slot] = draw;
+    }
+}
@@ -0,0 +1,31 @@
+#version 450
+#pragma shader_stage(vertex)
+#extension GL_ARB_separate_shader_objects : enable
+
+// the model matrix in the uniform buffer maps quantized vertices back to object space, the per instance transform follows it
+layout(set = 0, binding = 0) uniform UniformBufferObject {
+    mat4 model;
+    mat4 view;
+    mat4 proj;
+} ubo;
+
+struct Instance {
+    mat4 model;
+    vec4 boundsCenter;
+    vec4 boundsExtent;
+};
+
+layout(std430, set = 1, binding = 0) readonly buffer Instances {
+    Instance instances[];
+};
+
+layout(location = 0) in vec3 inPosition;
+layout(location = 1) in vec2 inTexCoord;
+
+layout(location = 0) out vec2 fragTexCoord;
+
+void main() {
+    gl_Position = ubo.proj * ubo.view * instances[gl_InstanceIndex].model * ubo.model * vec4(inPosition, 1.0);
+
+    fragTexCoord = inTexCoord;
+}
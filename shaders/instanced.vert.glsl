@@ -0,0 +1,27 @@
+#version 450
+#pragma shader_stage(vertex)
+#extension GL_ARB_separate_shader_objects : enable
+
+// the model matrix in the uniform buffer maps quantized vertices back to object space, the per instance transform follows it
+layout(binding = 0) uniform UniformBufferObject {
+    mat4 model;
+    mat4 view;
+    mat4 proj;
+} ubo;
+
+layout(location = 0) in vec3 inPosition;
+layout(location = 1) in vec2 inTexCoord;
+
+// per instance stream, see vkdev::InstanceData
+layout(location = 2) in mat4 inInstanceModel;
+layout(location = 6) in uint inMaterialIndex;
+
+layout(location = 0) out vec2 fragTexCoord;
+layout(location = 1) flat out uint fragMaterialIndex;
+
+void main() {
+    gl_Position = ubo.proj * ubo.view * inInstanceModel * ubo.model * vec4(inPosition, 1.0);
+
+    fragTexCoord = inTexCoord;
+    fragMaterialIndex = inMaterialIndex;
+}
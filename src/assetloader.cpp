@@ -0,0 +1,317 @@
+#include "vkdev/assetloader.h"
+
+#include "vkdev/meshpack.h"
+#include "vkdev/textureformat.h"
+#include "vkdev/texturestreamer.h"
+
+#include <algorithm>
+#include <atomic>
+#include <stdexcept>
+
+namespace vkdev {
+
+enum class AssetType {
+    Texture,
+    StreamedTexture,
+    Mesh,
+    Shader
+};
+
+struct AssetRequest {
+    AssetType type;
+    std::string name;
+    std::vector<std::string> paths;
+
+    std::atomic<AssetState> state = { AssetState::Loading };
+
+    // set by the decoding job once it has written either the decoded data or its error
+    std::atomic<bool> decoded = { false };
+    std::exception_ptr error;
+
+    uint64_t batchId = 0;
+
+    TextureStreamer* textureStreamer = nullptr;
+    uint32_t streamedTexture = 0;
+
+    // decoded data, released once the asset's device objects have been created
+    TextureData texture;
+    MeshPack meshPack;
+    std::vector<MeshData> lodData;
+    ShaderData shaderData;
+};
+
+AssetState AssetHandle::getState() const {
+    return request->state.load(std::memory_order_acquire);
+}
+
+const std::string& AssetHandle::getName() const {
+    return request->name;
+}
+
+void AssetHandle::rethrowError() const {
+    if (request->error) {
+        std::rethrow_exception(request->error);
+    }
+}
+
+uint32_t AssetHandle::getStreamedTexture() const {
+    return request->streamedTexture;
+}
+
+static bool isMeshPack(const std::string& path) {
+    const std::string extension = ".vkpack";
+    return path.size() >= extension.size() && path.compare(path.size() - extension.size(), extension.size(), extension) == 0;
+}
+
+// Raw mesh streams refer to a mapping of the file, which is only read from disk as its pages are touched.  Touching them
+// on the decoding job keeps that read off of the thread which records the upload.
+static void touchPages(const uint8_t* data, size_t size) {
+    uint8_t sum = 0;
+
+    for (size_t offset = 0; offset < size; offset += 4096) {
+        sum += data[offset];
+    }
+
+    volatile uint8_t sink = sum;
+    (void)sink;
+}
+
+static void decode(AssetRequest& request, Device& device) {
+    switch (request.type) {
+    case AssetType::Texture:
+    case AssetType::StreamedTexture:
+        request.texture.loadFromFile(request.paths[0]);
+
+        // decompressing is as costly as decoding, so it happens here rather than when the texture is created
+        if (!Texture::isFormatSupported(device, request.texture.format) && TextureFormat::canDecompress(request.texture.format)) {
+            request.texture = request.texture.decompress();
+        }
+
+        // every level of a streamed texture must be available on the CPU
+        if (request.type == AssetType::StreamedTexture && request.texture.generateMipmaps) {
+            request.texture.buildMipChain();
+        }
+
+        touchPages(request.texture.getData(), static_cast<size_t>(request.texture.getSize()));
+        break;
+
+    case AssetType::Mesh:
+        if (isMeshPack(request.paths[0])) {
+            request.meshPack.open(request.paths[0]);
+
+            if (request.meshPack.getEntryCount() == 0) {
+                throw std::runtime_error("Mesh pack contains no meshes: " + request.paths[0]);
+            }
+
+            request.meshPack.loadMeshLods(request.meshPack.getEntry(0).name, request.lodData);
+        }
+        else {
+            request.lodData.emplace_back();
+            request.lodData.back().loadFromFile(request.paths[0]);
+        }
+
+        for (const auto& meshData : request.lodData) {
+            touchPages(meshData.vertexData, meshData.vertexDataSize);
+            touchPages(meshData.elementData, meshData.elementDataSize);
+        }
+        break;
+
+    case AssetType::Shader:
+        request.shaderData.loadFiles(request.paths[0], request.paths[1], request.paths[2]);
+        break;
+    }
+}
+
+AssetHandle AssetLoader::loadTexture(const std::string& name, const std::string& path) {
+    auto request = std::make_shared<AssetRequest>();
+    request->type = AssetType::Texture;
+    request->name = name;
+    request->paths = { path };
+
+    return startLoad(std::move(request));
+}
+
+AssetHandle AssetLoader::loadStreamedTexture(const std::string& name, const std::string& path, TextureStreamer& textureStreamer) {
+    auto request = std::make_shared<AssetRequest>();
+    request->type = AssetType::StreamedTexture;
+    request->name = name;
+    request->paths = { path };
+    request->textureStreamer = &textureStreamer;
+
+    return startLoad(std::move(request));
+}
+
+AssetHandle AssetLoader::loadMesh(const std::string& name, const std::string& path) {
+    auto request = std::make_shared<AssetRequest>();
+    request->type = AssetType::Mesh;
+    request->name = name;
+    request->paths = { path };
+
+    return startLoad(std::move(request));
+}
+
+AssetHandle AssetLoader::loadShader(const std::string& name, const std::string& vertexPath, const std::string& fragmentPath, const std::string& infoPath) {
+    auto request = std::make_shared<AssetRequest>();
+    request->type = AssetType::Shader;
+    request->name = name;
+    request->paths = { vertexPath, fragmentPath, infoPath };
+
+    return startLoad(std::move(request));
+}
+
+AssetHandle AssetLoader::startLoad(std::shared_ptr<AssetRequest> request) {
+    loading.push_back(request);
+
+    // the job holds its own reference, so the request outlives it even if the loader discards it
+    jobSystem.run([request, &device = device]() {
+        try {
+            decode(*request, device);
+        }
+        catch (...) {
+            request->error = std::current_exception();
+        }
+
+        request->decoded.store(true, std::memory_order_release);
+    }, &loadCounter);
+
+    AssetHandle handle;
+    handle.request = std::move(request);
+
+    return handle;
+}
+
+void AssetLoader::createAsset(AssetRequest& request) {
+    switch (request.type) {
+    case AssetType::Texture:
+        assets.textures[request.name] = std::make_unique<Image>(Texture::create(request.texture, device, uploadManager));
+        request.texture = TextureData();
+        break;
+
+    case AssetType::StreamedTexture:
+        request.streamedTexture = request.textureStreamer->add(std::move(request.texture));
+        request.texture = TextureData();
+        break;
+
+    case AssetType::Mesh: {
+        auto mesh = std::make_unique<Mesh>(device);
+        mesh->create(request.lodData, uploadManager);
+
+        if (assets.meshDescriptions.find(mesh->vertexAttributes) == assets.meshDescriptions.end()) {
+            assets.meshDescriptions[mesh->vertexAttributes] = std::make_unique<MeshDescription>(mesh->getMeshDescription());
+        }
+
+        assets.meshes[request.name] = std::move(mesh);
+
+        // the mesh data has been copied into staging memory, so the pack's mapping is no longer needed
+        request.lodData.clear();
+        request.meshPack.cleanup();
+        break;
+    }
+
+    case AssetType::Shader: {
+        auto shader = std::make_unique<Shader>(device);
+        shader->create(request.shaderData);
+        assets.shaders[request.name] = std::move(shader);
+
+        request.shaderData = ShaderData();
+        break;
+    }
+    }
+}
+
+void AssetLoader::update() {
+    std::vector<std::shared_ptr<AssetRequest>> created;
+
+    for (size_t i = 0; i < loading.size();) {
+        auto request = loading[i];
+
+        if (!request->decoded.load(std::memory_order_acquire)) {
+            i++;
+            continue;
+        }
+
+        loading[i] = loading.back();
+        loading.pop_back();
+
+        // a failure to create one asset does not stop the rest of the batch from being created
+        if (!request->error) {
+            try {
+                createAsset(*request);
+            }
+            catch (...) {
+                request->error = std::current_exception();
+            }
+        }
+
+        if (request->error) {
+            request->state.store(AssetState::Failed, std::memory_order_release);
+
+            if (!firstError) {
+                firstError = request->error;
+            }
+        }
+        // shaders have nothing to upload
+        else if (request->type == AssetType::Shader) {
+            request->state.store(AssetState::Ready, std::memory_order_release);
+        }
+        else {
+            created.push_back(request);
+        }
+    }
+
+    // every asset created by this update shares one submission
+    if (!created.empty()) {
+        const uint64_t batchId = uploadManager.submit();
+
+        for (auto& request : created) {
+            request->batchId = batchId;
+            request->state.store(AssetState::Uploading, std::memory_order_release);
+            uploading.push_back(request);
+        }
+    }
+
+    for (size_t i = 0; i < uploading.size();) {
+        if (uploadManager.isComplete(uploading[i]->batchId)) {
+            uploading[i]->state.store(AssetState::Ready, std::memory_order_release);
+            uploading[i] = uploading.back();
+            uploading.pop_back();
+        }
+        else {
+            i++;
+        }
+    }
+}
+
+void AssetLoader::waitAll() {
+    // the calling thread decodes assets as well while it waits
+    jobSystem.wait(loadCounter);
+    update();
+
+    // batches complete in the order they were submitted, so waiting on the last one waits for all of them
+    uint64_t lastBatchId = 0;
+    for (const auto& request : uploading) {
+        lastBatchId = std::max(lastBatchId, request->batchId);
+    }
+
+    if (!uploading.empty()) {
+        uploadManager.wait(lastBatchId);
+        update();
+    }
+
+    if (firstError) {
+        std::exception_ptr error = firstError;
+        firstError = nullptr;
+
+        std::rethrow_exception(error);
+    }
+}
+
+void AssetLoader::cleanup() {
+    jobSystem.wait(loadCounter);
+
+    loading.clear();
+    uploading.clear();
+    firstError = nullptr;
+}
+
+}
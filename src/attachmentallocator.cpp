@@ -0,0 +1,61 @@
+#include "vkdev/attachmentallocator.h"
+
+#include <stdexcept>
+
+namespace vkdev {
+
+bool AttachmentAllocator::fits(VmaAllocation allocation, const VkMemoryRequirements& requirements) const {
+    VmaAllocationInfo info;
+    vmaGetAllocationInfo(device.allocator, allocation, &info);
+
+    return info.size >= requirements.size &&
+        (info.offset % requirements.alignment) == 0 &&
+        (requirements.memoryTypeBits & (1U << info.memoryType)) != 0;
+}
+
+void AttachmentAllocator::createImage(Image& image, uint32_t slot, const VkExtent2D& extent, VkSampleCountFlagBits numSamples, VkFormat format, VkImageUsageFlags usageFlags) {
+    image.createUnbound(extent.width, extent.height, 1, numSamples, format, VK_IMAGE_TILING_OPTIMAL, usageFlags);
+
+    VkMemoryRequirements requirements;
+    vkGetImageMemoryRequirements(device.logical, image.handle, &requirements);
+
+    auto result = slots.find(slot);
+
+    if (result == slots.end() || !fits(result->second, requirements)) {
+        // the previous memory is too small or incompatible, which is only the case when the extent has grown or the format has changed
+        if (result != slots.end()) {
+            device.memory->untrack(result->second);
+            vmaFreeMemory(device.allocator, result->second);
+            slots.erase(result);
+        }
+
+        VmaAllocationCreateInfo allocInfo = {};
+        allocInfo.usage = VmaMemoryUsage::VMA_MEMORY_USAGE_GPU_ONLY;
+        allocInfo.requiredFlags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+
+        if (usageFlags & VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT) {
+            allocInfo.preferredFlags = VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT;
+        }
+
+        VmaAllocation allocation = VK_NULL_HANDLE;
+        if (vmaAllocateMemory(device.allocator, &requirements, &allocInfo, &allocation, nullptr) != VK_SUCCESS) {
+            throw std::runtime_error("failed to allocate attachment memory");
+        }
+
+        device.memory->track(allocation, MemoryCategory::Attachment);
+        result = slots.emplace(slot, allocation).first;
+    }
+
+    image.bindMemory(result->second);
+}
+
+void AttachmentAllocator::cleanup() {
+    for (auto& slot : slots) {
+        device.memory->untrack(slot.second);
+        vmaFreeMemory(device.allocator, slot.second);
+    }
+
+    slots.clear();
+}
+
+}
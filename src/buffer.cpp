@@ -18,7 +18,7 @@ namespace vkdev {
         throw std::runtime_error("failed to find suitable memory type!");
     }
 
-    void Buffer::create(VkDeviceSize bufferSize, VkBufferUsageFlags usage, VmaMemoryUsage memoryUsage) {
+    void Buffer::create(VkDeviceSize bufferSize, VkBufferUsageFlags usage, VmaMemoryUsage memoryUsage, MemoryCategory category) {
         VkBufferCreateInfo vertexBufferInfo = {};
         vertexBufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
         vertexBufferInfo.size = bufferSize; // buffer size in bytes
@@ -30,10 +30,12 @@ namespace vkdev {
 
         vmaCreateBuffer(device.allocator, &vertexBufferInfo, &allocInfo, &buffer, &allocation, nullptr);
         size = bufferSize;
+
+        device.memory->track(allocation, category);
     }
 
-    void Buffer::createWithData(const void* data, VkDeviceSize size, VkBufferUsageFlags usage, VmaMemoryUsage memoryUsage) {
-        create(size, usage, memoryUsage);
+    void Buffer::createWithData(const void* data, VkDeviceSize size, VkBufferUsageFlags usage, VmaMemoryUsage memoryUsage, MemoryCategory category) {
+        create(size, usage, memoryUsage, category);
 
         void* mappedData = nullptr;
         vmaMapMemory(device.allocator, allocation, &mappedData);
@@ -43,6 +45,29 @@ namespace vkdev {
         vmaUnmapMemory(device.allocator, allocation);
     }
 
+    // VMA keeps the allocation mapped until it is destroyed which avoids the cost of mapping on every write
+    void Buffer::createMapped(VkDeviceSize bufferSize, VkBufferUsageFlags usage, VmaMemoryUsage memoryUsage, MemoryCategory category) {
+        VkBufferCreateInfo bufferInfo = {};
+        bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+        bufferInfo.size = bufferSize;
+        bufferInfo.usage = usage;
+        bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+        VmaAllocationCreateInfo allocInfo = {};
+        allocInfo.usage = memoryUsage;
+        allocInfo.flags = VMA_ALLOCATION_CREATE_MAPPED_BIT;
+
+        VmaAllocationInfo allocationInfo = {};
+        if (vmaCreateBuffer(device.allocator, &bufferInfo, &allocInfo, &buffer, &allocation, &allocationInfo) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create mapped buffer");
+        }
+
+        size = bufferSize;
+        mapped = allocationInfo.pMappedData;
+
+        device.memory->track(allocation, category);
+    }
+
     // copying a vertex buffer requires a transfer command.  We will need to create a temporary command buffer to execute the command
     // Ideally it would be useful to create a separate command pool for short lived transfer operations like this as opposed to using the main command pool.
     // note that we are using the graphics queue to perform copies.  this is because graphics queues must also support buffer copy operations.
@@ -64,6 +89,8 @@ namespace vkdev {
     }
 
     void Buffer::cleanup() {
+        device.memory->untrack(allocation);
         vmaDestroyBuffer(device.allocator, buffer, allocation);
+        mapped = nullptr;
     }
 }
\ No newline at end of file
@@ -1,17 +1,18 @@
 #include "vkdev/commandpool.h"
+#include "vkdev/querypool.h"
 
 #include <stdexcept>
 #include <vkdev/queue.h>
 
 namespace vkdev {
 
-void CommandPool::create() {
+void CommandPool::create(VkCommandPoolCreateFlags flags) {
 
     // command pool can only create commands on a particular type of queue.  In or case we are making graphics commands so needs to be associated with our graphics queue
     VkCommandPoolCreateInfo poolInfo = {};
     poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
     poolInfo.queueFamilyIndex = queue.index;
-    poolInfo.flags = 0;
+    poolInfo.flags = flags;
 
     if (vkCreateCommandPool(device.logical, &poolInfo, nullptr, &handle) != VK_SUCCESS) {
         throw std::runtime_error("failed to create command pool");
@@ -22,6 +23,12 @@ void CommandPool::cleanup(){
     vkDestroyCommandPool(device.logical, handle, nullptr);
 }
 
+void CommandPool::reset() {
+    if (vkResetCommandPool(device.logical, handle, 0) != VK_SUCCESS) {
+        throw std::runtime_error("failed to reset command pool");
+    }
+}
+
 SingleUseCommandBuffer CommandPool::createSingleUseBuffer(){
     return SingleUseCommandBuffer(*this, device);
 }
@@ -40,9 +47,17 @@ void SingleUseCommandBuffer::start() {
     beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
 
     vkBeginCommandBuffer(handle, &beginInfo);
+
+    if (pool.timestamps) {
+        pool.timestamps->beginUpload(handle);
+    }
 }
 
 void SingleUseCommandBuffer::submit() {
+    if (pool.timestamps) {
+        pool.timestamps->endUpload(handle);
+    }
+
     vkEndCommandBuffer(handle);
 
     VkSubmitInfo submitInfo = {};
@@ -53,6 +68,10 @@ void SingleUseCommandBuffer::submit() {
     vkQueueSubmit(pool.queue.handle, 1, &submitInfo, VK_NULL_HANDLE);
     vkQueueWaitIdle(pool.queue.handle);
 
+    if (pool.timestamps) {
+        pool.timestamps->collectUpload();
+    }
+
     vkFreeCommandBuffers(device.logical, pool.handle, 1, &handle);
 }
 
@@ -0,0 +1,297 @@
+#include "vkdev/demoscene.h"
+
+#define GLM_FORCE_RADIANS
+// The perspective projection matrix generated by GLM will use the OpenGL depth range of -1.0 to 1.0 by default. We need to configure it to use the Vulkan range of 0.0 to 1.0
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <cmath>
+
+namespace vkdev {
+
+std::vector<glm::mat4> DemoScene::instanceGrid(const Bounds& bounds, uint32_t instanceCount) {
+    const uint32_t side = static_cast<uint32_t>(std::ceil(std::sqrt(static_cast<double>(instanceCount))));
+    const glm::vec3 size = bounds.max - bounds.min;
+    const float spacing = std::max(size.x, size.y) * 1.25f;
+    const float origin = (side - 1) * spacing * 0.5f;
+
+    std::vector<glm::mat4> transforms;
+    for (uint32_t i = 0; i < instanceCount; i++) {
+        const glm::vec3 position((i % side) * spacing - origin, (i / side) * spacing - origin, 0.0f);
+        transforms.push_back(glm::translate(glm::mat4(1.0f), position));
+    }
+
+    return transforms;
+}
+
+void DemoScene::loadAssets(AssetLoader& assetLoader) {
+    // when culling on the GPU the vertex shader reads each instance's transform from the culler's instance buffer,
+    // when instancing it is read from a per instance vertex stream
+    std::string vertexShaderPath = "shaders/shader.vert.spv";
+    if (gpuInstanceCount > 0) {
+        vertexShaderPath = "shaders/gpudriven.vert.spv";
+    }
+    else if (instanceCount > 0) {
+        vertexShaderPath = "shaders/instanced.vert.spv";
+    }
+
+    // a streamed texture is owned by the texture streamer rather than the assets
+    if (textureBudget > 0) {
+        textureStreamer = std::make_unique<TextureStreamer>(device, uploadManager);
+        textureStreamer->memoryBudget = static_cast<VkDeviceSize>(textureBudget) * 1024 * 1024;
+        textureStreamer->uploadBytesPerFrame = static_cast<VkDeviceSize>(streamUploadLimit) * 1024;
+        textureStreamer->create(framesInFlight);
+
+        streamedTextureHandle = assetLoader.loadStreamedTexture("texture", texturePath, *textureStreamer);
+    }
+    else {
+        assetLoader.loadTexture("texture", texturePath);
+    }
+
+    assetLoader.loadMesh("mesh", modelPath);
+    assetLoader.loadShader("shader", vertexShaderPath, "shaders/shader.frag.spv", "shaders/shader.json");
+}
+
+void DemoScene::createInstances() {
+    if (textureStreamer) {
+        streamedTexture = streamedTextureHandle.getStreamedTexture();
+    }
+
+    auto& mesh = assets.meshes["mesh"];
+    culler.jobSystem = &jobSystem;
+    culler.add(mesh->bounds);
+
+    if (gpuInstanceCount > 0) {
+        gpuCuller = std::make_unique<GpuCuller>(device);
+        gpuCuller->create(*mesh, gpuInstanceCount, framesInFlight);
+
+        const auto transforms = instanceGrid(mesh->bounds, gpuInstanceCount);
+        for (uint32_t i = 0; i < transforms.size(); i++) {
+            gpuCuller->setInstance(i, transforms[i]);
+        }
+    }
+
+    drawTransforms = instanceGrid(mesh->bounds, drawCount);
+}
+
+void DemoScene::createPipeline(RenderTarget& renderTarget) {
+    auto& mesh = assets.meshes["mesh"];
+    MeshDescription meshDescription = *assets.meshDescriptions[mesh->vertexAttributes];
+
+    if (instanceCount > 0) {
+        InstanceBatcher::addInstanceBinding(meshDescription);
+    }
+
+    std::vector<VkDescriptorSetLayout> additionalSetLayouts;
+    if (gpuCuller) {
+        additionalSetLayouts.push_back(gpuCuller->instanceLayout);
+    }
+
+    pipeline = createDefaultPipeline(device, *assets.shaders["shader"], meshDescription, renderTarget, additionalSetLayouts);
+}
+
+void DemoScene::cleanupPipeline() {
+    pipeline->cleanup();
+
+    // the pipeline is created again, possibly at the address of the old one
+    for (auto& queue : renderQueues) {
+        queue->resetIds();
+    }
+}
+
+// Each frame in flight has its own slice of the uniform arena, which is reset and bump allocated every frame
+void DemoScene::createDescriptor() {
+    // every draw has its own uniforms.  minUniformBufferOffsetAlignment is at most 256 bytes, which bounds the space each needs
+    const VkDeviceSize frameCapacity = std::max<VkDeviceSize>(UniformArena::DEFAULT_FRAME_CAPACITY, (drawCount + 1) * 256);
+
+    uniformArena = std::make_unique<UniformArena>(device);
+    uniformArena->create(framesInFlight, frameCapacity);
+
+    Material material;
+    material.shader = "shader";
+
+    if (textureStreamer) {
+        material.textures["texSampler"] = &textureStreamer->getImage(streamedTexture);
+    }
+    else {
+        material.textures["texSampler"] = assets.textures["texture"].get();
+    }
+
+    // streaming replaces the descriptor set whenever the texture's image changes, and the replaced sets stay alive while frames in flight use them
+    descriptor = std::make_unique<Descriptor>(device);
+    descriptor->create(material, assets, *uniformArena, 1, textureStreamer ? framesInFlight + 1 : 1);
+
+    if (textureStreamer) {
+        textureStreamer->bind(streamedTexture, *descriptor, "texSampler");
+    }
+}
+
+// every instance shares the mesh and material, so they are all drawn by a single instanced draw
+void DemoScene::createInstanceBatcher() {
+    if (instanceCount == 0) {
+        return;
+    }
+
+    auto& mesh = assets.meshes["mesh"];
+
+    instanceBatcher = std::make_unique<InstanceBatcher>(device);
+    for (const auto& transform : instanceGrid(mesh->bounds, instanceCount)) {
+        instanceBatcher->add(*mesh, *descriptor, transform);
+    }
+
+    instanceBatcher->build(framesInFlight);
+}
+
+void DemoScene::createRenderQueues() {
+    for (uint32_t i = 0; i < framesInFlight; i++) {
+        renderQueues.push_back(std::make_unique<RenderQueue>());
+        renderQueues.back()->create(std::max(MAX_DRAW_PACKETS, drawCount));
+    }
+}
+
+void DemoScene::update(uint32_t frameSlot, float angle, const VkExtent2D& extent) {
+    const uint32_t uniformOffset = updateUniforms(frameSlot, angle, extent);
+
+    // the frame's fence has been waited on, so images and descriptor sets replaced by earlier frames can be released
+    if (textureStreamer) {
+        textureStreamer->update();
+    }
+
+    buildDrawList(frameSlot, uniformOffset);
+
+    // the draw list may allocate uniforms of its own, so the frame's uniforms are flushed once both are written
+    uniformArena->flush(frameSlot);
+}
+
+uint32_t DemoScene::updateUniforms(uint32_t frameSlot, float angle, const VkExtent2D& extent) {
+    UniformBufferObject ubo = {};
+    auto& mesh = assets.meshes["mesh"];
+    const glm::mat4 model = glm::rotate(glm::mat4(1.0f), angle, glm::vec3(0.0f, 0.0f, 1.0f));
+    const float viewportHeight = static_cast<float>(extent.height);
+
+    // quantized vertex positions are mapped back to object space before the model transform
+    ubo.model = model * mesh->getDequantizeTransform();
+    ubo.view = glm::lookAt(glm::vec3(2.0f, 2.0f, 2.0f), glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f));
+    ubo.proj = glm::perspective(glm::radians(45.0f), extent.width / (float)extent.height, 0.1f, 10.0f);
+
+    // The texture is mapped once across the mesh, so it needs about as many texels across as the mesh covers pixels.
+    // Like the level of detail this is measured before the y axis of the projection is flipped.
+    if (textureStreamer) {
+        textureStreamer->request(streamedTexture, mesh->getProjectedSize(ubo.view * model, ubo.proj, viewportHeight));
+    }
+
+    if (instanceBatcher) {
+        // the instances are static, so only the stream and draws for this frame need to be written
+        ubo.model = mesh->getDequantizeTransform();
+        instanceBatcher->update(frameSlot);
+    }
+    else if (gpuCuller) {
+        // every instance is culled and has its level of detail selected by the cull shader
+        ubo.model = mesh->getDequantizeTransform();
+        gpuCuller->update(frameSlot, ubo.view, ubo.proj, viewportHeight);
+    }
+    else {
+        currentLod = mesh->selectLod(ubo.view * model, ubo.proj, viewportHeight, currentLod);
+
+        // the view looks down -z, so the distance to the center of the bounds is the negated view space z
+        const glm::vec3 center = (mesh->bounds.min + mesh->bounds.max) * 0.5f;
+        meshDepth = std::max(-(ubo.view * model * glm::vec4(center, 1.0f)).z, 0.0f);
+
+        // the mesh is skipped when its bounds are entirely outside of the view
+        culler.set(0, transformBounds(mesh->bounds, model));
+        culler.cull(Frustum::fromViewProjection(ubo.proj * ubo.view), visibleInstances);
+    }
+
+    // GLM was originally designed for OpenGL, where the Y coordinate of the clip coordinates is inverted.
+    // The easiest way to compensate for that is to flip the sign on the scaling factor of the Y axis in the projection matrix.
+    // If you don't do this, then the image will be rendered upside down.
+    ubo.proj[1][1] *= -1;
+    frameUniforms = ubo;
+
+    // the frame's previous submission has completed, so everything allocated from its slice of the arena can be released
+    uniformArena->reset(frameSlot);
+    return uniformArena->push(frameSlot, ubo);
+}
+
+// The draw list is built every frame, after the uniforms have been written, so the packets always reflect the current
+// level of detail and visibility.
+void DemoScene::buildDrawList(uint32_t frameSlot, uint32_t uniformOffset) {
+    auto& queue = renderQueues[frameSlot];
+    queue->clear();
+
+    if (drawCount > 0) {
+        buildCopiesDrawList(frameSlot);
+        return;
+    }
+
+    // the mesh is skipped when the CPU culler found it outside of the view
+    if (!gpuCuller && !instanceBatcher && visibleInstances.empty()) {
+        return;
+    }
+
+    DrawPacket packet;
+    packet.pipeline = pipeline.get();
+    packet.descriptor = descriptor.get();
+    packet.dynamicOffset = uniformOffset;
+    packet.mesh = assets.meshes["mesh"].get();
+    packet.lod = currentLod;
+    packet.depth = meshDepth;
+    packet.gpuCuller = gpuCuller.get();
+    packet.instanceBatcher = instanceBatcher.get();
+
+    queue->submit(packet);
+    queue->sort();
+}
+
+// Copies are not culled and use the least detailed level, keeping the GPU from becoming the bottleneck.
+void DemoScene::buildCopiesDrawList(uint32_t frameSlot) {
+    auto& queue = renderQueues[frameSlot];
+    auto& mesh = assets.meshes["mesh"];
+    const glm::vec3 eye(glm::inverse(frameUniforms.view)[3]);
+
+    DrawPacket packet;
+    packet.pipeline = pipeline.get();
+    packet.descriptor = descriptor.get();
+    packet.mesh = mesh.get();
+    packet.lod = static_cast<uint32_t>(mesh->lods.size()) - 1;
+
+    UniformBufferObject ubo = frameUniforms;
+    for (const auto& transform : drawTransforms) {
+        ubo.model = transform * mesh->getDequantizeTransform();
+
+        packet.dynamicOffset = uniformArena->push(frameSlot, ubo);
+        packet.depth = glm::length(glm::vec3(transform[3]) - eye);
+        queue->submit(packet);
+    }
+
+    queue->sort();
+}
+
+void DemoScene::cleanup() {
+    descriptor->cleanup();
+
+    for (auto& queue : renderQueues) {
+        queue->cleanup();
+    }
+
+    if (gpuCuller) {
+        gpuCuller->cleanup();
+    }
+
+    if (instanceBatcher) {
+        instanceBatcher->cleanup();
+    }
+
+    uniformArena->cleanup();
+
+    if (textureStreamer) {
+        textureStreamer->cleanup();
+    }
+
+    assets.cleanup();
+    culler.jobSystem = nullptr;
+}
+
+}
@@ -1,5 +1,6 @@
 #include "vkdev/descriptor.h"
 
+#include <algorithm>
 #include <stdexcept>
 
 namespace vkdev {
@@ -18,6 +19,11 @@ void Descriptor::createPool(const Shader& shader, uint32_t count){
     poolInfo.pPoolSizes = poolSizes.data();
     poolInfo.maxSets = count;
 
+    // sets are only freed individually when images are replaced
+    if (count > 1) {
+        poolInfo.flags = VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT;
+    }
+
     if (vkCreateDescriptorPool(device.logical, &poolInfo, nullptr, &pool) != VK_SUCCESS) {
         throw std::runtime_error("failed to create descriptor pool.");
     }
@@ -60,124 +66,174 @@ VkSampler createTextureSampler(Device& device, uint32_t mipLevels) {
     return sampler;
 }
 
-void Descriptor::createDescriptorSets(Material& material, Assets& assets, uint32_t count, uint32_t mipLevels) {
-    Shader& shader = *(assets.shaders[material.shader]);
-
-    std::vector<VkDescriptorSetLayout> layouts(count, shader.descriptorLayout);
+VkDescriptorSet Descriptor::allocateDescriptorSet() {
     VkDescriptorSetAllocateInfo allocInfo = {};
     allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
     allocInfo.descriptorPool = pool;
-    allocInfo.descriptorSetCount = static_cast<uint32_t>(count);
-    allocInfo.pSetLayouts = layouts.data();
+    allocInfo.descriptorSetCount = 1;
+    allocInfo.pSetLayouts = &shader->descriptorLayout;
 
-    descriptorSets.resize(count);
-    if (vkAllocateDescriptorSets(device.logical, &allocInfo, descriptorSets.data()) != VK_SUCCESS) {
+    VkDescriptorSet result = VK_NULL_HANDLE;
+    if (vkAllocateDescriptorSets(device.logical, &allocInfo, &result) != VK_SUCCESS) {
         throw std::runtime_error("failed to allocate descriptor sets");
     }
 
+    return result;
+}
+
+void Descriptor::createDescriptorSet(Material& material, Assets& assets, UniformArena& uniformArena, uint32_t mipLevels) {
+    Shader& shader = *(assets.shaders[material.shader]);
+    descriptorSet = allocateDescriptorSet();
 
-    for (size_t ds = 0; ds < descriptorSets.size(); ds++) {
-        std::vector<VkWriteDescriptorSet> descriptorWrites;
+    std::vector<VkWriteDescriptorSet> descriptorWrites;
 
-        std::vector<VkDescriptorBufferInfo> bufferInfos;
-        bufferInfos.reserve(shader.info.getUniformTypeCount(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER));
+    std::vector<VkDescriptorBufferInfo> bufferInfos;
+    bufferInfos.reserve(shader.info.getUniformTypeCount(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC));
 
-        std::vector< VkDescriptorImageInfo> imageInfos;
-        imageInfos.reserve(shader.info.getUniformTypeCount(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER));
+    std::vector< VkDescriptorImageInfo> imageInfos;
+    imageInfos.reserve(shader.info.getUniformTypeCount(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER));
 
-        for (size_t i = 0; i < shader.info.uniforms.size(); i++) {
-            const Uniform& uniform = shader.info.uniforms[i];
+    for (size_t i = 0; i < shader.info.uniforms.size(); i++) {
+        const Uniform& uniform = shader.info.uniforms[i];
+
+        VkWriteDescriptorSet descriptorWrite = {};
+        descriptorWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        descriptorWrite.dstSet = descriptorSet;
+        descriptorWrite.dstBinding = static_cast<uint32_t>(i);
+        descriptorWrite.dstArrayElement = 0;
+        descriptorWrite.descriptorCount = 1;
+        descriptorWrite.descriptorType = uniform.type;
+
+        if (uniform.type == VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC) {
+            // the descriptor covers a single uniform at the start of the arena.  The dynamic offset supplied at bind time selects the actual data.
+            VkDescriptorBufferInfo bufferInfo = {};
+            bufferInfo.buffer = uniformArena.buffer.buffer;
+            bufferInfo.offset = 0;
+            bufferInfo.range = static_cast<VkDeviceSize>(uniform.size);
+            bufferInfos.push_back(bufferInfo);
+
+            descriptorWrite.pBufferInfo = &bufferInfos.back();
+            descriptorWrite.pImageInfo = nullptr;
+        }
+        else if (uniform.type == VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER) {
+            VkSampler sampler = [&](){
+                auto result = samplers.find(uniform.name);
+                if (result == samplers.end()) {
+                    VkSampler sampler = createTextureSampler(device, mipLevels);
+                    samplers[uniform.name] = sampler;
+                    return sampler;
+                }
+                else {
+                    return result->second;
+                }
+            }();
 
-            VkWriteDescriptorSet descriptorWrite = {};
-            descriptorWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-            descriptorWrite.dstSet = descriptorSets[ds];
-            descriptorWrite.dstBinding = static_cast<uint32_t>(i);
-            descriptorWrite.dstArrayElement = 0;
-            descriptorWrite.descriptorCount = 1;
-            descriptorWrite.descriptorType = uniform.type;
+            // create the imageinfo struct for this sampler
+            VkDescriptorImageInfo imageInfo = {};
+            imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
 
-            if (uniform.type == VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER) {
-                auto& uniformBufferVector = uniformBuffers[uniform.name];
-                uniformBufferVector.reserve(count);
+            auto textureImage = material.textures.find(uniform.name);
 
-                // create the actual backing buffers that will hold the data accessed by the shader
-                for (uint32_t i = 0; i < count; i++) {
-                    auto& uniformBuffer = uniformBufferVector.emplace_back(device);
-                    uniformBuffer.create(uniform.size, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VmaMemoryUsage::VMA_MEMORY_USAGE_CPU_ONLY);
-                }
+            imageInfo.imageView = textureImage->second->view;
+            imageInfo.sampler = sampler;
+            imageInfos.push_back(imageInfo);
 
-                // create the bufferInfo struct for this buffer
-                VkDescriptorBufferInfo bufferInfo = {};
-                bufferInfo.buffer = uniformBufferVector[i].buffer;
-                bufferInfo.offset = 0;
-                bufferInfo.range = static_cast<VkDeviceSize>(uniform.size);
-                bufferInfos.push_back(bufferInfo);
-
-                descriptorWrite.pBufferInfo = &bufferInfos.back();
-                descriptorWrite.pImageInfo = nullptr;
-            }
-            else if (uniform.type == VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER) {
-                VkSampler sampler = [&](){
-                    auto result = samplers.find(uniform.name);
-                    if (result == samplers.end()) {
-                        VkSampler sampler = createTextureSampler(device, mipLevels);
-                        samplers[uniform.name] = sampler;
-                        return sampler;
-                    }
-                    else {
-                        return result->second;
-                    }
-                }();
-
-                // create the imageinfo struct for this sampler
-                VkDescriptorImageInfo imageInfo = {};
-                imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-
-                auto textureImage = material.textures.find(uniform.name);
-
-                imageInfo.imageView = textureImage->second->view;
-                imageInfo.sampler = sampler;
-                imageInfos.push_back(imageInfo);
-
-                descriptorWrite.pImageInfo = &imageInfos.back();
-                descriptorWrite.pBufferInfo = nullptr;
-            }
-
-            descriptorWrite.pTexelBufferView = nullptr;
-            descriptorWrite.pNext = nullptr;
-
-            descriptorWrites.push_back(descriptorWrite);
+            descriptorWrite.pImageInfo = &imageInfos.back();
+            descriptorWrite.pBufferInfo = nullptr;
+        }
+        else {
+            throw std::runtime_error("unsupported descriptor type for uniform: " + uniform.name);
         }
 
-        vkUpdateDescriptorSets(device.logical, static_cast<uint32_t>(descriptorWrites.size()), descriptorWrites.data(), 0, nullptr);
+        descriptorWrite.pTexelBufferView = nullptr;
+        descriptorWrite.pNext = nullptr;
 
+        descriptorWrites.push_back(descriptorWrite);
     }
 
-
+    vkUpdateDescriptorSets(device.logical, static_cast<uint32_t>(descriptorWrites.size()), descriptorWrites.data(), 0, nullptr);
 }
 
-void Descriptor::create(Material& material, Assets& assets, uint32_t count, uint32_t mipLevels) {
+void Descriptor::create(Material& material, Assets& assets, UniformArena& uniformArena, uint32_t mipLevels, uint32_t maxSets) {
     auto shader = assets.shaders.find(material.shader);
 
     if (shader != assets.shaders.end()) {
-        createPool(*shader->second, count);
-        createDescriptorSets(material, assets, count, mipLevels);
+        this->shader = shader->second.get();
+        createPool(*shader->second, maxSets);
+        createDescriptorSet(material, assets, uniformArena, mipLevels);
     }
     else {
         throw std::runtime_error("Could not create descriptor.  Unknown shader: " + material.shader);
     }
 }
 
-void Descriptor::cleanup() {
-    vkDestroyDescriptorPool(device.logical, pool, nullptr);
+// Every binding other than the image is copied from the current set, so the new set keeps the same uniform buffers and samplers
+void Descriptor::replaceImage(const std::string& uniformName, const Image& image, uint64_t retireFrame) {
+    const std::vector<Uniform>& uniforms = shader->info.uniforms;
 
-    for (auto& uniformBufferVector : uniformBuffers) {
-        for (size_t i = 0; i < uniformBufferVector.second.size(); i++) {
-            uniformBufferVector.second[i].cleanup();
+    auto uniform = std::find_if(uniforms.begin(), uniforms.end(), [&uniformName](const Uniform& u) { return u.name == uniformName; });
+    if (uniform == uniforms.end() || uniform->type != VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER) {
+        throw std::runtime_error("descriptor has no combined image sampler named: " + uniformName);
+    }
+
+    const uint32_t imageBinding = static_cast<uint32_t>(uniform - uniforms.begin());
+    VkDescriptorSet replacement = allocateDescriptorSet();
+
+    std::vector<VkCopyDescriptorSet> descriptorCopies;
+    for (uint32_t binding = 0; binding < uniforms.size(); binding++) {
+        if (binding == imageBinding) {
+            continue;
+        }
+
+        VkCopyDescriptorSet descriptorCopy = {};
+        descriptorCopy.sType = VK_STRUCTURE_TYPE_COPY_DESCRIPTOR_SET;
+        descriptorCopy.srcSet = descriptorSet;
+        descriptorCopy.srcBinding = binding;
+        descriptorCopy.dstSet = replacement;
+        descriptorCopy.dstBinding = binding;
+        descriptorCopy.descriptorCount = 1;
+        descriptorCopies.push_back(descriptorCopy);
+    }
+
+    VkDescriptorImageInfo imageInfo = {};
+    imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    imageInfo.imageView = image.view;
+    imageInfo.sampler = samplers.at(uniformName);
+
+    VkWriteDescriptorSet descriptorWrite = {};
+    descriptorWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    descriptorWrite.dstSet = replacement;
+    descriptorWrite.dstBinding = imageBinding;
+    descriptorWrite.dstArrayElement = 0;
+    descriptorWrite.descriptorCount = 1;
+    descriptorWrite.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    descriptorWrite.pImageInfo = &imageInfo;
+
+    vkUpdateDescriptorSets(device.logical, 1, &descriptorWrite, static_cast<uint32_t>(descriptorCopies.size()), descriptorCopies.data());
+
+    retiredSets.push_back({ descriptorSet, retireFrame });
+    descriptorSet = replacement;
+}
+
+void Descriptor::releaseRetiredSets(uint64_t frame) {
+    for (size_t i = 0; i < retiredSets.size();) {
+        if (retiredSets[i].retireFrame <= frame) {
+            vkFreeDescriptorSets(device.logical, pool, 1, &retiredSets[i].descriptorSet);
+            retiredSets[i] = retiredSets.back();
+            retiredSets.pop_back();
+        }
+        else {
+            i++;
         }
     }
+}
 
-    uniformBuffers.clear();
+void Descriptor::cleanup() {
+    // destroying the pool frees every set allocated from it, including retired ones
+    vkDestroyDescriptorPool(device.logical, pool, nullptr);
+    descriptorSet = VK_NULL_HANDLE;
+    retiredSets.clear();
+    shader = nullptr;
 
     for (auto& sampler : samplers) {
         vkDestroySampler(device.logical, sampler.second, nullptr);
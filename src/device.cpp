@@ -26,9 +26,13 @@ bool deviceSupportsRequiredExtensions(VkPhysicalDevice physicalDevice, const std
 
 bool phsicalDeviceIsSuitable(VkPhysicalDevice physicalDevice, VkSurfaceKHR surface, const std::vector<std::string>& requiredDeviceExtensions) {
     // ensure that this physical device has both graphics and presentation queues.
+    // headless devices (no surface) only require a graphics queue.
     try {
         vkdev::Queue::findGraphicsQueueIndex(physicalDevice);
-        vkdev::Queue::findPresentationQueueIndex(physicalDevice, surface);
+
+        if (surface != VK_NULL_HANDLE) {
+            vkdev::Queue::findPresentationQueueIndex(physicalDevice, surface);
+        }
     }
     catch (std::runtime_error e) {
         return false;
@@ -37,8 +41,12 @@ bool phsicalDeviceIsSuitable(VkPhysicalDevice physicalDevice, VkSurfaceKHR surfa
     bool requiredExtensionsSupported = deviceSupportsRequiredExtensions(physicalDevice, requiredDeviceExtensions);
 
     if (requiredExtensionsSupported) {
-        SwapChainSupportInfo info = SwapChainSupportInfo::getForDevice(physicalDevice, surface);
-        bool swapChainAdequate = !info.formats.empty() && !info.presentModes.empty();
+        bool swapChainAdequate = true;
+
+        if (surface != VK_NULL_HANDLE) {
+            SwapChainSupportInfo info = SwapChainSupportInfo::getForDevice(physicalDevice, surface);
+            swapChainAdequate = !info.formats.empty() && !info.presentModes.empty();
+        }
 
         // note that most modern hardware will support samplerAnisotropy but we will just confirm the same
         VkPhysicalDeviceFeatures supportedFeatures;
@@ -74,11 +82,16 @@ void Device::createPhysicalDevice(const std::vector<std::string>& requiredDevice
 
 void Device::createLogicalDevice(const std::vector<std::string>& requiredDeviceExtensions) {
     graphicsQueue.index = vkdev::Queue::findGraphicsQueueIndex(physical);
-    presentationQueue.index = vkdev::Queue::findPresentationQueueIndex(physical, surface);
+    transferQueue.index = vkdev::Queue::findTransferQueueIndex(physical);
 
     // will need to create a device queue for each unique family.  It is possible that the different queue types will be part of the same family.
     std::vector<VkDeviceQueueCreateInfo> deviceQueueInfos;
-    std::set<uint32_t> uniqueQueueFamilies = { graphicsQueue.index, presentationQueue.index };
+    std::set<uint32_t> uniqueQueueFamilies = { graphicsQueue.index, transferQueue.index };
+
+    if (!isHeadless()) {
+        presentationQueue.index = vkdev::Queue::findPresentationQueueIndex(physical, surface);
+        uniqueQueueFamilies.insert(presentationQueue.index);
+    }
 
     float queuePriority = 1.0f;
     for (const auto& queueFamily : uniqueQueueFamilies) {
@@ -94,9 +107,21 @@ void Device::createLogicalDevice(const std::vector<std::string>& requiredDeviceE
     }
 
 
+    VkPhysicalDeviceFeatures supportedFeatures;
+    vkGetPhysicalDeviceFeatures(physical, &supportedFeatures);
+
     VkPhysicalDeviceFeatures deviceFeatures = {};
     deviceFeatures.samplerAnisotropy = VK_TRUE; // anisotropic filtering is disabled by default
 
+    // GPU driven rendering reads many draws from one buffer and uses the first instance to index per instance data
+    multiDrawIndirectSupported = supportedFeatures.multiDrawIndirect && supportedFeatures.drawIndirectFirstInstance;
+    deviceFeatures.multiDrawIndirect = supportedFeatures.multiDrawIndirect;
+    deviceFeatures.drawIndirectFirstInstance = supportedFeatures.drawIndirectFirstInstance;
+
+    // block compressed textures are sampled directly when supported, otherwise they are decompressed when loaded
+    deviceFeatures.textureCompressionBC = supportedFeatures.textureCompressionBC;
+    deviceFeatures.textureCompressionASTC_LDR = supportedFeatures.textureCompressionASTC_LDR;
+
     VkDeviceCreateInfo deviceCreateInfo = {};
     deviceCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
 
@@ -110,6 +135,19 @@ void Device::createLogicalDevice(const std::vector<std::string>& requiredDeviceE
     for (const auto& extensionStr : requiredDeviceExtensions) {
         extensionCstrVec.push_back(extensionStr.c_str());
     }
+
+    // the memory budget extension is optional and only used for telemetry
+    memoryBudgetSupported = deviceSupportsRequiredExtensions(physical, { VK_EXT_MEMORY_BUDGET_EXTENSION_NAME });
+    if (memoryBudgetSupported) {
+        extensionCstrVec.push_back(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+    }
+
+    // lets the number of indirect draws be written by a compute shader.  Without it every slot is drawn and culled draws have no instances.
+    const bool drawIndirectCountSupported = multiDrawIndirectSupported && deviceSupportsRequiredExtensions(physical, { VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME });
+    if (drawIndirectCountSupported) {
+        extensionCstrVec.push_back(VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME);
+    }
+
     deviceCreateInfo.enabledExtensionCount = static_cast<uint32_t>(extensionCstrVec.size());
     deviceCreateInfo.ppEnabledExtensionNames = extensionCstrVec.data();
 
@@ -119,7 +157,15 @@ void Device::createLogicalDevice(const std::vector<std::string>& requiredDeviceE
 
     // after device creation is successful, need to grab a handle to our queues
     vkGetDeviceQueue(logical, graphicsQueue.index, 0, &graphicsQueue.handle);
-    vkGetDeviceQueue(logical, presentationQueue.index, 0, &presentationQueue.handle);
+    vkGetDeviceQueue(logical, transferQueue.index, 0, &transferQueue.handle);
+
+    if (!isHeadless()) {
+        vkGetDeviceQueue(logical, presentationQueue.index, 0, &presentationQueue.handle);
+    }
+
+    if (drawIndirectCountSupported) {
+        cmdDrawIndexedIndirectCount = reinterpret_cast<PFN_vkCmdDrawIndexedIndirectCountKHR>(vkGetDeviceProcAddr(logical, "vkCmdDrawIndexedIndirectCountKHR"));
+    }
 }
 
 void Device::createAllocator(){
@@ -129,6 +175,9 @@ void Device::createAllocator(){
     allocatorInfo.instance = instance.handle;
 
     vmaCreateAllocator(&allocatorInfo, &allocator);
+
+    memory = std::make_shared<MemoryTelemetry>();
+    memory->create(physical, allocator, memoryBudgetSupported);
 }
 
 void Device::create(const std::vector<std::string>& requiredDeviceExtensions) {
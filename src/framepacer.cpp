@@ -0,0 +1,60 @@
+#include "vkdev/framepacer.h"
+
+#include <algorithm>
+#include <thread>
+
+namespace vkdev {
+
+VkPresentModeKHR FramePacer::getPresentMode() const {
+    switch (mode) {
+        case FramePacingMode::Uncapped:
+        case FramePacingMode::TargetFps:
+            return VK_PRESENT_MODE_IMMEDIATE_KHR;
+
+        case FramePacingMode::VSync:
+        default:
+            return vsyncPresentMode;
+    }
+}
+
+// sleeping is only accurate to around a millisecond on most platforms, so the final portion of the wait yields instead
+void FramePacer::waitUntil(Clock::time_point deadline) const {
+    const auto spinThreshold = std::chrono::milliseconds(1);
+
+    auto now = Clock::now();
+    if (deadline - now > spinThreshold) {
+        std::this_thread::sleep_until(deadline - spinThreshold);
+    }
+
+    while (Clock::now() < deadline) {
+        std::this_thread::yield();
+    }
+}
+
+void FramePacer::beginFrame() {
+    if (mode == FramePacingMode::TargetFps && targetFps > 0.0) {
+        const auto frameDuration = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / targetFps));
+
+        if (started) {
+            waitUntil(nextFrameDeadline);
+
+            // if we have fallen more than a frame behind, do not try to catch up by rendering a burst of frames
+            nextFrameDeadline = std::max(nextFrameDeadline + frameDuration, Clock::now());
+        }
+        else {
+            nextFrameDeadline = Clock::now() + frameDuration;
+        }
+    }
+
+    started = true;
+    frameStart = Clock::now();
+}
+
+void FramePacer::endFrame() {
+    lastLatencyMilliseconds = std::chrono::duration<double, std::chrono::milliseconds::period>(Clock::now() - frameStart).count();
+    maxLatencyMilliseconds = std::max(maxLatencyMilliseconds, lastLatencyMilliseconds);
+    totalLatencyMilliseconds += lastLatencyMilliseconds;
+    frameCount += 1;
+}
+
+}
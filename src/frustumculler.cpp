@@ -0,0 +1,258 @@
+#include "vkdev/frustumculler.h"
+
+#include <algorithm>
+#include <cmath>
+
+#if defined(__AVX__)
+#define VKDEV_CULL_AVX
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define VKDEV_CULL_SSE
+#include <emmintrin.h>
+#endif
+
+namespace vkdev {
+
+Frustum Frustum::fromViewProjection(const glm::mat4& viewProjection) {
+    auto row = [&viewProjection](int i) {
+        return glm::vec4(viewProjection[0][i], viewProjection[1][i], viewProjection[2][i], viewProjection[3][i]);
+    };
+
+    Frustum frustum;
+    frustum.planes[0] = row(3) + row(0); // left
+    frustum.planes[1] = row(3) - row(0); // right
+    frustum.planes[2] = row(3) + row(1); // bottom
+    frustum.planes[3] = row(3) - row(1); // top
+    frustum.planes[4] = row(2);          // near, clip space z starts at 0 in Vulkan
+    frustum.planes[5] = row(3) - row(2); // far
+
+    for (auto& plane : frustum.planes) {
+        plane /= glm::length(glm::vec3(plane));
+    }
+
+    return frustum;
+}
+
+void FrustumCuller::reserve(size_t instanceCount) {
+    for (auto* component : { &centerX, &centerY, &centerZ, &extentX, &extentY, &extentZ }) {
+        component->reserve(instanceCount);
+    }
+}
+
+void FrustumCuller::clear() {
+    for (auto* component : { &centerX, &centerY, &centerZ, &extentX, &extentY, &extentZ }) {
+        component->clear();
+    }
+}
+
+uint32_t FrustumCuller::add(const Bounds& bounds) {
+    const uint32_t index = static_cast<uint32_t>(size());
+
+    for (auto* component : { &centerX, &centerY, &centerZ, &extentX, &extentY, &extentZ }) {
+        component->push_back(0.0f);
+    }
+
+    set(index, bounds);
+
+    return index;
+}
+
+void FrustumCuller::set(uint32_t index, const Bounds& bounds) {
+    const glm::vec3 center = (bounds.min + bounds.max) * 0.5f;
+    const glm::vec3 extent = (bounds.max - bounds.min) * 0.5f;
+
+    centerX[index] = center.x;
+    centerY[index] = center.y;
+    centerZ[index] = center.z;
+    extentX[index] = extent.x;
+    extentY[index] = extent.y;
+    extentZ[index] = extent.z;
+}
+
+const char* FrustumCuller::getSimdName() {
+#if defined(VKDEV_CULL_AVX)
+    return "avx";
+#elif defined(VKDEV_CULL_SSE)
+    return "sse2";
+#else
+    return "scalar";
+#endif
+}
+
+size_t FrustumCuller::cull(const Frustum& frustum, std::vector<uint32_t>& visible) {
+    visible.clear();
+
+    const size_t instanceCount = size();
+    const size_t maxRanges = jobSystem == nullptr ? 1 : (threadCount > 0 ? threadCount : jobSystem->getThreadCount());
+    const size_t rangeCount = instanceCount < parallelThreshold ? 1 : std::min(maxRanges, instanceCount / std::max<size_t>(parallelThreshold / 2, 1));
+
+    if (rangeCount <= 1) {
+        cullRange(frustum, 0, instanceCount, visible);
+        return visible.size();
+    }
+
+    // ranges are multiples of 8 so that only the final range has a partial SIMD block
+    const size_t rangeSize = ((instanceCount + rangeCount - 1) / rangeCount + 7) & ~static_cast<size_t>(7);
+
+    rangeVisible.resize(rangeCount);
+    JobCounter counter;
+
+    for (size_t i = 1; i < rangeCount; i++) {
+        const size_t begin = std::min(i * rangeSize, instanceCount);
+        const size_t end = std::min(begin + rangeSize, instanceCount);
+
+        jobSystem->run([this, &frustum, begin, end, i]() {
+            rangeVisible[i].clear();
+            cullRange(frustum, begin, end, rangeVisible[i]);
+        }, &counter);
+    }
+
+    // the calling thread handles the first range and writes directly to the output
+    cullRange(frustum, 0, std::min(rangeSize, instanceCount), visible);
+    jobSystem->wait(counter);
+
+    for (size_t i = 1; i < rangeCount; i++) {
+        visible.insert(visible.end(), rangeVisible[i].begin(), rangeVisible[i].end());
+    }
+
+    return visible.size();
+}
+
+void FrustumCuller::cullRange(const Frustum& frustum, size_t begin, size_t end, std::vector<uint32_t>& visible) const {
+    if (useSimd) {
+        cullRangeSimd(frustum, begin, end, visible);
+    }
+    else {
+        cullRangeScalar(frustum, begin, end, visible);
+    }
+}
+
+void FrustumCuller::cullRangeScalar(const Frustum& frustum, size_t begin, size_t end, std::vector<uint32_t>& visible) const {
+    for (size_t i = begin; i < end; i++) {
+        bool inside = true;
+
+        for (const auto& plane : frustum.planes) {
+            const float distance = plane.x * centerX[i] + plane.y * centerY[i] + plane.z * centerZ[i] + plane.w;
+            const float radius = std::abs(plane.x) * extentX[i] + std::abs(plane.y) * extentY[i] + std::abs(plane.z) * extentZ[i];
+
+            if (distance + radius < 0.0f) {
+                inside = false;
+                break;
+            }
+        }
+
+        if (inside) {
+            visible.push_back(static_cast<uint32_t>(i));
+        }
+    }
+}
+
+#if defined(VKDEV_CULL_AVX)
+
+void FrustumCuller::cullRangeSimd(const Frustum& frustum, size_t begin, size_t end, std::vector<uint32_t>& visible) const {
+    __m256 planeX[6], planeY[6], planeZ[6], planeW[6], absX[6], absY[6], absZ[6];
+
+    for (int p = 0; p < 6; p++) {
+        planeX[p] = _mm256_set1_ps(frustum.planes[p].x);
+        planeY[p] = _mm256_set1_ps(frustum.planes[p].y);
+        planeZ[p] = _mm256_set1_ps(frustum.planes[p].z);
+        planeW[p] = _mm256_set1_ps(frustum.planes[p].w);
+        absX[p] = _mm256_set1_ps(std::abs(frustum.planes[p].x));
+        absY[p] = _mm256_set1_ps(std::abs(frustum.planes[p].y));
+        absZ[p] = _mm256_set1_ps(std::abs(frustum.planes[p].z));
+    }
+
+    const __m256 zero = _mm256_setzero_ps();
+    size_t i = begin;
+
+    for (; i + 8 <= end; i += 8) {
+        const __m256 cx = _mm256_loadu_ps(&centerX[i]);
+        const __m256 cy = _mm256_loadu_ps(&centerY[i]);
+        const __m256 cz = _mm256_loadu_ps(&centerZ[i]);
+        const __m256 ex = _mm256_loadu_ps(&extentX[i]);
+        const __m256 ey = _mm256_loadu_ps(&extentY[i]);
+        const __m256 ez = _mm256_loadu_ps(&extentZ[i]);
+
+        __m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+
+        for (int p = 0; p < 6; p++) {
+            __m256 distance = _mm256_add_ps(_mm256_mul_ps(planeX[p], cx), planeW[p]);
+            distance = _mm256_add_ps(distance, _mm256_mul_ps(planeY[p], cy));
+            distance = _mm256_add_ps(distance, _mm256_mul_ps(planeZ[p], cz));
+            distance = _mm256_add_ps(distance, _mm256_mul_ps(absX[p], ex));
+            distance = _mm256_add_ps(distance, _mm256_mul_ps(absY[p], ey));
+            distance = _mm256_add_ps(distance, _mm256_mul_ps(absZ[p], ez));
+
+            inside = _mm256_and_ps(inside, _mm256_cmp_ps(distance, zero, _CMP_GE_OQ));
+        }
+
+        const int mask = _mm256_movemask_ps(inside);
+        for (int lane = 0; lane < 8; lane++) {
+            if (mask & (1 << lane)) {
+                visible.push_back(static_cast<uint32_t>(i + lane));
+            }
+        }
+    }
+
+    cullRangeScalar(frustum, i, end, visible);
+}
+
+#elif defined(VKDEV_CULL_SSE)
+
+void FrustumCuller::cullRangeSimd(const Frustum& frustum, size_t begin, size_t end, std::vector<uint32_t>& visible) const {
+    __m128 planeX[6], planeY[6], planeZ[6], planeW[6], absX[6], absY[6], absZ[6];
+
+    for (int p = 0; p < 6; p++) {
+        planeX[p] = _mm_set1_ps(frustum.planes[p].x);
+        planeY[p] = _mm_set1_ps(frustum.planes[p].y);
+        planeZ[p] = _mm_set1_ps(frustum.planes[p].z);
+        planeW[p] = _mm_set1_ps(frustum.planes[p].w);
+        absX[p] = _mm_set1_ps(std::abs(frustum.planes[p].x));
+        absY[p] = _mm_set1_ps(std::abs(frustum.planes[p].y));
+        absZ[p] = _mm_set1_ps(std::abs(frustum.planes[p].z));
+    }
+
+    const __m128 zero = _mm_setzero_ps();
+    size_t i = begin;
+
+    for (; i + 4 <= end; i += 4) {
+        const __m128 cx = _mm_loadu_ps(&centerX[i]);
+        const __m128 cy = _mm_loadu_ps(&centerY[i]);
+        const __m128 cz = _mm_loadu_ps(&centerZ[i]);
+        const __m128 ex = _mm_loadu_ps(&extentX[i]);
+        const __m128 ey = _mm_loadu_ps(&extentY[i]);
+        const __m128 ez = _mm_loadu_ps(&extentZ[i]);
+
+        __m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+
+        for (int p = 0; p < 6; p++) {
+            __m128 distance = _mm_add_ps(_mm_mul_ps(planeX[p], cx), planeW[p]);
+            distance = _mm_add_ps(distance, _mm_mul_ps(planeY[p], cy));
+            distance = _mm_add_ps(distance, _mm_mul_ps(planeZ[p], cz));
+            distance = _mm_add_ps(distance, _mm_mul_ps(absX[p], ex));
+            distance = _mm_add_ps(distance, _mm_mul_ps(absY[p], ey));
+            distance = _mm_add_ps(distance, _mm_mul_ps(absZ[p], ez));
+
+            inside = _mm_and_ps(inside, _mm_cmpge_ps(distance, zero));
+        }
+
+        const int mask = _mm_movemask_ps(inside);
+        for (int lane = 0; lane < 4; lane++) {
+            if (mask & (1 << lane)) {
+                visible.push_back(static_cast<uint32_t>(i + lane));
+            }
+        }
+    }
+
+    cullRangeScalar(frustum, i, end, visible);
+}
+
+#else
+
+void FrustumCuller::cullRangeSimd(const Frustum& frustum, size_t begin, size_t end, std::vector<uint32_t>& visible) const {
+    cullRangeScalar(frustum, begin, end, visible);
+}
+
+#endif
+
+}
@@ -0,0 +1,302 @@
+#include "vkdev/gpuculler.h"
+
+#include "vkdev/frustumculler.h"
+#include "vkdev/shader.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+
+namespace vkdev {
+
+// the following structures mirror the std430 layouts declared in cull.comp.glsl
+struct GpuLod {
+    uint32_t firstIndex;
+    uint32_t indexCount;
+    int32_t vertexOffset;
+    float error;
+};
+
+struct CullParams {
+    glm::vec4 planes[6];
+    glm::mat4 view;
+    float pixelsPerUnit;
+    float pixelError;
+    uint32_t instanceCount;
+    uint32_t lodCount;
+    GpuLod lods[GpuCuller::MAX_LODS];
+};
+
+struct CullPushConstants {
+    uint32_t frameIndex;
+    uint32_t drawOffset;
+    uint32_t maxDraws;
+    uint32_t compact;
+};
+
+static_assert(sizeof(GpuInstance) == 96, "GpuInstance must match the std430 layout of Instance");
+static_assert(sizeof(CullParams) == 304, "CullParams must match the std430 layout of CullParams");
+static_assert(sizeof(VkDrawIndexedIndirectCommand) == 20, "DrawCommand must match VkDrawIndexedIndirectCommand");
+
+void GpuCuller::create(Mesh& mesh_, uint32_t maxInstances_, uint32_t frameCount, const std::string& shaderPath) {
+    // the instance index is passed to the vertex shader through the first instance of each draw
+    if (!device.multiDrawIndirectSupported) {
+        throw std::runtime_error("gpu culling requires the multiDrawIndirect and drawIndirectFirstInstance features");
+    }
+
+    mesh = &mesh_;
+    maxInstances = maxInstances_;
+    instanceCount = maxInstances_;
+
+    // instances and parameters are written by the host every frame, the draws and counts are only touched by the device
+    instanceBuffer.createMapped(maxInstances * sizeof(GpuInstance), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VmaMemoryUsage::VMA_MEMORY_USAGE_CPU_TO_GPU);
+    paramsBuffer.createMapped(frameCount * sizeof(CullParams), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VmaMemoryUsage::VMA_MEMORY_USAGE_CPU_TO_GPU, MemoryCategory::Uniform);
+    drawBuffer.create(frameCount * maxInstances * sizeof(VkDrawIndexedIndirectCommand), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT, VmaMemoryUsage::VMA_MEMORY_USAGE_GPU_ONLY);
+    countBuffer.create(frameCount * sizeof(uint32_t), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VmaMemoryUsage::VMA_MEMORY_USAGE_GPU_ONLY);
+
+    for (uint32_t i = 0; i < maxInstances; i++) {
+        setInstance(i, glm::mat4(1.0f));
+    }
+
+    createDescriptors();
+    createPipeline(shaderPath);
+}
+
+void GpuCuller::createDescriptors() {
+    // the cull shader reads instances and parameters and writes draws and counts
+    std::array<VkDescriptorSetLayoutBinding, 4> cullBindings = {};
+    for (uint32_t i = 0; i < cullBindings.size(); i++) {
+        cullBindings[i].binding = i;
+        cullBindings[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        cullBindings[i].descriptorCount = 1;
+        cullBindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    }
+
+    VkDescriptorSetLayoutCreateInfo layoutInfo = {};
+    layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    layoutInfo.bindingCount = static_cast<uint32_t>(cullBindings.size());
+    layoutInfo.pBindings = cullBindings.data();
+
+    if (vkCreateDescriptorSetLayout(device.logical, &layoutInfo, nullptr, &cullLayout) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create cull descriptor set layout");
+    }
+
+    // the vertex shader reads the transform of the instance selected by the draw's first instance
+    VkDescriptorSetLayoutBinding instanceBinding = {};
+    instanceBinding.binding = 0;
+    instanceBinding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    instanceBinding.descriptorCount = 1;
+    instanceBinding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+
+    layoutInfo.bindingCount = 1;
+    layoutInfo.pBindings = &instanceBinding;
+
+    if (vkCreateDescriptorSetLayout(device.logical, &layoutInfo, nullptr, &instanceLayout) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create instance descriptor set layout");
+    }
+
+    VkDescriptorPoolSize poolSize = {};
+    poolSize.type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    poolSize.descriptorCount = static_cast<uint32_t>(cullBindings.size()) + 1;
+
+    VkDescriptorPoolCreateInfo poolInfo = {};
+    poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    poolInfo.poolSizeCount = 1;
+    poolInfo.pPoolSizes = &poolSize;
+    poolInfo.maxSets = 2;
+
+    if (vkCreateDescriptorPool(device.logical, &poolInfo, nullptr, &descriptorPool) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create cull descriptor pool");
+    }
+
+    std::array<VkDescriptorSetLayout, 2> setLayouts = { cullLayout, instanceLayout };
+    std::array<VkDescriptorSet, 2> sets = {};
+
+    VkDescriptorSetAllocateInfo allocInfo = {};
+    allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    allocInfo.descriptorPool = descriptorPool;
+    allocInfo.descriptorSetCount = static_cast<uint32_t>(setLayouts.size());
+    allocInfo.pSetLayouts = setLayouts.data();
+
+    if (vkAllocateDescriptorSets(device.logical, &allocInfo, sets.data()) != VK_SUCCESS) {
+        throw std::runtime_error("failed to allocate cull descriptor sets");
+    }
+
+    cullDescriptorSet = sets[0];
+    instanceDescriptorSet = sets[1];
+
+    // every binding covers the whole buffer, the frame in flight is selected in the shader
+    std::array<VkDescriptorBufferInfo, 4> bufferInfos = {};
+    const Buffer* buffers[] = { &instanceBuffer, &paramsBuffer, &drawBuffer, &countBuffer };
+
+    std::array<VkWriteDescriptorSet, 5> writes = {};
+    for (uint32_t i = 0; i < bufferInfos.size(); i++) {
+        bufferInfos[i].buffer = buffers[i]->buffer;
+        bufferInfos[i].offset = 0;
+        bufferInfos[i].range = VK_WHOLE_SIZE;
+
+        writes[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        writes[i].dstSet = cullDescriptorSet;
+        writes[i].dstBinding = i;
+        writes[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        writes[i].descriptorCount = 1;
+        writes[i].pBufferInfo = &bufferInfos[i];
+    }
+
+    writes[4].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    writes[4].dstSet = instanceDescriptorSet;
+    writes[4].dstBinding = 0;
+    writes[4].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    writes[4].descriptorCount = 1;
+    writes[4].pBufferInfo = &bufferInfos[0];
+
+    vkUpdateDescriptorSets(device.logical, static_cast<uint32_t>(writes.size()), writes.data(), 0, nullptr);
+}
+
+void GpuCuller::createPipeline(const std::string& shaderPath) {
+    VkShaderModule shaderModule = createShaderModule(readFile(shaderPath), device);
+
+    VkPushConstantRange pushConstantRange = {};
+    pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    pushConstantRange.offset = 0;
+    pushConstantRange.size = sizeof(CullPushConstants);
+
+    VkPipelineLayoutCreateInfo pipelineLayoutInfo = {};
+    pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    pipelineLayoutInfo.setLayoutCount = 1;
+    pipelineLayoutInfo.pSetLayouts = &cullLayout;
+    pipelineLayoutInfo.pushConstantRangeCount = 1;
+    pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+
+    if (vkCreatePipelineLayout(device.logical, &pipelineLayoutInfo, nullptr, &pipelineLayout) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create cull pipeline layout");
+    }
+
+    VkComputePipelineCreateInfo pipelineInfo = {};
+    pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+    pipelineInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    pipelineInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+    pipelineInfo.stage.module = shaderModule;
+    pipelineInfo.stage.pName = "main";
+    pipelineInfo.layout = pipelineLayout;
+
+    VkResult result = vkCreateComputePipelines(device.logical, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &pipeline);
+
+    // the module is no longer needed once the pipeline has been created
+    vkDestroyShaderModule(device.logical, shaderModule, nullptr);
+
+    if (result != VK_SUCCESS) {
+        throw std::runtime_error("failed to create cull pipeline");
+    }
+}
+
+void GpuCuller::cleanup() {
+    vkDestroyPipeline(device.logical, pipeline, nullptr);
+    vkDestroyPipelineLayout(device.logical, pipelineLayout, nullptr);
+    vkDestroyDescriptorPool(device.logical, descriptorPool, nullptr);
+    vkDestroyDescriptorSetLayout(device.logical, cullLayout, nullptr);
+    vkDestroyDescriptorSetLayout(device.logical, instanceLayout, nullptr);
+
+    instanceBuffer.cleanup();
+    paramsBuffer.cleanup();
+    drawBuffer.cleanup();
+    countBuffer.cleanup();
+}
+
+void GpuCuller::setInstance(uint32_t index, const glm::mat4& model) {
+    setInstance(index, model, mesh->bounds);
+}
+
+void GpuCuller::setInstance(uint32_t index, const glm::mat4& model, const Bounds& bounds) {
+    GpuInstance instance;
+    instance.model = model;
+    instance.boundsCenter = glm::vec4((bounds.min + bounds.max) * 0.5f, 0.0f);
+    instance.boundsExtent = glm::vec4((bounds.max - bounds.min) * 0.5f, 0.0f);
+
+    const VkDeviceSize offset = index * sizeof(GpuInstance);
+    memcpy(static_cast<uint8_t*>(instanceBuffer.mapped) + offset, &instance, sizeof(instance));
+    vmaFlushAllocation(device.allocator, instanceBuffer.allocation, offset, sizeof(instance));
+}
+
+void GpuCuller::setInstanceCount(uint32_t instanceCount_) {
+    instanceCount = std::min(instanceCount_, maxInstances);
+}
+
+void GpuCuller::update(uint32_t frameIndex, const glm::mat4& view, const glm::mat4& projection, float viewportHeight) {
+    CullParams params = {};
+
+    const Frustum frustum = Frustum::fromViewProjection(projection * view);
+    for (int i = 0; i < 6; i++) {
+        params.planes[i] = frustum.planes[i];
+    }
+
+    // projection[1][1] is cot(fov / 2) and the viewport spans two units of normalized device coordinates
+    params.view = view;
+    params.pixelsPerUnit = std::abs(projection[1][1]) * viewportHeight * 0.5f;
+    params.pixelError = pixelError;
+    params.instanceCount = instanceCount;
+    params.lodCount = std::min(static_cast<uint32_t>(mesh->lods.size()), MAX_LODS);
+
+    for (uint32_t i = 0; i < params.lodCount; i++) {
+        const MeshLod& lod = mesh->lods[i];
+        params.lods[i] = { lod.firstIndex, lod.indexCount, lod.vertexOffset, lod.error };
+    }
+
+    const VkDeviceSize offset = frameIndex * sizeof(CullParams);
+    memcpy(static_cast<uint8_t*>(paramsBuffer.mapped) + offset, &params, sizeof(params));
+    vmaFlushAllocation(device.allocator, paramsBuffer.allocation, offset, sizeof(params));
+}
+
+void GpuCuller::recordCull(VkCommandBuffer commandBuffer, uint32_t frameIndex) {
+    const bool compact = usesDrawCount();
+
+    if (compact) {
+        // the shader appends visible draws to this frame's count, which starts at zero
+        vkCmdFillBuffer(commandBuffer, countBuffer.buffer, frameIndex * sizeof(uint32_t), sizeof(uint32_t), 0);
+
+        VkMemoryBarrier fillBarrier = {};
+        fillBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+        fillBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        fillBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+
+        vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &fillBarrier, 0, nullptr, 0, nullptr);
+    }
+
+    CullPushConstants pushConstants = {};
+    pushConstants.frameIndex = frameIndex;
+    pushConstants.drawOffset = frameIndex * maxInstances;
+    pushConstants.maxDraws = maxInstances;
+    pushConstants.compact = compact ? 1 : 0;
+
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline);
+    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipelineLayout, 0, 1, &cullDescriptorSet, 0, nullptr);
+    vkCmdPushConstants(commandBuffer, pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(pushConstants), &pushConstants);
+
+    // the dispatch covers every slot since the instance count may change after the command buffer is recorded
+    vkCmdDispatch(commandBuffer, (maxInstances + WORKGROUP_SIZE - 1) / WORKGROUP_SIZE, 1, 1);
+
+    VkMemoryBarrier drawBarrier = {};
+    drawBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    drawBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    drawBarrier.dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT;
+
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT, 0, 1, &drawBarrier, 0, nullptr, 0, nullptr);
+}
+
+void GpuCuller::recordDraw(VkCommandBuffer commandBuffer, uint32_t frameIndex, VkPipelineLayout pipelineLayout_, uint32_t setIndex) {
+    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout_, setIndex, 1, &instanceDescriptorSet, 0, nullptr);
+
+    const VkDeviceSize drawOffset = frameIndex * maxInstances * sizeof(VkDrawIndexedIndirectCommand);
+    const uint32_t stride = sizeof(VkDrawIndexedIndirectCommand);
+
+    if (usesDrawCount()) {
+        device.cmdDrawIndexedIndirectCount(commandBuffer, drawBuffer.buffer, drawOffset, countBuffer.buffer, frameIndex * sizeof(uint32_t), maxInstances, stride);
+    }
+    else {
+        vkCmdDrawIndexedIndirect(commandBuffer, drawBuffer.buffer, drawOffset, maxInstances, stride);
+    }
+}
+
+}
@@ -1,15 +1,11 @@
 #include "vkdev/image.h"
 
+#include <algorithm>
 #include <stdexcept>
 
 namespace vkdev {
 
-void Image::create(uint32_t width_, uint32_t height_, uint32_t mipLevels_, VkSampleCountFlagBits numSamples, VkFormat format_, VkImageTiling tiling, VkImageUsageFlags usageFlags, VkMemoryPropertyFlags memoryPropertyFlags) {
-    width = width_;
-    height = height_;
-    mipLevels = mipLevels_;
-    format = format_;
-    
+static VkImageCreateInfo getImageCreateInfo(uint32_t width, uint32_t height, uint32_t mipLevels, VkSampleCountFlagBits numSamples, VkFormat format, VkImageTiling tiling, VkImageUsageFlags usageFlags) {
     VkImageCreateInfo imageInfo = {};
     imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
     imageInfo.imageType = VK_IMAGE_TYPE_2D;
@@ -26,29 +22,67 @@ void Image::create(uint32_t width_, uint32_t height_, uint32_t mipLevels_, VkSam
     imageInfo.samples = numSamples;
     imageInfo.flags = 0; // Optional
 
-    if (vkCreateImage(device.logical, &imageInfo, nullptr, &handle) != VK_SUCCESS) {
+    return imageInfo;
+}
+
+// memory is allocated through VMA which sub-allocates from large blocks rather than making a driver allocation per image
+void Image::create(uint32_t width_, uint32_t height_, uint32_t mipLevels_, VkSampleCountFlagBits numSamples, VkFormat format_, VkImageTiling tiling, VkImageUsageFlags usageFlags, VkMemoryPropertyFlags memoryPropertyFlags, MemoryCategory category) {
+    width = width_;
+    height = height_;
+    mipLevels = mipLevels_;
+    format = format_;
+
+    VkImageCreateInfo imageInfo = getImageCreateInfo(width, height, mipLevels, numSamples, format, tiling, usageFlags);
+
+    VmaAllocationCreateInfo allocInfo = {};
+    allocInfo.usage = VmaMemoryUsage::VMA_MEMORY_USAGE_GPU_ONLY;
+    allocInfo.requiredFlags = memoryPropertyFlags;
+
+    // transient attachments never leave tile memory on some GPUs, in which case they do not need to be backed by physical memory
+    if (usageFlags & VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT) {
+        allocInfo.preferredFlags = VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT;
+    }
+
+    if (vmaCreateImage(device.allocator, &imageInfo, &allocInfo, &handle, &allocation, nullptr) != VK_SUCCESS) {
         throw std::runtime_error("failed to create image.");
     }
 
-    VkMemoryRequirements memoryRequirements;
-    vkGetImageMemoryRequirements(device.logical, handle, &memoryRequirements);
+    ownsAllocation = true;
+    device.memory->track(allocation, category);
+}
+
+void Image::createUnbound(uint32_t width_, uint32_t height_, uint32_t mipLevels_, VkSampleCountFlagBits numSamples, VkFormat format_, VkImageTiling tiling, VkImageUsageFlags usageFlags) {
+    width = width_;
+    height = height_;
+    mipLevels = mipLevels_;
+    format = format_;
+
+    VkImageCreateInfo imageInfo = getImageCreateInfo(width, height, mipLevels, numSamples, format, tiling, usageFlags);
+
+    if (vkCreateImage(device.logical, &imageInfo, nullptr, &handle) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create image.");
+    }
 
-    VkMemoryAllocateInfo allocInfo = {};
-    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-    allocInfo.allocationSize = memoryRequirements.size;
-    allocInfo.memoryTypeIndex = vkdev::Buffer::findMemoryType(device.physical, memoryRequirements.memoryTypeBits, memoryPropertyFlags);
+    allocation = VK_NULL_HANDLE;
+    ownsAllocation = false;
+}
 
-    if (vkAllocateMemory(device.logical, &allocInfo, nullptr, &memory) != VK_SUCCESS) {
-        throw std::runtime_error("failed to allocate image memory");
+void Image::bindMemory(VmaAllocation memory) {
+    if (vmaBindImageMemory(device.allocator, memory, handle) != VK_SUCCESS) {
+        throw std::runtime_error("failed to bind image memory");
     }
 
-    vkBindImageMemory(device.logical, handle, memory, 0);
+    allocation = memory;
 }
 
 void Image::transitionLayout(CommandPool& commandPool, VkImageLayout oldLayout, VkImageLayout newLayout) {
     auto commandBuffer = commandPool.createSingleUseBuffer();
     commandBuffer.start();
+    transitionLayout(commandBuffer.handle, oldLayout, newLayout);
+    commandBuffer.submit();
+}
 
+void Image::transitionLayout(VkCommandBuffer commandBuffer, VkImageLayout oldLayout, VkImageLayout newLayout) {
     VkImageMemoryBarrier barrier = {};
     barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
     barrier.oldLayout = oldLayout;
@@ -108,38 +142,52 @@ void Image::transitionLayout(CommandPool& commandPool, VkImageLayout oldLayout,
     }
 
     // describe which operations must happen before the barrier and which operations must wait on the barrier
-    vkCmdPipelineBarrier(commandBuffer.handle,
+    vkCmdPipelineBarrier(commandBuffer,
         sourceStage, destinationStage,
         0,
         0, nullptr,
         0, nullptr, 1, &barrier);
-
-    commandBuffer.submit();
 }
 
 void Image::loadBufferData(CommandPool& commandPool, const Buffer& buffer) {
     auto commandBuffer = commandPool.createSingleUseBuffer();
     commandBuffer.start();
-    
+    loadBufferData(commandBuffer.handle, buffer);
+    commandBuffer.submit();
+}
+
+void Image::loadBufferData(VkCommandBuffer commandBuffer, const Buffer& buffer, VkDeviceSize bufferOffset) {
+    loadBufferRows(commandBuffer, buffer, bufferOffset, 0, height);
+}
+
+// Copies tightly packed rows of a mip level.  This allows large images to be uploaded in several pieces.
+// For block compressed formats the first row must be a multiple of the block height.
+void Image::loadBufferRows(VkCommandBuffer commandBuffer, const Buffer& buffer, VkDeviceSize bufferOffset, uint32_t firstRow, uint32_t rowCount, uint32_t mipLevel) {
     VkBufferImageCopy region = {};
-    region.bufferOffset = 0; // byte offset in buffer that pixel values start
+    region.bufferOffset = bufferOffset; // byte offset in buffer that pixel values start
     region.bufferRowLength = 0; //specifying 0 here means pixels are tightly packed
     region.bufferImageHeight = 0;
 
     region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-    region.imageSubresource.mipLevel = 0;
+    region.imageSubresource.mipLevel = mipLevel;
     region.imageSubresource.baseArrayLayer = 0;
     region.imageSubresource.layerCount = 1;
 
-    region.imageOffset = { 0,0,0 };
-    region.imageExtent = { width, height, 1 };
+    region.imageOffset = { 0, static_cast<int32_t>(firstRow), 0 };
+    region.imageExtent = { std::max(width >> mipLevel, 1U), rowCount, 1 };
 
-    vkCmdCopyBufferToImage(commandBuffer.handle, buffer.buffer, handle, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+    vkCmdCopyBufferToImage(commandBuffer, buffer.buffer, handle, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+}
 
+void Image::generateMipmaps(CommandPool& commandPool) {
+    auto commandBuffer = commandPool.createSingleUseBuffer();
+    commandBuffer.start();
+    generateMipmaps(commandBuffer.handle);
     commandBuffer.submit();
 }
 
-void Image::generateMipmaps(CommandPool& commandPool) {
+// note that blitting requires a queue with graphics capability
+void Image::generateMipmaps(VkCommandBuffer commandBuffer) {
     VkFormatProperties formatProperties;
     vkGetPhysicalDeviceFormatProperties(device.physical, format, &formatProperties);
 
@@ -147,9 +195,6 @@ void Image::generateMipmaps(CommandPool& commandPool) {
         throw std::runtime_error("texture image format does not support linear which is required to generate mipmaps");
     }
 
-    auto commandBuffer = commandPool.createSingleUseBuffer();
-    commandBuffer.start();
-
     VkImageMemoryBarrier barrier = {};
     barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
     barrier.image = handle;
@@ -170,7 +215,7 @@ void Image::generateMipmaps(CommandPool& commandPool) {
         barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
         barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
 
-        vkCmdPipelineBarrier(commandBuffer.handle,
+        vkCmdPipelineBarrier(commandBuffer,
             VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
             0, nullptr,
             0, nullptr,
@@ -192,7 +237,7 @@ void Image::generateMipmaps(CommandPool& commandPool) {
         blit.dstSubresource.baseArrayLayer = 0;
         blit.dstSubresource.layerCount = 1;
 
-        vkCmdBlitImage(commandBuffer.handle,
+        vkCmdBlitImage(commandBuffer,
             handle, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
             handle, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
             1, &blit,
@@ -205,7 +250,7 @@ void Image::generateMipmaps(CommandPool& commandPool) {
         barrier.srcAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
         barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
 
-        vkCmdPipelineBarrier(commandBuffer.handle,
+        vkCmdPipelineBarrier(commandBuffer,
             VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0,
             0, nullptr,
             0, nullptr,
@@ -224,13 +269,11 @@ void Image::generateMipmaps(CommandPool& commandPool) {
     barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
     barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
 
-    vkCmdPipelineBarrier(commandBuffer.handle,
+    vkCmdPipelineBarrier(commandBuffer,
         VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0,
         0, nullptr,
         0, nullptr,
         1, &barrier);
-
-    commandBuffer.submit();
 }
 
 VkImageView Image::createView(VkDevice device, VkImage image, VkFormat format, VkImageAspectFlags aspectFlags, uint32_t mipLevels) {
@@ -275,8 +318,18 @@ void Image::createView(VkImageAspectFlags aspectFlags) {
 
 void Image::cleanup() {
     vkDestroyImageView(device.logical, view, nullptr);
-    vkDestroyImage(device.logical, handle, nullptr);
-    vkFreeMemory(device.logical, memory, nullptr);
+
+    if (ownsAllocation) {
+        device.memory->untrack(allocation);
+        vmaDestroyImage(device.allocator, handle, allocation);
+    }
+    else {
+        vkDestroyImage(device.logical, handle, nullptr);
+    }
+
+    view = VK_NULL_HANDLE;
+    handle = VK_NULL_HANDLE;
+    allocation = VK_NULL_HANDLE;
 }
 
 }
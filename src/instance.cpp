@@ -36,7 +36,7 @@ namespace vkdev {
         return supportedValidationLayers;
     }
 
-    void Instance::create(bool enableValidationLayers) {
+    void Instance::create(bool enableValidationLayers, bool headless) {
         // ApplicationInfo is optional but can allow for the driver to perhaps perform optimizations
         VkApplicationInfo appInfo = {};
 
@@ -51,11 +51,15 @@ namespace vkdev {
         createInfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
         createInfo.pApplicationInfo = &appInfo;
 
+        std::vector<const char*> requiredExtensions;
+
         // Retrieve the needed Vulkan extensions for working with a GLFW window
-        uint32_t glfwExtensionCount = 0;
-        const char** glfwVulkanExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
+        if (!headless) {
+            uint32_t glfwExtensionCount = 0;
+            const char** glfwVulkanExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
 
-        std::vector<const char*> requiredExtensions(glfwVulkanExtensions, glfwVulkanExtensions + glfwExtensionCount);
+            requiredExtensions.assign(glfwVulkanExtensions, glfwVulkanExtensions + glfwExtensionCount);
+        }
 
         auto supportedValidationLayers = getSupportedValidationLayers();
         if (enableValidationLayers) {
@@ -0,0 +1,145 @@
+#include "vkdev/instancebatcher.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <functional>
+#include <numeric>
+#include <stdexcept>
+
+namespace vkdev {
+
+uint32_t InstanceBatcher::add(Mesh& mesh, Descriptor& descriptor, const glm::mat4& model, uint32_t materialIndex) {
+    if (!batches.empty()) {
+        throw std::runtime_error("instances can not be added after the batches are built");
+    }
+
+    instances.push_back({ &mesh, &descriptor, { model, materialIndex } });
+
+    return static_cast<uint32_t>(instances.size()) - 1;
+}
+
+void InstanceBatcher::build(uint32_t frameCount_) {
+    frameCount = frameCount_;
+
+    // instances sharing a mesh and descriptor become neighbours, keeping the order they were added in otherwise
+    std::vector<uint32_t> order(instances.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [this](uint32_t a, uint32_t b) {
+        if (instances[a].mesh != instances[b].mesh) {
+            return std::less<Mesh*>()(instances[a].mesh, instances[b].mesh);
+        }
+
+        return std::less<Descriptor*>()(instances[a].descriptor, instances[b].descriptor);
+    });
+
+    slots.resize(instances.size());
+    batches.clear();
+
+    for (uint32_t slot = 0; slot < order.size(); slot++) {
+        const Instance& instance = instances[order[slot]];
+        slots[order[slot]] = slot;
+
+        if (batches.empty() || batches.back().mesh != instance.mesh || batches.back().descriptor != instance.descriptor) {
+            batches.push_back({ instance.mesh, instance.descriptor, slot, 0, 0 });
+        }
+
+        batches.back().instanceCount += 1;
+    }
+
+    const VkDeviceSize instanceCount = std::max<VkDeviceSize>(instances.size(), 1);
+    const VkDeviceSize batchCount = std::max<VkDeviceSize>(batches.size(), 1);
+
+    instanceBuffer.createMapped(frameCount * instanceCount * sizeof(InstanceData), VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, VmaMemoryUsage::VMA_MEMORY_USAGE_CPU_TO_GPU);
+    drawCommands.createMapped(frameCount * batchCount * sizeof(VkDrawIndexedIndirectCommand), VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT, VmaMemoryUsage::VMA_MEMORY_USAGE_CPU_TO_GPU);
+
+    for (uint32_t frameIndex = 0; frameIndex < frameCount; frameIndex++) {
+        update(frameIndex);
+    }
+}
+
+void InstanceBatcher::cleanup() {
+    instanceBuffer.cleanup();
+    drawCommands.cleanup();
+
+    instances.clear();
+    slots.clear();
+    batches.clear();
+}
+
+void InstanceBatcher::setInstance(uint32_t handle, const glm::mat4& model, uint32_t materialIndex) {
+    instances[handle].data.model = model;
+    instances[handle].data.materialIndex = materialIndex;
+}
+
+void InstanceBatcher::setLod(uint32_t batch, uint32_t lod) {
+    batches[batch].lod = std::min(lod, static_cast<uint32_t>(batches[batch].mesh->lods.size()) - 1);
+}
+
+void InstanceBatcher::update(uint32_t frameIndex) {
+    const VkDeviceSize instanceOffset = frameIndex * instances.size() * sizeof(InstanceData);
+    InstanceData* instanceData = reinterpret_cast<InstanceData*>(static_cast<uint8_t*>(instanceBuffer.mapped) + instanceOffset);
+
+    for (size_t i = 0; i < instances.size(); i++) {
+        instanceData[slots[i]] = instances[i].data;
+    }
+
+    const VkDeviceSize drawOffset = frameIndex * batches.size() * sizeof(VkDrawIndexedIndirectCommand);
+    VkDrawIndexedIndirectCommand* commands = reinterpret_cast<VkDrawIndexedIndirectCommand*>(static_cast<uint8_t*>(drawCommands.mapped) + drawOffset);
+
+    // the instance stream is bound at the start of each batch, so every draw starts from instance 0
+    for (size_t i = 0; i < batches.size(); i++) {
+        const MeshLod& meshLod = batches[i].mesh->lods[batches[i].lod];
+
+        commands[i].indexCount = meshLod.indexCount;
+        commands[i].instanceCount = batches[i].instanceCount;
+        commands[i].firstIndex = meshLod.firstIndex;
+        commands[i].vertexOffset = meshLod.vertexOffset;
+        commands[i].firstInstance = 0;
+    }
+
+    vmaFlushAllocation(device.allocator, instanceBuffer.allocation, instanceOffset, instances.size() * sizeof(InstanceData));
+    vmaFlushAllocation(device.allocator, drawCommands.allocation, drawOffset, batches.size() * sizeof(VkDrawIndexedIndirectCommand));
+}
+
+void InstanceBatcher::record(VkCommandBuffer commandBuffer, uint32_t frameIndex, VkPipelineLayout pipelineLayout, uint32_t dynamicOffset) const {
+    const Mesh* boundMesh = nullptr;
+    const Descriptor* boundDescriptor = nullptr;
+
+    for (size_t i = 0; i < batches.size(); i++) {
+        const InstanceBatch& batch = batches[i];
+
+        // batches are sorted by mesh and then descriptor, so each is bound once
+        if (batch.mesh != boundMesh) {
+            const VkDeviceSize offset = 0;
+            vkCmdBindVertexBuffers(commandBuffer, 0, 1, &batch.mesh->vertexBuffer.buffer, &offset);
+            vkCmdBindIndexBuffer(commandBuffer, batch.mesh->indexBuffer.buffer, 0, batch.mesh->indexType());
+            boundMesh = batch.mesh;
+        }
+
+        if (batch.descriptor != boundDescriptor) {
+            vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 1, &batch.descriptor->descriptorSet, 1, &dynamicOffset);
+            boundDescriptor = batch.descriptor;
+        }
+
+        const VkDeviceSize instanceOffset = (frameIndex * instances.size() + batch.firstInstance) * sizeof(InstanceData);
+        vkCmdBindVertexBuffers(commandBuffer, 1, 1, &instanceBuffer.buffer, &instanceOffset);
+
+        const VkDeviceSize drawOffset = (frameIndex * batches.size() + i) * sizeof(VkDrawIndexedIndirectCommand);
+        vkCmdDrawIndexedIndirect(commandBuffer, drawCommands.buffer, drawOffset, 1, sizeof(VkDrawIndexedIndirectCommand));
+    }
+}
+
+uint32_t InstanceBatcher::addInstanceBinding(MeshDescription& meshDescription) {
+    // the model matrix takes one location per column
+    std::vector<InstanceAttribute> attributes;
+    for (uint32_t column = 0; column < 4; column++) {
+        attributes.push_back({ VK_FORMAT_R32G32B32A32_SFLOAT, static_cast<uint32_t>(offsetof(InstanceData, model) + column * sizeof(glm::vec4)) });
+    }
+
+    attributes.push_back({ VK_FORMAT_R32_UINT, static_cast<uint32_t>(offsetof(InstanceData, materialIndex)) });
+
+    return meshDescription.addInstanceBinding(sizeof(InstanceData), attributes);
+}
+
+}
@@ -0,0 +1,362 @@
+#include "vkdev/jobsystem.h"
+
+#include <stdexcept>
+#include <thread>
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#elif defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace vkdev {
+
+static_assert((JobSystem::JOB_CAPACITY & (JobSystem::JOB_CAPACITY - 1)) == 0, "job capacity must be a power of two");
+
+struct Job {
+    JobSystem::JobFunction function;
+    JobCounter* counter = nullptr;
+
+    // set while the job is queued or running, its slot in the ring can not be reused until it is cleared
+    std::atomic<bool> active = { false };
+};
+
+/*
+Chase-Lev work stealing deque, based on "Correct and Efficient Work-Stealing for Weak Memory Models" (Le et al. 2013).
+The standalone fences of the paper are folded into sequentially consistent operations on top and bottom, which costs the
+same on x86 and can be checked by thread sanitizer.
+The owning thread pushes and pops at the bottom, any thread may steal from the top.  The capacity is fixed, a push onto a
+full deque fails.
+*/
+class JobDeque {
+public:
+    bool push(Job* job) {
+        const int64_t b = bottom.load(std::memory_order_relaxed);
+        const int64_t t = top.load(std::memory_order_acquire);
+
+        if (b - t >= static_cast<int64_t>(JobSystem::JOB_CAPACITY)) {
+            return false;
+        }
+
+        // publishes the job to thieves, which read bottom with acquire
+        buffer[b & MASK].store(job, std::memory_order_relaxed);
+        bottom.store(b + 1, std::memory_order_release);
+
+        return true;
+    }
+
+    Job* pop() {
+        // bottom must be lowered before top is read, so that a thief can not take the same job
+        const int64_t b = bottom.load(std::memory_order_relaxed) - 1;
+        bottom.store(b, std::memory_order_seq_cst);
+        int64_t t = top.load(std::memory_order_seq_cst);
+
+        if (t > b) {
+            bottom.store(b + 1, std::memory_order_relaxed);
+            return nullptr;
+        }
+
+        Job* job = buffer[b & MASK].load(std::memory_order_relaxed);
+
+        // the last job may be taken by a thief at the same time, whoever advances top first gets it
+        if (t == b) {
+            if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+                job = nullptr;
+            }
+
+            bottom.store(b + 1, std::memory_order_relaxed);
+        }
+
+        return job;
+    }
+
+    Job* steal() {
+        int64_t t = top.load(std::memory_order_seq_cst);
+        const int64_t b = bottom.load(std::memory_order_seq_cst);
+
+        if (t >= b) {
+            return nullptr;
+        }
+
+        Job* job = buffer[t & MASK].load(std::memory_order_relaxed);
+
+        if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+            return nullptr;
+        }
+
+        return job;
+    }
+
+private:
+    static const int64_t MASK = JobSystem::JOB_CAPACITY - 1;
+
+    // top is written by thieves and bottom by the owner, keeping them on separate cache lines avoids false sharing
+    alignas(64) std::atomic<int64_t> top = { 0 };
+    alignas(64) std::atomic<int64_t> bottom = { 0 };
+    std::atomic<Job*> buffer[JobSystem::JOB_CAPACITY] = {};
+};
+
+struct JobSystem::Thread {
+    uint32_t index = 0;
+    JobDeque deque;
+
+    std::unique_ptr<Job[]> jobs = std::unique_ptr<Job[]>(new Job[JOB_CAPACITY]);
+    uint32_t nextJob = 0;
+
+    // xorshift state used to pick which thread to steal from
+    uint32_t random = 1;
+
+    std::thread handle;
+};
+
+static thread_local const JobSystem* currentSystem = nullptr;
+static thread_local uint32_t currentThreadIndex = JobSystem::INVALID_THREAD_INDEX;
+
+static void pinCurrentThread(uint32_t cpu) {
+#if defined(_WIN32)
+    SetThreadAffinityMask(GetCurrentThread(), static_cast<DWORD_PTR>(1) << (cpu % (sizeof(DWORD_PTR) * 8)));
+#elif defined(__linux__)
+    cpu_set_t cpuSet;
+    CPU_ZERO(&cpuSet);
+    CPU_SET(cpu, &cpuSet);
+    pthread_setaffinity_np(pthread_self(), sizeof(cpuSet), &cpuSet);
+#else
+    // macOS only offers affinity hints between threads rather than binding to a CPU
+    (void)cpu;
+#endif
+}
+
+JobSystem::JobSystem() = default;
+JobSystem::~JobSystem() = default;
+
+void JobSystem::create(uint32_t threadCount, bool pinThreads) {
+    const uint32_t hardwareThreads = std::max(1U, std::thread::hardware_concurrency());
+
+    if (threadCount == 0) {
+        threadCount = hardwareThreads;
+    }
+
+    stopping = false;
+
+    for (uint32_t i = 0; i < threadCount; i++) {
+        threads.push_back(std::make_unique<Thread>());
+        threads.back()->index = i;
+        threads.back()->random = 2654435761U * (i + 1);
+    }
+
+    currentSystem = this;
+    currentThreadIndex = 0;
+
+    for (uint32_t i = 1; i < threadCount; i++) {
+        threads[i]->handle = std::thread(&JobSystem::workerLoop, this, i, pinThreads);
+    }
+}
+
+void JobSystem::cleanup() {
+    {
+        std::lock_guard<std::mutex> lock(sleepMutex);
+        stopping = true;
+    }
+
+    wakeCondition.notify_all();
+
+    for (auto& thread : threads) {
+        if (thread->handle.joinable()) {
+            thread->handle.join();
+        }
+    }
+
+    threads.clear();
+    dependentJobs.clear();
+
+    if (currentSystem == this) {
+        currentSystem = nullptr;
+        currentThreadIndex = INVALID_THREAD_INDEX;
+    }
+}
+
+uint32_t JobSystem::getThreadIndex() const {
+    return currentSystem == this ? currentThreadIndex : INVALID_THREAD_INDEX;
+}
+
+void JobSystem::run(JobFunction function, JobCounter* counter, JobCounter* dependency) {
+    const uint32_t threadIndex = getThreadIndex();
+
+    if (threadIndex == INVALID_THREAD_INDEX) {
+        throw std::runtime_error("jobs can only be run from the thread which created the job system or from a job");
+    }
+
+    Thread& thread = *threads[threadIndex];
+    Job* job = allocateJob(thread);
+    job->function = std::move(function);
+    job->counter = counter;
+
+    if (counter) {
+        counter->pending.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    if (dependency) {
+        std::lock_guard<std::mutex> lock(dependentMutex);
+
+        // The held count is raised before the dependency is checked, and the thread finishing the dependency checks the
+        // count after lowering it.  Either this thread sees the dependency is done or that thread sees the held job.
+        dependentCount.fetch_add(1, std::memory_order_seq_cst);
+
+        if (dependency->pending.load(std::memory_order_seq_cst) != 0) {
+            dependentJobs.push_back({ job, dependency });
+            return;
+        }
+
+        dependentCount.fetch_sub(1, std::memory_order_relaxed);
+    }
+
+    queueJob(thread, job);
+}
+
+void JobSystem::wait(const JobCounter& counter) {
+    const uint32_t threadIndex = getThreadIndex();
+
+    while (!counter.isDone()) {
+        Job* job = threadIndex != INVALID_THREAD_INDEX ? findJob(*threads[threadIndex]) : nullptr;
+
+        if (job) {
+            execute(*threads[threadIndex], job);
+        }
+        else {
+            std::this_thread::yield();
+        }
+    }
+}
+
+Job* JobSystem::allocateJob(Thread& thread) {
+    Job* job = &thread.jobs[thread.nextJob++ & (JOB_CAPACITY - 1)];
+
+    // the ring has wrapped around onto a job which has not finished, help run jobs until it has
+    while (job->active.load(std::memory_order_acquire)) {
+        if (Job* other = findJob(thread)) {
+            execute(thread, other);
+        }
+        else {
+            std::this_thread::yield();
+        }
+    }
+
+    job->active.store(true, std::memory_order_relaxed);
+
+    return job;
+}
+
+void JobSystem::queueJob(Thread& thread, Job* job) {
+    // counted before the push so that a thief taking the job never lowers the count below zero
+    queuedCount.fetch_add(1, std::memory_order_seq_cst);
+
+    if (!thread.deque.push(job)) {
+        queuedCount.fetch_sub(1, std::memory_order_relaxed);
+        execute(thread, job);
+        return;
+    }
+
+    // a sleeping worker raises the sleeping count before checking the queued count, so one of the two threads sees the other
+    if (sleepingCount.load(std::memory_order_seq_cst) > 0) {
+        std::lock_guard<std::mutex> lock(sleepMutex);
+        wakeCondition.notify_one();
+    }
+}
+
+Job* JobSystem::findJob(Thread& thread) {
+    Job* job = thread.deque.pop();
+
+    if (!job && threads.size() > 1) {
+        thread.random ^= thread.random << 13;
+        thread.random ^= thread.random >> 17;
+        thread.random ^= thread.random << 5;
+
+        const size_t threadCount = threads.size();
+        const size_t start = thread.random % threadCount;
+
+        for (size_t i = 0; i < threadCount && !job; i++) {
+            const size_t victim = (start + i) % threadCount;
+
+            if (victim != thread.index) {
+                job = threads[victim]->deque.steal();
+            }
+        }
+    }
+
+    if (job) {
+        queuedCount.fetch_sub(1, std::memory_order_relaxed);
+    }
+
+    return job;
+}
+
+void JobSystem::execute(Thread& thread, Job* job) {
+    job->function();
+    job->function = nullptr;
+
+    // the job's slot may be reused as soon as it is inactive, so the counter is read first
+    JobCounter* counter = job->counter;
+    job->active.store(false, std::memory_order_release);
+
+    // nothing may touch the counter after it is lowered, a waiting thread could destroy it immediately
+    if (counter && counter->pending.fetch_sub(1, std::memory_order_seq_cst) == 1 && dependentCount.load(std::memory_order_seq_cst) > 0) {
+        releaseDependents(thread);
+    }
+}
+
+void JobSystem::releaseDependents(Thread& thread) {
+    std::vector<Job*> readyJobs;
+
+    {
+        std::lock_guard<std::mutex> lock(dependentMutex);
+
+        for (size_t i = 0; i < dependentJobs.size();) {
+            if (dependentJobs[i].dependency->isDone()) {
+                readyJobs.push_back(dependentJobs[i].job);
+                dependentJobs[i] = dependentJobs.back();
+                dependentJobs.pop_back();
+            }
+            else {
+                i++;
+            }
+        }
+
+        dependentCount.fetch_sub(static_cast<uint32_t>(readyJobs.size()), std::memory_order_relaxed);
+    }
+
+    for (Job* job : readyJobs) {
+        queueJob(thread, job);
+    }
+}
+
+void JobSystem::workerLoop(uint32_t index, bool pinThread) {
+    currentSystem = this;
+    currentThreadIndex = index;
+
+    if (pinThread) {
+        pinCurrentThread(index % std::max(1U, std::thread::hardware_concurrency()));
+    }
+
+    Thread& thread = *threads[index];
+
+    while (!stopping.load(std::memory_order_acquire)) {
+        if (Job* job = findJob(thread)) {
+            execute(thread, job);
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(sleepMutex);
+        sleepingCount.fetch_add(1, std::memory_order_seq_cst);
+
+        wakeCondition.wait(lock, [this]() {
+            return queuedCount.load(std::memory_order_seq_cst) > 0 || stopping.load(std::memory_order_relaxed);
+        });
+
+        sleepingCount.fetch_sub(1, std::memory_order_relaxed);
+    }
+}
+
+}
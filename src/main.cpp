@@ -1,22 +1,23 @@
-#include "vkdev/assets.h"
+#include "vkdev/assetloader.h"
 #include "vkdev/commandpool.h"
-#include "vkdev/descriptor.h"
+#include "vkdev/demoscene.h"
 #include "vkdev/device.h"
+#include "vkdev/framepacer.h"
 #include "vkdev/instance.h"
-#include "vkdev/pipeline.h"
+#include "vkdev/jobsystem.h"
+#include "vkdev/querypool.h"
 #include "vkdev/rendercommand.h"
 #include "vkdev/rendertarget.h"
 #include "vkdev/swapchain.h"
+#include "vkdev/uploadmanager.h"
 #include "vkdev/window.h"
 
-#define GLM_FORCE_RADIANS
-// The perspective projection matrix generated by GLM will use the OpenGL depth range of -1.0 to 1.0 by default. We need to configure it to use the Vulkan range of 0.0 to 1.0 
-#define GLM_FORCE_DEPTH_ZERO_TO_ONE
-#define GLM_ENABLE_EXPERIMENTAL
 #include <glm/glm.hpp>
-#include <glm/gtc/matrix_transform.hpp>
+
+#include <nlohmann/json.hpp>
 
 #include <chrono>
+#include <cmath>
 
 #include <iostream>
 #include <stdexcept>
@@ -38,132 +39,143 @@
 constexpr int WIDTH = 800;
 constexpr int HEIGHT = 600;
 
-const std::string MODEL_PATH = "models/chalet.model";
-const std::string TEXTURE_PATH = "textures/chalet.jpg";
-
-
 const std::vector<std::string> requiredDeviceExtensions = {
     VK_KHR_SWAPCHAIN_EXTENSION_NAME
 };
 
-// alignas is used to be explicit in regards to vulkan alignment requirements.  mat4 should be aligned to multiples of 16 bytes
-struct UniformBufferObject {
-    alignas(16) glm::mat4 model;
-    alignas(16) glm::mat4 view;
-    alignas(16) glm::mat4 proj;
-};
+// nothing is presented when running headless so the swap chain extension is not needed
+const std::vector<std::string> requiredHeadlessDeviceExtensions = {};
 
 class VulkanTestApplication {
 private:
 
+    // The texture, mesh and shader are read and decoded in parallel on the job system and uploaded together.
+    // Only a streamed texture's lowest mip levels are loaded up front, the rest are streamed in as the mesh covers more of the screen.
     void loadAssets() {
-        vkdev::Image texture = vkdev::Texture::createFromFile(TEXTURE_PATH.c_str(), *device, *commandPool);
-        assets.textures["texture"] = std::make_unique<vkdev::Image>(texture);
-
-        vkdev::MeshData meshData;
-        meshData.loadFromFile(MODEL_PATH);
-
-        auto mesh = std::make_unique<vkdev::Mesh>(*device);
-        mesh->create(meshData, *commandPool);
-        
-        auto meshDescription = assets.meshDescriptions.find(mesh->vertexAttributes);
-        if (meshDescription == assets.meshDescriptions.end()) {
-            assets.meshDescriptions[mesh->vertexAttributes] = std::make_unique<vkdev::MeshDescription>(mesh->getMeshDescription());
-        }
-
-        assets.meshes["mesh"] = std::move(mesh);
-
-        vkdev::ShaderData shaderData;
-        shaderData.loadFiles("shaders/shader.vert.spv", "shaders/shader.frag.spv", "shaders/shader.json");
-
-        auto shader = std::make_unique<vkdev::Shader>(*device);
-        shader->create(shaderData);
-        assets.shaders["shader"] = std::move(shader);
-    }
-
-    // Create one descriptor pool which will have a descriptor set for each image in the swap chain
-    // note that we need to specify a pool size for each type of descriptor that we have in our shader.
-    void createDescriptor() {
-        vkdev::Material material;
-        material.shader = "shader";
-        material.textures["texSampler"] = assets.textures["texture"].get();
-
-        descriptor = std::make_unique<vkdev::Descriptor>(*device);
-        descriptor->create(material, assets, static_cast<uint32_t>(swapchain->images.size()), _mipLevels);
-    }
-
-    void createGraphicsPipeline() {
-        auto& shader = assets.shaders["shader"];
-        auto& mesh = assets.meshes["mesh"];
-        auto& meshDescription = assets.meshDescriptions[mesh->vertexAttributes];
-
-        pipeline = std::make_unique<vkdev::Pipeline>(*device);
-        pipeline = vkdev::createDefaultPipeline(*device, *shader, *meshDescription, *renderTarget);
+        scene = std::make_unique<vkdev::DemoScene>(*device, *uploadManager, *jobSystem);
+        scene->modelPath = _modelPath;
+        scene->texturePath = _texturePath;
+        scene->framesInFlight = _framesInFlight;
+        scene->gpuInstanceCount = _gpuInstanceCount;
+        scene->instanceCount = _instanceCount;
+        scene->textureBudget = _textureBudget;
+        scene->streamUploadLimit = _streamUploadLimit;
+
+        vkdev::AssetLoader assetLoader(*device, *uploadManager, *jobSystem, scene->assets);
+        scene->loadAssets(assetLoader);
+
+        // every asset must be ready before it is used for rendering
+        assetLoader.waitAll();
+
+        scene->createInstances();
     }
 
-    // drawing commands involves binding a framebuffer, we will have to record a command buffer for every image in the swap chain.
-    // TODO: look into use of secondary command buffer
+    // Each frame in flight records into its own transient command pool.  The framebuffer is selected when the frame is recorded.
+    // Large draw lists are recorded into secondary command buffers on the job system's threads.
     void createCommandBuffers() {
-        auto& mesh = assets.meshes["mesh"];
-        renderCommand->create(*renderTarget, *pipeline, *mesh, *descriptor);
+        renderCommand->jobSystem = jobSystem.get();
+        renderCommand->threadCount = _recordThreadCount;
+        renderCommand->create(*renderTarget, _framesInFlight, timestamps.get());
     }
 
-    void updateUniformBuffer(uint32_t bufferIndex) {
+    // Builds the frame's draw list and records it into the frame's command buffer
+    VkCommandBuffer recordFrame(uint32_t frameSlot, uint32_t imageIndex) {
         // get the application time
         static auto startTime = std::chrono::high_resolution_clock::now();
         auto currentTime = std::chrono::high_resolution_clock::now();
         float time = std::chrono::duration<float, std::chrono::seconds::period>(currentTime - startTime).count();
 
-        // define MVP
-        UniformBufferObject ubo = {};
-        ubo.model = glm::rotate(glm::mat4(1.0f), time * glm::radians(90.0f), glm::vec3(0.0f, 0.0f, 1.0f));
-        ubo.view = glm::lookAt(glm::vec3(2.0f, 2.0f, 2.0f), glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f));
-        ubo.proj = glm::perspective(glm::radians(45.0f), swapchain->extent.width / (float)swapchain->extent.height, 0.1f, 10.0f);
-
-        // GLM was originally designed for OpenGL, where the Y coordinate of the clip coordinates is inverted.
-        // The easiest way to compensate for that is to flip the sign on the scaling factor of the Y axis in the projection matrix.
-        // If you don't do this, then the image will be rendered upside down.
-        ubo.proj[1][1] *= -1;
-
-        // copy the MVP into the corresponding uniform buffer
-        // TODO: look into using push constants for a more efficient means of passing the uniform data to shaders
-        auto& uniformBufferVector = descriptor->uniformBuffers["UniformBufferObject"];
-        void* data = nullptr;
-
-        vmaMapMemory(device->allocator, uniformBufferVector[bufferIndex].allocation, &data);
-        memcpy(data, &ubo, sizeof(ubo));
-        vmaUnmapMemory(device->allocator, uniformBufferVector[bufferIndex].allocation);
+        scene->update(frameSlot, time * glm::radians(90.0f), renderTarget->extent);
+
+        return renderCommand->record(frameSlot, imageIndex, scene->getRenderQueue(frameSlot));
     }
 
     void init() {
-        window = std::make_unique<vkdev::Window>(instance);
-        window->createWindow(WIDTH, HEIGHT);
+        // the thread which creates the job system is one of its threads, so this must happen on the main thread
+        jobSystem = std::make_unique<vkdev::JobSystem>();
+        jobSystem->create(_threadCount, _pinThreads);
+
+        if (_headless) {
+            instance.create(_enableValidation, true);
+
+            device = std::make_unique<vkdev::Device>(instance);
+            device->create(requiredHeadlessDeviceExtensions);
+        }
+        else {
+            window = std::make_unique<vkdev::Window>(instance);
+            window->createWindow(WIDTH, HEIGHT);
 
-        instance.create(_enableValidation);
-        
-        window->createSurface();
-        device = std::make_unique<vkdev::Device>(instance, window->surface);
-        device->create(requiredDeviceExtensions);
+            instance.create(_enableValidation);
+
+            window->createSurface();
+            device = std::make_unique<vkdev::Device>(instance, window->surface);
+            device->create(requiredDeviceExtensions);
+        }
 
         commandPool = std::make_unique<vkdev::CommandPool>(*device, device->graphicsQueue);
         commandPool->create();
 
-        swapchain = std::make_unique<vkdev::SwapChain>(*device, window->surface);
-        swapchain->create(window->getFramebufferSize());
+        // one timestamp slot per frame in flight.  Uploads performed through the command pool and upload manager are timed as well
+        timestamps = std::make_unique<vkdev::TimestampQueryPool>(*device);
+        timestamps->create(*commandPool, _framesInFlight, 4);
+        commandPool->timestamps = timestamps.get();
+
+        uploadManager = std::make_unique<vkdev::UploadManager>(*device);
+        uploadManager->create();
+        uploadManager->timestamps = timestamps.get();
 
-        renderTarget = std::make_unique<vkdev::SwapChainRenderTarget>(*device);
-        renderTarget->msaaSampleCount = std::min(VK_SAMPLE_COUNT_4_BIT, device->getMaxSupportedSampleCount());
-        renderTarget->create(*swapchain, *commandPool);
+        createRenderTarget();
 
         loadAssets();
 
-        createGraphicsPipeline();
-        createDescriptor();
+        scene->createPipeline(*renderTarget);
+        scene->createDescriptor();
+        scene->createInstanceBatcher();
+        scene->createRenderQueues();
 
-        renderCommand = std::make_unique<vkdev::RenderCommand>(*device, *commandPool);
+        renderCommand = std::make_unique<vkdev::RenderCommand>(*device, device->graphicsQueue);
         createCommandBuffers();
 
-        swapchain->createSyncObjects();
+        if (_headless) {
+            offscreenTarget->createSyncObjects();
+        }
+        else {
+            swapchain->createSyncObjects();
+        }
+
+        memoryReport["after_init"] = device->memory->toJson();
+    }
+
+    void writeMemoryReport() {
+        std::ofstream file(_memoryReportPath);
+
+        if (!file) {
+            throw std::runtime_error("unable to write memory report: " + _memoryReportPath);
+        }
+
+        file << memoryReport.dump(4) << std::endl;
+    }
+
+    void createRenderTarget() {
+        const VkSampleCountFlagBits msaaSampleCount = std::min(VK_SAMPLE_COUNT_4_BIT, device->getMaxSupportedSampleCount());
+
+        if (_headless) {
+            offscreenTarget = std::make_unique<vkdev::OffscreenRenderTarget>(*device);
+            offscreenTarget->msaaSampleCount = msaaSampleCount;
+            offscreenTarget->create({ WIDTH, HEIGHT }, VK_FORMAT_B8G8R8A8_UNORM, _framesInFlight);
+            renderTarget = offscreenTarget.get();
+        }
+        else {
+            swapchain = std::make_unique<vkdev::SwapChain>(*device, window->surface);
+            swapchain->preferredPresentMode = framePacer.getPresentMode();
+            swapchain->framesInFlight = _framesInFlight;
+            swapchain->create(window->getFramebufferSize());
+
+            swapchainTarget = std::make_unique<vkdev::SwapChainRenderTarget>(*device);
+            swapchainTarget->msaaSampleCount = msaaSampleCount;
+            swapchainTarget->create(*swapchain);
+            renderTarget = swapchainTarget.get();
+        }
     }
 
     void recreateSwapChain() {
@@ -172,107 +184,249 @@ private:
         vkDeviceWaitIdle(device->logical);
 
         cleanupSwapChain();
+        swapchain->preferredPresentMode = framePacer.getPresentMode();
         swapchain->create(window->getFramebufferSize());
-        renderTarget->create(*swapchain, *commandPool);
+        swapchainTarget->create(*swapchain);
 
-        createGraphicsPipeline();
-
-        createDescriptor();
+        scene->createPipeline(*renderTarget);
         createCommandBuffers();
     }
 
+    // The loop is paced by the frame pacer rather than a fixed sleep.  In VSync mode the present mode throttles the loop,
+    // in TargetFps mode the pacer sleeps after the frame's fence wait and in Uncapped mode frames are started as soon as possible.
     void mainLoop() {
-        auto last_update_time = std::chrono::high_resolution_clock::now();
         while (!window->shouldClose()) {
-            auto current_update_time = std::chrono::high_resolution_clock::now();
-            auto milliseconds = std::chrono::duration_cast<std::chrono::milliseconds>(current_update_time - last_update_time).count();
+            window->poll();
+
+            // the pacing mode may have changed the desired present mode, which requires the swap chain to be rebuilt
+            if (window->wasResized() || swapchain->preferredPresentMode != framePacer.getPresentMode()) {
+                window->markResizeHandled();
+                recreateSwapChain();
+                continue;
+            }
+
+            const uint32_t frameSlot = static_cast<uint32_t>(swapchain->currentFrameIndex);
+            swapchain->waitForFrame();
+            framePacer.beginFrame();
+
+            uint32_t frameIndex = 0;
+            VkResult result = swapchain->aquireFrame(frameIndex);
+
+            if (result == VK_ERROR_OUT_OF_DATE_KHR) {
+                recreateSwapChain();
+            }
+            else {
+                // the fence for this frame slot has been waited on, so its timestamps can be read without stalling
+                timestamps->collect(frameSlot);
 
-            if (milliseconds >= 16) {
-                window->poll();
+                result = swapchain->drawFrame(frameIndex, recordFrame(frameSlot, frameIndex));
+                framePacer.endFrame();
 
-                if (window->wasResized()) {
-                    window->markResizeHandled();
+                if (result != VK_SUCCESS) {
                     recreateSwapChain();
                 }
-                else {
-                    uint32_t frameIndex = 0;
-                    VkResult result = swapchain->aquireFrame(frameIndex);
-
-                    if (result == VK_ERROR_OUT_OF_DATE_KHR) {
-                        recreateSwapChain();
-                    }
-                    else {
-                        updateUniformBuffer(frameIndex);
-                        result = swapchain->drawFrame(frameIndex, renderCommand->commandBuffers[frameIndex]);
-
-                        if (result != VK_SUCCESS) {
-                            recreateSwapChain();
-                        }
-                    }
-                    last_update_time = current_update_time;
-                }
             }
-            else {
-                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+
+        vkDeviceWaitIdle(device->logical);
+
+        std::cout << "frame start to present latency: average " << framePacer.getAverageLatencyMilliseconds() << "ms, max " << framePacer.getMaxLatencyMilliseconds() << "ms" << std::endl;
+        printRecordStats();
+    }
+
+    // the counts are taken from the last frame recorded
+    void printRecordStats() {
+        const vkdev::RenderQueueStats& stats = renderCommand->getStats();
+
+        std::cout << "per frame: " << stats.packetCount << " packets, " << stats.drawCount << " draws, " << stats.pipelineBinds << " pipeline binds, "
+                  << stats.descriptorBinds << " descriptor binds, " << stats.meshBinds << " mesh binds" << std::endl;
+        std::cout << "command recording: average " << renderCommand->getAverageRecordMilliseconds() << "ms, max " << renderCommand->getMaxRecordMilliseconds() << "ms, split into "
+                  << renderCommand->getLastRangeCount() << " range(s) on " << jobSystem->getThreadCount() << " thread(s)" << std::endl;
+
+        if (vkdev::TextureStreamer* textureStreamer = scene->getTextureStreamer()) {
+            std::cout << "texture streaming: level " << textureStreamer->getResidentLevel(scene->getStreamedTexture()) << " resident, " << textureStreamer->getResidentSize() / 1024 << "KB of "
+                      << textureStreamer->memoryBudget / 1024 << "KB budget, " << textureStreamer->getTotalUploadBytes() / 1024 << "KB uploaded, max "
+                      << textureStreamer->getMaxFrameUploadBytes() / 1024 << "KB per frame, " << textureStreamer->getEvictionCount() << " eviction(s)" << std::endl;
+        }
+    }
+
+    // Headless rendering has nothing to present and no window events to wait on, so frames are submitted as fast as the fences allow.
+    void headlessLoop() {
+        auto startTime = std::chrono::high_resolution_clock::now();
+        double gpuFrameMilliseconds = 0.0;
+        uint32_t gpuFrameSamples = 0;
+
+        for (uint32_t i = 0; i < _headlessFrameCount; i++) {
+            uint32_t frameIndex = 0;
+            offscreenTarget->aquireFrame(frameIndex);
+            framePacer.beginFrame();
+
+            // offscreen targets use the same index for the frame slot and the image
+            if (timestamps->collect(frameIndex)) {
+                gpuFrameMilliseconds += timestamps->getMilliseconds("frame");
+                gpuFrameSamples += 1;
             }
+
+            offscreenTarget->drawFrame(frameIndex, recordFrame(frameIndex, frameIndex));
+            framePacer.endFrame();
         }
 
         vkDeviceWaitIdle(device->logical);
+
+        auto endTime = std::chrono::high_resolution_clock::now();
+        float seconds = std::chrono::duration<float, std::chrono::seconds::period>(endTime - startTime).count();
+        std::cout << "rendered " << _headlessFrameCount << " frames in " << seconds << "s (" << _headlessFrameCount / seconds << " fps)" << std::endl;
+
+        if (gpuFrameSamples > 0) {
+            std::cout << "average gpu frame time: " << gpuFrameMilliseconds / gpuFrameSamples << "ms, uploads: " << timestamps->getTotalUploadMilliseconds() << "ms" << std::endl;
+        }
+
+        printRecordStats();
     }
 
     void cleanupSwapChain() {
         renderCommand->cleanup();
-        pipeline->cleanup();
+        scene->cleanupPipeline();
         renderTarget->cleanup();
-        swapchain->cleanupImages();
-        descriptor->cleanup();
+
+        if (swapchain) {
+            swapchain->cleanupImages();
+        }
     }
 
     void cleanup() {
         cleanupSwapChain();
+        renderTarget->cleanupAttachmentMemory();
+
+        if (_headless) {
+            offscreenTarget->cleanupSyncObjects();
+        }
+        else {
+            swapchain->cleanupSyncObjects();
+        }
 
-        swapchain->cleanupSyncObjects();
+        scene->cleanup();
 
+        uploadManager->cleanup();
+        commandPool->timestamps = nullptr;
+        timestamps->cleanup();
         commandPool->cleanup();
 
-        assets.cleanup();
+        // everything has been released at this point, so any memory still reported here has leaked
+        if (!_memoryReportPath.empty()) {
+            memoryReport["at_shutdown"] = device->memory->toJson();
+            writeMemoryReport();
+        }
 
         device->cleanup();
-        window->cleanupSurface();
+
+        if (window) {
+            window->cleanupSurface();
+        }
+
         instance.cleanup();
 
-        window->cleanupWindow();
+        if (window) {
+            window->cleanupWindow();
+        }
+
+        jobSystem->cleanup();
     }
 
 public:
     void run() {
         init();
-        mainLoop();
+
+        if (_headless) {
+            headlessLoop();
+        }
+        else {
+            mainLoop();
+        }
+
         cleanup();
     }
 
     inline void enableValidationLayers(bool enableValidation) { _enableValidation = enableValidation; }
 
+    // render the given number of frames to an offscreen target without creating a window
+    inline void enableHeadless(uint32_t frameCount) { _headless = true; _headlessFrameCount = frameCount; }
+
+    inline vkdev::FramePacer& getFramePacer() { return framePacer; }
+    inline void setFramesInFlight(uint32_t framesInFlight) { _framesInFlight = std::max(1U, framesInFlight); }
+
+    // a report of GPU memory use by category is written to this path after initialization and again at shutdown
+    inline void setMemoryReportPath(const std::string& path) { _memoryReportPath = path; }
+
+    // either a .model file or a .vkpack mesh pack
+    inline void setModelPath(const std::string& path) { _modelPath = path; }
+
+    // any image stb_image can read, or a .ktx2 texture with precomputed mip levels
+    inline void setTexturePath(const std::string& path) { _texturePath = path; }
+
+    // draws the mesh this many times on a grid, culled and drawn by the GPU
+    inline void setGpuInstanceCount(uint32_t instanceCount) { _gpuInstanceCount = instanceCount; _instanceCount = 0; }
+
+    // draws the mesh this many times on a grid with hardware instancing.  Only one of the instanced modes is used, the last one set.
+    inline void setInstanceCount(uint32_t instanceCount) { _instanceCount = instanceCount; _gpuInstanceCount = 0; }
+
+    // Streams the texture's mip levels in as they are needed, keeping them within this many megabytes.  0 loads the whole texture.
+    inline void setTextureBudget(uint32_t megabytes) { _textureBudget = megabytes; }
+
+    // maximum number of kilobytes of texture data staged for streaming each frame
+    inline void setStreamUploadLimit(uint32_t kilobytes) { _streamUploadLimit = std::max(1U, kilobytes); }
+
+    // number of threads running jobs, including the main thread.  0 uses the hardware concurrency.
+    inline void setThreadCount(uint32_t threadCount) { _threadCount = threadCount; }
+
+    // binds each job system thread to a single CPU
+    inline void setPinThreads(bool pinThreads) { _pinThreads = pinThreads; }
+
+    // maximum number of ranges a frame's draw list is split into for recording, 0 makes one for each job system thread
+    inline void setRecordThreadCount(uint32_t threadCount) { _recordThreadCount = threadCount; }
+
 private:
     std::unique_ptr<vkdev::Window> window;
     vkdev::Instance instance;
     std::unique_ptr<vkdev::Device> device;
 
     std::unique_ptr<vkdev::SwapChain> swapchain;
-    std::unique_ptr<vkdev::SwapChainRenderTarget> renderTarget;
-
-    std::unique_ptr<vkdev::Pipeline> pipeline;
+    std::unique_ptr<vkdev::SwapChainRenderTarget> swapchainTarget;
+    std::unique_ptr<vkdev::OffscreenRenderTarget> offscreenTarget;
+    vkdev::RenderTarget* renderTarget = nullptr;
 
     std::unique_ptr<vkdev::CommandPool> commandPool;
     std::unique_ptr<vkdev::RenderCommand> renderCommand;
+    std::unique_ptr<vkdev::TimestampQueryPool> timestamps;
+    std::unique_ptr<vkdev::UploadManager> uploadManager;
+
+    std::unique_ptr<vkdev::DemoScene> scene;
 
-    vkdev::Assets assets;
+    uint32_t _textureBudget = 0;
+    uint32_t _streamUploadLimit = 4096;
 
-    std::unique_ptr<vkdev::Descriptor> descriptor;
+    vkdev::FramePacer framePacer;
 
-    uint32_t _mipLevels = 1;
+    uint32_t _framesInFlight = vkdev::SwapChain::DEFAULT_FRAMES_IN_FLIGHT;
 
     bool _enableValidation = false;
+
+    bool _headless = false;
+    uint32_t _headlessFrameCount = 0;
+
+    std::string _memoryReportPath;
+    std::string _modelPath = "models/chalet.model";
+    std::string _texturePath = "textures/chalet.jpg";
+
+    uint32_t _gpuInstanceCount = 0;
+    uint32_t _instanceCount = 0;
+
+    std::unique_ptr<vkdev::JobSystem> jobSystem;
+    uint32_t _threadCount = 0;
+    bool _pinThreads = false;
+    uint32_t _recordThreadCount = 0;
+
+    nlohmann::json memoryReport;
 };
 
 int main(int argc, char** argv) {
@@ -284,6 +438,79 @@ int main(int argc, char** argv) {
     app.enableValidationLayers(true);
 #endif
 
+    // usage: vulkantest [--headless [frame count]] [--uncapped | --fps N | --present-mode fifo|mailbox|immediate] [--frames-in-flight N] [--memory-report path] [--model path] [--texture path] [--texture-budget MB] [--stream-upload-limit KB] [--gpu-instances N] [--instances N] [--threads N] [--pin-threads] [--record-threads N]
+    vkdev::FramePacer& framePacer = app.getFramePacer();
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--headless") == 0) {
+            uint32_t frameCount = 1000;
+
+            if (i + 1 < argc && argv[i + 1][0] != '-') {
+                frameCount = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+            }
+
+            app.enableHeadless(frameCount);
+        }
+        else if (strcmp(argv[i], "--uncapped") == 0) {
+            framePacer.mode = vkdev::FramePacingMode::Uncapped;
+        }
+        else if (strcmp(argv[i], "--fps") == 0 && i + 1 < argc) {
+            framePacer.mode = vkdev::FramePacingMode::TargetFps;
+            framePacer.targetFps = std::strtod(argv[++i], nullptr);
+        }
+        else if (strcmp(argv[i], "--present-mode") == 0 && i + 1 < argc) {
+            const std::string presentMode = argv[++i];
+            framePacer.mode = vkdev::FramePacingMode::VSync;
+
+            if (presentMode == "fifo") {
+                framePacer.vsyncPresentMode = VK_PRESENT_MODE_FIFO_KHR;
+            }
+            else if (presentMode == "mailbox") {
+                framePacer.vsyncPresentMode = VK_PRESENT_MODE_MAILBOX_KHR;
+            }
+            else if (presentMode == "immediate") {
+                framePacer.vsyncPresentMode = VK_PRESENT_MODE_IMMEDIATE_KHR;
+            }
+            else {
+                std::cerr << "unknown present mode: " << presentMode << std::endl;
+                return EXIT_FAILURE;
+            }
+        }
+        else if (strcmp(argv[i], "--frames-in-flight") == 0 && i + 1 < argc) {
+            app.setFramesInFlight(static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10)));
+        }
+        else if (strcmp(argv[i], "--memory-report") == 0 && i + 1 < argc) {
+            app.setMemoryReportPath(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--model") == 0 && i + 1 < argc) {
+            app.setModelPath(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--texture") == 0 && i + 1 < argc) {
+            app.setTexturePath(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--texture-budget") == 0 && i + 1 < argc) {
+            app.setTextureBudget(static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10)));
+        }
+        else if (strcmp(argv[i], "--stream-upload-limit") == 0 && i + 1 < argc) {
+            app.setStreamUploadLimit(static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10)));
+        }
+        else if (strcmp(argv[i], "--gpu-instances") == 0 && i + 1 < argc) {
+            app.setGpuInstanceCount(static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10)));
+        }
+        else if (strcmp(argv[i], "--instances") == 0 && i + 1 < argc) {
+            app.setInstanceCount(static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10)));
+        }
+        else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            app.setThreadCount(static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10)));
+        }
+        else if (strcmp(argv[i], "--pin-threads") == 0) {
+            app.setPinThreads(true);
+        }
+        else if (strcmp(argv[i], "--record-threads") == 0 && i + 1 < argc) {
+            app.setRecordThreadCount(static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10)));
+        }
+    }
+
     try {
         app.run();
     }
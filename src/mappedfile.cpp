@@ -0,0 +1,150 @@
+#include "vkdev/mappedfile.h"
+
+#include <stdexcept>
+#include <utility>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace vkdev {
+
+MappedFile::~MappedFile() {
+    cleanup();
+}
+
+MappedFile::MappedFile(MappedFile&& other) noexcept {
+    *this = std::move(other);
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept {
+    if (this != &other) {
+        cleanup();
+
+        mappedData = std::exchange(other.mappedData, nullptr);
+        mappedSize = std::exchange(other.mappedSize, 0);
+
+#ifdef _WIN32
+        fileHandle = std::exchange(other.fileHandle, nullptr);
+        mappingHandle = std::exchange(other.mappingHandle, nullptr);
+#endif
+    }
+
+    return *this;
+}
+
+#ifdef _WIN32
+
+void MappedFile::open(const std::string& path) {
+    cleanup();
+
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        throw std::runtime_error("Unable to load file: " + path);
+    }
+
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(file, &fileSize)) {
+        CloseHandle(file);
+        throw std::runtime_error("Unable to determine size of file: " + path);
+    }
+
+    fileHandle = file;
+    mappedSize = static_cast<size_t>(fileSize.QuadPart);
+
+    // empty files cannot be mapped
+    if (mappedSize == 0) {
+        return;
+    }
+
+    mappingHandle = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (mappingHandle == nullptr) {
+        cleanup();
+        throw std::runtime_error("Unable to map file: " + path);
+    }
+
+    mappedData = static_cast<const uint8_t*>(MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0));
+    if (mappedData == nullptr) {
+        cleanup();
+        throw std::runtime_error("Unable to map file: " + path);
+    }
+}
+
+void MappedFile::cleanup() {
+    if (mappedData) {
+        UnmapViewOfFile(mappedData);
+    }
+
+    if (mappingHandle) {
+        CloseHandle(mappingHandle);
+    }
+
+    if (fileHandle) {
+        CloseHandle(fileHandle);
+    }
+
+    mappedData = nullptr;
+    mappedSize = 0;
+    mappingHandle = nullptr;
+    fileHandle = nullptr;
+}
+
+#else
+
+void MappedFile::open(const std::string& path) {
+    cleanup();
+
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::runtime_error("Unable to load file: " + path);
+    }
+
+    struct stat fileStat;
+    if (fstat(fd, &fileStat) != 0) {
+        ::close(fd);
+        throw std::runtime_error("Unable to determine size of file: " + path);
+    }
+
+    mappedSize = static_cast<size_t>(fileStat.st_size);
+
+    // empty files cannot be mapped
+    if (mappedSize == 0) {
+        ::close(fd);
+        return;
+    }
+
+    void* mapping = mmap(nullptr, mappedSize, PROT_READ, MAP_PRIVATE, fd, 0);
+
+    // the mapping holds its own reference to the file
+    ::close(fd);
+
+    if (mapping == MAP_FAILED) {
+        mappedSize = 0;
+        throw std::runtime_error("Unable to map file: " + path);
+    }
+
+    // the file is read front to back when uploading so let the OS read ahead aggressively
+    madvise(mapping, mappedSize, MADV_SEQUENTIAL);
+
+    mappedData = static_cast<const uint8_t*>(mapping);
+}
+
+void MappedFile::cleanup() {
+    if (mappedData) {
+        munmap(const_cast<uint8_t*>(mappedData), mappedSize);
+    }
+
+    mappedData = nullptr;
+    mappedSize = 0;
+}
+
+#endif
+
+}
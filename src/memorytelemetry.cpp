@@ -0,0 +1,145 @@
+#include "vkdev/memorytelemetry.h"
+
+#include <algorithm>
+#include <fstream>
+#include <stdexcept>
+
+namespace vkdev {
+
+const char* memoryCategoryName(MemoryCategory category) {
+    switch (category) {
+        case MemoryCategory::Mesh: return "mesh";
+        case MemoryCategory::Texture: return "texture";
+        case MemoryCategory::Uniform: return "uniform";
+        case MemoryCategory::Staging: return "staging";
+        case MemoryCategory::Attachment: return "attachment";
+        default: return "other";
+    }
+}
+
+void MemoryTelemetry::create(VkPhysicalDevice physical_, VmaAllocator allocator_, bool budgetSupported_) {
+    physical = physical_;
+    allocator = allocator_;
+    budgetSupported = budgetSupported_;
+}
+
+void MemoryTelemetry::track(VmaAllocation allocation, MemoryCategory category) {
+    if (allocation == VK_NULL_HANDLE) {
+        return;
+    }
+
+    VmaAllocationInfo info;
+    vmaGetAllocationInfo(allocator, allocation, &info);
+
+    std::lock_guard<std::mutex> lock(mutex);
+
+    allocations[allocation] = { category, info.size };
+
+    auto& stats = categories[static_cast<size_t>(category)];
+    stats.bytes += info.size;
+    stats.peakBytes = std::max(stats.peakBytes, stats.bytes);
+    stats.allocationCount += 1;
+}
+
+void MemoryTelemetry::untrack(VmaAllocation allocation) {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    auto result = allocations.find(allocation);
+    if (result == allocations.end()) {
+        return;
+    }
+
+    auto& stats = categories[static_cast<size_t>(result->second.category)];
+    stats.bytes -= result->second.size;
+    stats.allocationCount -= 1;
+
+    allocations.erase(result);
+}
+
+MemoryCategoryStats MemoryTelemetry::getCategoryStats(MemoryCategory category) const {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    return categories[static_cast<size_t>(category)];
+}
+
+// the budget structure is chained to the core 1.1 memory properties query rather than going through the allocator
+std::vector<MemoryHeapStats> MemoryTelemetry::getHeapStats() const {
+    VkPhysicalDeviceMemoryBudgetPropertiesEXT budgetProperties = {};
+    budgetProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_BUDGET_PROPERTIES_EXT;
+
+    VkPhysicalDeviceMemoryProperties2 memoryProperties = {};
+    memoryProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_PROPERTIES_2;
+    memoryProperties.pNext = budgetSupported ? &budgetProperties : nullptr;
+
+    vkGetPhysicalDeviceMemoryProperties2(physical, &memoryProperties);
+
+    std::vector<MemoryHeapStats> heaps(memoryProperties.memoryProperties.memoryHeapCount);
+
+    for (uint32_t i = 0; i < memoryProperties.memoryProperties.memoryHeapCount; i++) {
+        const VkMemoryHeap& heap = memoryProperties.memoryProperties.memoryHeaps[i];
+
+        heaps[i].size = heap.size;
+        heaps[i].deviceLocal = (heap.flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) != 0;
+
+        if (budgetSupported) {
+            heaps[i].budget = budgetProperties.heapBudget[i];
+            heaps[i].usage = budgetProperties.heapUsage[i];
+        }
+    }
+
+    return heaps;
+}
+
+nlohmann::json MemoryTelemetry::toJson() const {
+    nlohmann::json result;
+
+    VkDeviceSize totalBytes = 0;
+    uint32_t totalAllocations = 0;
+
+    nlohmann::json& categoryResults = result["categories"];
+    for (size_t i = 0; i < categories.size(); i++) {
+        const MemoryCategoryStats stats = getCategoryStats(static_cast<MemoryCategory>(i));
+
+        nlohmann::json& category = categoryResults[memoryCategoryName(static_cast<MemoryCategory>(i))];
+        category["bytes"] = stats.bytes;
+        category["peak_bytes"] = stats.peakBytes;
+        category["allocations"] = stats.allocationCount;
+
+        totalBytes += stats.bytes;
+        totalAllocations += stats.allocationCount;
+    }
+
+    result["total_bytes"] = totalBytes;
+    result["total_allocations"] = totalAllocations;
+    result["budget_supported"] = budgetSupported;
+
+    nlohmann::json& heapResults = result["heaps"];
+    heapResults = nlohmann::json::array();
+
+    for (const auto& heap : getHeapStats()) {
+        nlohmann::json heapResult;
+        heapResult["size"] = heap.size;
+        heapResult["device_local"] = heap.deviceLocal;
+
+        if (budgetSupported) {
+            heapResult["budget"] = heap.budget;
+            heapResult["usage"] = heap.usage;
+        }
+
+        heapResults.push_back(heapResult);
+    }
+
+    return result;
+}
+
+void MemoryTelemetry::writeJson(const std::string& path) const {
+    std::ofstream file(path);
+
+    if (!file) {
+        throw std::runtime_error("unable to write memory report: " + path);
+    }
+
+    file << toJson().dump(4) << std::endl;
+}
+
+}
@@ -1,82 +1,276 @@
 #include "vkdev/mesh.h"
 
+#include <algorithm>
+#include <cstring>
 #include <fstream>
+#include <limits>
 #include <stdexcept>
 
 namespace vkdev {
 
+/*
+The .model format is a sequence of little endian 32 bit fields:
+vertex attributes, vertex count, vertex buffer size, vertex buffer bytes,
+element count, element size, element buffer size, element buffer bytes, bounds.
+Every size is checked against the length of the file before the data is referenced.
+*/
 void MeshData::loadFromFile(const std::string& path) {
-    std::ifstream file(path, std::ios::binary);
+    file.open(path);
+
+    const uint8_t* data = file.data();
+    const size_t fileSize = file.size();
+    size_t offset = 0;
+
+    auto reserve = [&](size_t size) -> const uint8_t* {
+        if (size > fileSize - offset) {
+            throw std::runtime_error("Unexpected end of file: " + path);
+        }
+
+        const uint8_t* ptr = data + offset;
+        offset += size;
+
+        return ptr;
+    };
+
+    auto readUint32 = [&]() {
+        uint32_t value;
+        std::memcpy(&value, reserve(sizeof(uint32_t)), sizeof(uint32_t));
+        return value;
+    };
+
+    vertexAttributes = static_cast<MeshVertexAttributes>(readUint32());
+    vertexCount = readUint32();
+    vertexDataSize = readUint32();
+    vertexData = reserve(vertexDataSize);
+
+    elementCount = readUint32();
+    elementSize = readUint32();
+    elementDataSize = readUint32();
+    elementData = reserve(elementDataSize);
+
+    std::memcpy(&bounds, reserve(sizeof(Bounds)), sizeof(Bounds));
+
+    if (elementSize != sizeof(uint16_t) && elementSize != sizeof(uint32_t)) {
+        throw std::runtime_error("Unsupported element size in file: " + path);
+    }
 
-    if (!file) {
-        throw std::runtime_error("Unable to load file: " + path);
+    if (static_cast<uint64_t>(elementCount) * elementSize != elementDataSize) {
+        throw std::runtime_error("Element buffer size does not match element count in file: " + path);
     }
 
-    file.read(reinterpret_cast<char*>(&vertexAttributes), sizeof(uint32_t));
-    file.read(reinterpret_cast<char*>(&vertexCount), sizeof(uint32_t));
+    if ((vertexAttributes & ~Mesh::VERTEX_ATTRIBUTE_MASK) != 0) {
+        throw std::runtime_error("Unknown vertex attributes in file: " + path);
+    }
+
+    if (static_cast<uint64_t>(vertexCount) * Mesh::vertexSize(vertexAttributes) != vertexDataSize) {
+        throw std::runtime_error("Vertex buffer size does not match vertex count in file: " + path);
+    }
+}
+
+void MeshData::writeToFile(const std::string& path) const {
+    std::ofstream output(path, std::ios::binary);
 
-    uint32_t vertexBufferSize = 0;
-    file.read(reinterpret_cast<char*>(&vertexBufferSize), sizeof(uint32_t));
+    if (!output) {
+        throw std::runtime_error("Unable to write file: " + path);
+    }
 
-    vertexBuffer.resize(vertexBufferSize);
-    file.read(reinterpret_cast<char*>(vertexBuffer.data()), vertexBufferSize);
+    auto writeUint32 = [&output](uint32_t value) {
+        output.write(reinterpret_cast<const char*>(&value), sizeof(uint32_t));
+    };
 
-    file.read(reinterpret_cast<char*>(&elementCount), sizeof(uint32_t));
-    file.read(reinterpret_cast<char*>(&elementSize), sizeof(uint32_t));
+    writeUint32(vertexAttributes);
+    writeUint32(vertexCount);
+    writeUint32(vertexDataSize);
+    output.write(reinterpret_cast<const char*>(vertexData), vertexDataSize);
 
-    uint32_t elementBufferSize = 0;
-    file.read(reinterpret_cast<char*>(&elementBufferSize), sizeof(uint32_t));
+    writeUint32(elementCount);
+    writeUint32(elementSize);
+    writeUint32(elementDataSize);
+    output.write(reinterpret_cast<const char*>(elementData), elementDataSize);
 
-    elementBuffer.resize(elementBufferSize);
-    file.read(reinterpret_cast<char*>(elementBuffer.data()), elementBufferSize);
+    output.write(reinterpret_cast<const char*>(&bounds), sizeof(Bounds));
 
-    file.read(reinterpret_cast<char*>(&bounds), elementBufferSize);
+    if (!output) {
+        throw std::runtime_error("Error writing file: " + path);
+    }
 }
 
 /*
-Loading a model requires the creation of a vertex and index buffer.  Creating these buffers involves the following steps:
-create a temporary CPU visible staging buffer to copy vertex data to the GPU (device local)
-create our vertex buffer which will hold data on the GPU
-copy the staging buffer to device local buffer
-cleanup staging buffer
+Loading a model requires the creation of a vertex and index buffer.  The device local buffers are created here and the
+copies from staging memory are recorded into the upload manager's current batch.  The buffers must not be used until
+that batch has completed.
 */
-void Mesh::create(const MeshData& meshData, CommandPool& commandPool) {
-    const VkDeviceSize vertexBufferSize = static_cast<VkDeviceSize>(meshData.vertexBuffer.size());
+void Mesh::create(const MeshData& meshData, UploadManager& uploadManager) {
+    createLods(&meshData, 1, uploadManager);
+}
+
+void Mesh::create(const std::vector<MeshData>& lodData, UploadManager& uploadManager) {
+    createLods(lodData.data(), lodData.size(), uploadManager);
+}
+
+// each level of detail is appended to the vertex and index buffers and is drawn using a vertex offset
+void Mesh::createLods(const MeshData* lodData, size_t lodCount, UploadManager& uploadManager) {
+    if (lodCount == 0) {
+        throw std::runtime_error("A mesh requires at least one level of detail");
+    }
 
-    vkdev::Buffer stagingBuffer{ device };
-    stagingBuffer.createWithData(meshData.vertexBuffer.data(), vertexBufferSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VmaMemoryUsage::VMA_MEMORY_USAGE_CPU_ONLY);
-    vertexBuffer.create(vertexBufferSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, VmaMemoryUsage::VMA_MEMORY_USAGE_GPU_ONLY );
-    vkdev::Buffer::copy(commandPool, stagingBuffer, vertexBuffer);
-    stagingBuffer.cleanup();
+    VkDeviceSize vertexBufferSize = 0;
+    VkDeviceSize indexBufferSize = 0;
 
-    const VkDeviceSize indexBufferSize = static_cast<VkDeviceSize>(meshData.elementBuffer.size());
-    stagingBuffer.createWithData(meshData.elementBuffer.data(), indexBufferSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VmaMemoryUsage::VMA_MEMORY_USAGE_CPU_ONLY);
-    indexBuffer.create(indexBufferSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT, VmaMemoryUsage::VMA_MEMORY_USAGE_GPU_ONLY);
-    vkdev::Buffer::copy(commandPool, stagingBuffer, indexBuffer);
-    stagingBuffer.cleanup();
+    for (size_t i = 0; i < lodCount; i++) {
+        if (lodData[i].vertexAttributes != lodData[0].vertexAttributes || lodData[i].elementSize != lodData[0].elementSize) {
+            throw std::runtime_error("All levels of detail of a mesh must have the same vertex format and element size");
+        }
 
-    vertexAttributes = meshData.vertexAttributes;
-    vertexCount = meshData.vertexCount;
-    elementCount = meshData.elementCount;
-    elementSize = meshData.elementSize;
-    bounds = meshData.bounds;
+        vertexBufferSize += lodData[i].vertexDataSize;
+        indexBufferSize += lodData[i].elementDataSize;
+    }
+
+    vertexBuffer.create(vertexBufferSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, VmaMemoryUsage::VMA_MEMORY_USAGE_GPU_ONLY, MemoryCategory::Mesh);
+    indexBuffer.create(indexBufferSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT, VmaMemoryUsage::VMA_MEMORY_USAGE_GPU_ONLY, MemoryCategory::Mesh);
+
+    vertexAttributes = lodData[0].vertexAttributes;
+    vertexCount = lodData[0].vertexCount;
+    elementCount = lodData[0].elementCount;
+    elementSize = lodData[0].elementSize;
+    bounds = lodData[0].bounds;
+
+    const uint32_t stride = vertexSize();
+
+    VkDeviceSize vertexOffset = 0;
+    VkDeviceSize indexOffset = 0;
+    lods.clear();
+
+    for (size_t i = 0; i < lodCount; i++) {
+        const MeshData& meshData = lodData[i];
+
+        uploadManager.uploadBuffer(meshData.vertexData, meshData.vertexDataSize, vertexBuffer, VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, vertexOffset);
+        uploadManager.uploadBuffer(meshData.elementData, meshData.elementDataSize, indexBuffer, VK_ACCESS_INDEX_READ_BIT, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, indexOffset);
+
+        MeshLod lod;
+        lod.firstIndex = static_cast<uint32_t>(indexOffset / elementSize);
+        lod.indexCount = meshData.elementCount;
+        lod.vertexOffset = static_cast<int32_t>(vertexOffset / stride);
+        lod.error = meshData.lodError;
+        lods.push_back(lod);
+
+        vertexOffset += meshData.vertexDataSize;
+        indexOffset += meshData.elementDataSize;
+    }
+}
+
+// Number of pixels covered by one unit of object space at the point of the bounds nearest to the camera, which is
+// approximated by moving the distance to the center of the bounds towards the camera by the bounding sphere radius.
+// The bounds and LOD errors are in object space after dequantization, and object scale in modelView scales the result.
+static float getPixelsPerUnit(const Bounds& bounds, const glm::mat4& modelView, const glm::mat4& projection, float viewportHeight) {
+    const glm::vec3 center = glm::vec3(modelView * glm::vec4((bounds.min + bounds.max) * 0.5f, 1.0f));
+
+    const float scale = std::max(glm::length(glm::vec3(modelView[0])), std::max(glm::length(glm::vec3(modelView[1])), glm::length(glm::vec3(modelView[2]))));
+    const float radius = glm::length(bounds.max - bounds.min) * 0.5f * scale;
+
+    // the camera looks down -z in view space.  Inside the bounds the distance is clamped to avoid dividing by zero.
+    const float distance = std::max(-center.z - radius, std::numeric_limits<float>::epsilon());
+
+    // projection[1][1] is cot(fov / 2) and the viewport spans two units of normalized device coordinates
+    const float pixelsPerUnit = std::abs(projection[1][1]) * viewportHeight * 0.5f;
+
+    return scale / distance * pixelsPerUnit;
+}
+
+float Mesh::getProjectedError(uint32_t lod, const glm::mat4& modelView, const glm::mat4& projection, float viewportHeight) const {
+    return lods[lod].error * getPixelsPerUnit(bounds, modelView, projection, viewportHeight);
+}
+
+float Mesh::getProjectedSize(const glm::mat4& modelView, const glm::mat4& projection, float viewportHeight) const {
+    return glm::length(bounds.max - bounds.min) * getPixelsPerUnit(bounds, modelView, projection, viewportHeight);
+}
+
+uint32_t Mesh::selectLod(const glm::mat4& modelView, const glm::mat4& projection, float viewportHeight, uint32_t currentLod, float pixelError, float hysteresis) const {
+    const uint32_t lodCount = static_cast<uint32_t>(lods.size());
+    currentLod = std::min(currentLod, lodCount - 1);
+
+    // the current level has become too coarse, pick the coarsest level that is within the threshold
+    if (getProjectedError(currentLod, modelView, projection, viewportHeight) > pixelError * (1.0f + hysteresis)) {
+        uint32_t lod = currentLod;
+        while (lod > 0 && getProjectedError(lod, modelView, projection, viewportHeight) > pixelError) {
+            lod -= 1;
+        }
+
+        return lod;
+    }
+
+    uint32_t lod = currentLod;
+    while (lod + 1 < lodCount && getProjectedError(lod + 1, modelView, projection, viewportHeight) <= pixelError * (1.0f - hysteresis)) {
+        lod += 1;
+    }
+
+    return lod;
+}
+
+/*
+Describes how each vertex attribute is stored.  Attributes are always laid out in the order position, normal, texture
+coordinate, and shader locations are assigned in the same order.
+*/
+struct AttributeFormat {
+    VkFormat format;
+    uint32_t size;
+};
+
+static AttributeFormat getPositionFormat(uint32_t vertexAttributes) {
+    if (vertexAttributes & MeshVertexAttributes::QuantizedPositions)
+        return { VK_FORMAT_R16G16B16A16_UNORM, 4 * sizeof(uint16_t) };
+
+    return { VK_FORMAT_R32G32B32_SFLOAT, 3 * sizeof(float) };
+}
+
+static AttributeFormat getNormalFormat(uint32_t vertexAttributes) {
+    if (vertexAttributes & MeshVertexAttributes::QuantizedNormals)
+        return { VK_FORMAT_R16G16_SNORM, 2 * sizeof(int16_t) };
+
+    return { VK_FORMAT_R32G32B32_SFLOAT, 3 * sizeof(float) };
+}
+
+static AttributeFormat getTexCoordFormat(uint32_t vertexAttributes) {
+    if (vertexAttributes & MeshVertexAttributes::QuantizedTexCoords)
+        return { VK_FORMAT_R16G16_UNORM, 2 * sizeof(uint16_t) };
+
+    return { VK_FORMAT_R32G32_SFLOAT, 2 * sizeof(float) };
 }
 
 uint32_t Mesh::vertexSize() const {
+    return vertexSize(vertexAttributes);
+}
+
+uint32_t Mesh::vertexSize(uint32_t vertexAttributes) {
     uint32_t size = 0;
 
     if (vertexAttributes & MeshVertexAttributes::Positions)
-        size += 3 * sizeof(float);
+        size += getPositionFormat(vertexAttributes).size;
 
     if (vertexAttributes & MeshVertexAttributes::Normals)
-        size += 3 * sizeof(float);
+        size += getNormalFormat(vertexAttributes).size;
 
     if (vertexAttributes & MeshVertexAttributes::TexCoords)
-        size += 2 * sizeof(float);
+        size += getTexCoordFormat(vertexAttributes).size;
 
     return size;
 }
 
+// quantized positions are in the range [0, 1] across the bounds of the mesh
+glm::mat4 Mesh::getDequantizeTransform() const {
+    if (!(vertexAttributes & MeshVertexAttributes::QuantizedPositions)) {
+        return glm::mat4(1.0f);
+    }
+
+    glm::mat4 transform(1.0f);
+    transform[0][0] = bounds.max.x - bounds.min.x;
+    transform[1][1] = bounds.max.y - bounds.min.y;
+    transform[2][2] = bounds.max.z - bounds.min.z;
+    transform[3] = glm::vec4(bounds.min, 1.0f);
+
+    return transform;
+}
+
 MeshDescription Mesh::getMeshDescription() const {
     MeshDescription description;
     description.bindingDescription = getBindingDescription();
@@ -99,40 +293,56 @@ std::vector<VkVertexInputAttributeDescription> Mesh::getAttributeDescriptions()
     std::vector<VkVertexInputAttributeDescription> descriptions;
     uint32_t offset = 0U;
 
-    if (vertexAttributes & MeshVertexAttributes::Positions) {
+    auto addAttribute = [&descriptions, &offset](const AttributeFormat& attributeFormat) {
         VkVertexInputAttributeDescription desc = {};
         desc.binding = 0;
         desc.location = static_cast<uint32_t>(descriptions.size()); //location in the shader ie. layout(LOCATION = 0) etc
-        desc.format = VK_FORMAT_R32G32B32_SFLOAT;
+        desc.format = attributeFormat.format;
         desc.offset = offset;
 
         descriptions.push_back(desc);
-        offset += 3 * sizeof(float);
-    }
+        offset += attributeFormat.size;
+    };
 
-    if (vertexAttributes & MeshVertexAttributes::Normals) {
-        VkVertexInputAttributeDescription desc = {};
-        desc.binding = 0;
-        desc.location = static_cast<uint32_t>(descriptions.size());
-        desc.format = VK_FORMAT_R32G32B32_SFLOAT;
-        desc.offset = offset;
+    if (vertexAttributes & MeshVertexAttributes::Positions)
+        addAttribute(getPositionFormat(vertexAttributes));
 
-        descriptions.push_back(desc);
-        offset += 3 * sizeof(float);
-    }
+    if (vertexAttributes & MeshVertexAttributes::Normals)
+        addAttribute(getNormalFormat(vertexAttributes));
 
-    if (vertexAttributes & MeshVertexAttributes::TexCoords) {
+    if (vertexAttributes & MeshVertexAttributes::TexCoords)
+        addAttribute(getTexCoordFormat(vertexAttributes));
+
+    return descriptions;
+}
+
+uint32_t MeshDescription::addInstanceBinding(uint32_t stride, const std::vector<InstanceAttribute>& attributes) {
+    const uint32_t binding = static_cast<uint32_t>(instanceBindingDescriptions.size()) + 1;
+
+    VkVertexInputBindingDescription instanceBinding = {};
+    instanceBinding.binding = binding;
+    instanceBinding.stride = stride;
+    instanceBinding.inputRate = VK_VERTEX_INPUT_RATE_INSTANCE;
+    instanceBindingDescriptions.push_back(instanceBinding);
+
+    for (const auto& attribute : attributes) {
         VkVertexInputAttributeDescription desc = {};
-        desc.binding = 0;
-        desc.location = static_cast<uint32_t>(descriptions.size());
-        desc.format = VK_FORMAT_R32G32_SFLOAT;
-        desc.offset = offset;
+        desc.binding = binding;
+        desc.location = static_cast<uint32_t>(attributeDescriptions.size());
+        desc.format = attribute.format;
+        desc.offset = attribute.offset;
 
-        descriptions.push_back(desc);
-        offset += 2 * sizeof(float);
+        attributeDescriptions.push_back(desc);
     }
 
-    return descriptions;
+    return binding;
+}
+
+std::vector<VkVertexInputBindingDescription> MeshDescription::getBindingDescriptions() const {
+    std::vector<VkVertexInputBindingDescription> bindings = { bindingDescription };
+    bindings.insert(bindings.end(), instanceBindingDescriptions.begin(), instanceBindingDescriptions.end());
+
+    return bindings;
 }
 
 void Mesh::cleanup() {
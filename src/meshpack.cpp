@@ -0,0 +1,317 @@
+#include "vkdev/meshpack.h"
+
+#include <meshoptimizer.h>
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+
+namespace vkdev {
+
+void MeshPack::open(const std::string& path_) {
+    cleanup();
+
+    path = path_;
+    file.open(path);
+
+    MeshPackHeader header;
+    if (file.size() < sizeof(MeshPackHeader)) {
+        throw std::runtime_error("Unexpected end of file: " + path);
+    }
+    std::memcpy(&header, file.data(), sizeof(MeshPackHeader));
+
+    if (header.magic != MAGIC) {
+        throw std::runtime_error("Not a mesh pack: " + path);
+    }
+
+    if (header.version == 0 || header.version > VERSION) {
+        throw std::runtime_error("Unsupported mesh pack version " + std::to_string(header.version) + ": " + path);
+    }
+
+    const uint64_t tableSize = static_cast<uint64_t>(header.entryCount) * sizeof(MeshPackEntry);
+    if (header.entryOffset > file.size() || tableSize > file.size() - header.entryOffset) {
+        throw std::runtime_error("Table of contents exceeds file size: " + path);
+    }
+
+    entries.resize(header.entryCount);
+    std::memcpy(entries.data(), file.data() + header.entryOffset, static_cast<size_t>(tableSize));
+
+    for (const auto& entry : entries) {
+        validateEntry(entry);
+    }
+}
+
+void MeshPack::cleanup() {
+    entries.clear();
+    file.cleanup();
+}
+
+void MeshPack::validateEntry(const MeshPackEntry& entry) const {
+    if (std::find(std::begin(entry.name), std::end(entry.name), '\0') == std::end(entry.name)) {
+        throw std::runtime_error("Unterminated mesh name: " + path);
+    }
+
+    if (entry.elementSize != sizeof(uint16_t) && entry.elementSize != sizeof(uint32_t)) {
+        throw std::runtime_error("Unsupported element size for mesh " + std::string(entry.name) + ": " + path);
+    }
+
+    if (entry.vertexStream.encoding == StreamEncoding::MeshoptIndex || entry.elementStream.encoding == StreamEncoding::MeshoptVertex) {
+        throw std::runtime_error("Invalid stream encoding for mesh " + std::string(entry.name) + ": " + path);
+    }
+
+    if (entry.elementStream.stride != entry.elementSize) {
+        throw std::runtime_error("Element stride does not match element size for mesh " + std::string(entry.name) + ": " + path);
+    }
+
+    if ((entry.vertexAttributes & ~Mesh::VERTEX_ATTRIBUTE_MASK) != 0) {
+        throw std::runtime_error("Unknown vertex attributes for mesh " + std::string(entry.name) + ": " + path);
+    }
+
+    if (entry.vertexStream.stride != Mesh::vertexSize(entry.vertexAttributes)) {
+        throw std::runtime_error("Vertex stride does not match vertex attributes for mesh " + std::string(entry.name) + ": " + path);
+    }
+
+    validateStream(entry.vertexStream, entry.vertexCount, entry.vertexStream.stride);
+    validateStream(entry.elementStream, entry.elementCount, entry.elementSize);
+}
+
+void MeshPack::validateStream(const MeshPackStream& stream, uint32_t count, uint32_t stride) const {
+    if (stream.offset > file.size() || stream.size > file.size() - stream.offset) {
+        throw std::runtime_error("Stream exceeds file size: " + path);
+    }
+
+    if (static_cast<uint64_t>(count) * stride != stream.decodedSize) {
+        throw std::runtime_error("Stream size does not match element count: " + path);
+    }
+
+    switch (stream.encoding) {
+        case StreamEncoding::None:
+            if (stream.size != stream.decodedSize) {
+                throw std::runtime_error("Raw stream size mismatch: " + path);
+            }
+            break;
+
+        case StreamEncoding::MeshoptVertex:
+            if (stride == 0 || stride % 4 != 0 || stride > 256) {
+                throw std::runtime_error("Invalid stride for compressed vertex stream: " + path);
+            }
+            break;
+
+        case StreamEncoding::MeshoptIndex:
+            if (count % 3 != 0) {
+                throw std::runtime_error("Compressed index streams must contain triangles: " + path);
+            }
+            break;
+
+        default:
+            throw std::runtime_error("Unknown stream encoding: " + path);
+    }
+}
+
+int32_t MeshPack::findEntry(const std::string& name, uint32_t lod) const {
+    for (size_t i = 0; i < entries.size(); i++) {
+        if (entries[i].lod == lod && name == entries[i].name) {
+            return static_cast<int32_t>(i);
+        }
+    }
+
+    return -1;
+}
+
+void MeshPack::loadMesh(uint32_t index, MeshData& meshData) const {
+    const MeshPackEntry& entry = entries.at(index);
+
+    // any file previously loaded into meshData is no longer referenced
+    meshData.file.cleanup();
+
+    meshData.vertexAttributes = static_cast<MeshVertexAttributes>(entry.vertexAttributes);
+    meshData.vertexCount = entry.vertexCount;
+    meshData.elementCount = entry.elementCount;
+    meshData.elementSize = entry.elementSize;
+    meshData.bounds.min = glm::vec3(entry.boundsMin[0], entry.boundsMin[1], entry.boundsMin[2]);
+    meshData.bounds.max = glm::vec3(entry.boundsMax[0], entry.boundsMax[1], entry.boundsMax[2]);
+    meshData.lodError = entry.lodError;
+
+    const MeshPackStream& vertexStream = entry.vertexStream;
+    const uint8_t* vertexSource = file.data() + vertexStream.offset;
+    meshData.vertexDataSize = vertexStream.decodedSize;
+
+    if (vertexStream.encoding == StreamEncoding::MeshoptVertex) {
+        meshData.vertexStorage.resize(vertexStream.decodedSize);
+
+        if (meshopt_decodeVertexBuffer(meshData.vertexStorage.data(), entry.vertexCount, vertexStream.stride, vertexSource, vertexStream.size) != 0) {
+            throw std::runtime_error("Failed to decode vertex stream for mesh " + std::string(entry.name) + ": " + path);
+        }
+
+        meshData.vertexData = meshData.vertexStorage.data();
+    }
+    else {
+        meshData.vertexStorage.clear();
+        meshData.vertexData = vertexSource;
+    }
+
+    const MeshPackStream& elementStream = entry.elementStream;
+    const uint8_t* elementSource = file.data() + elementStream.offset;
+    meshData.elementDataSize = elementStream.decodedSize;
+
+    if (elementStream.encoding == StreamEncoding::MeshoptIndex) {
+        meshData.elementStorage.resize(elementStream.decodedSize);
+
+        if (meshopt_decodeIndexBuffer(meshData.elementStorage.data(), entry.elementCount, entry.elementSize, elementSource, elementStream.size) != 0) {
+            throw std::runtime_error("Failed to decode element stream for mesh " + std::string(entry.name) + ": " + path);
+        }
+
+        meshData.elementData = meshData.elementStorage.data();
+    }
+    else {
+        meshData.elementStorage.clear();
+        meshData.elementData = elementSource;
+    }
+}
+
+uint32_t MeshPack::loadMeshLods(const std::string& name, std::vector<MeshData>& lodData) const {
+    lodData.clear();
+
+    for (int32_t index = findEntry(name, 0); index >= 0; index = findEntry(name, static_cast<uint32_t>(lodData.size()))) {
+        lodData.emplace_back();
+        loadMesh(static_cast<uint32_t>(index), lodData.back());
+    }
+
+    if (lodData.empty()) {
+        throw std::runtime_error("Mesh " + name + " not found in: " + path);
+    }
+
+    return static_cast<uint32_t>(lodData.size());
+}
+
+void MeshPackWriter::addMesh(const std::string& name, uint32_t lod, float lodError, const MeshData& meshData, bool compress) {
+    MeshPackEntry entry = {};
+
+    if (name.size() >= sizeof(entry.name)) {
+        throw std::runtime_error("Mesh name is too long: " + name);
+    }
+    std::memcpy(entry.name, name.c_str(), name.size());
+
+    // the stride is implied by the vertex attributes, which is what the reader checks it against
+    const uint32_t vertexStride = Mesh::vertexSize(meshData.vertexAttributes);
+
+    if (meshData.vertexCount == 0 || static_cast<uint64_t>(meshData.vertexCount) * vertexStride != meshData.vertexDataSize) {
+        throw std::runtime_error("Vertex data size does not match the vertex count and attributes for mesh: " + name);
+    }
+
+    entry.lod = lod;
+    entry.lodError = lodError;
+    entry.vertexAttributes = meshData.vertexAttributes;
+    entry.vertexCount = meshData.vertexCount;
+    entry.elementCount = meshData.elementCount;
+    entry.elementSize = meshData.elementSize;
+
+    for (int i = 0; i < 3; i++) {
+        entry.boundsMin[i] = meshData.bounds.min[i];
+        entry.boundsMax[i] = meshData.bounds.max[i];
+    }
+
+    // the codecs have restrictions on their input, data which does not meet them is stored raw
+    const bool compressVertices = compress && vertexStride % 4 == 0 && vertexStride <= 256;
+    const bool compressElements = compress && meshData.elementCount % 3 == 0;
+
+    entry.vertexStream = addStream(meshData.vertexData, meshData.vertexDataSize, meshData.vertexCount, vertexStride,
+        compressVertices ? StreamEncoding::MeshoptVertex : StreamEncoding::None);
+
+    entry.elementStream = addStream(meshData.elementData, meshData.elementDataSize, meshData.elementCount, meshData.elementSize,
+        compressElements ? StreamEncoding::MeshoptIndex : StreamEncoding::None);
+
+    entries.push_back(entry);
+}
+
+MeshPackStream MeshPackWriter::addStream(const uint8_t* data, uint32_t size, uint32_t count, uint32_t stride, StreamEncoding encoding) {
+    MeshPackStream stream = {};
+    stream.decodedSize = size;
+    stream.stride = stride;
+    stream.encoding = encoding;
+
+    std::vector<uint8_t> encoded;
+
+    switch (encoding) {
+        case StreamEncoding::MeshoptVertex:
+            encoded.resize(meshopt_encodeVertexBufferBound(count, stride));
+            encoded.resize(meshopt_encodeVertexBuffer(encoded.data(), encoded.size(), data, count, stride));
+            break;
+
+        case StreamEncoding::MeshoptIndex: {
+            // the index encoder operates on 32 bit indices
+            std::vector<uint32_t> indices(count);
+            if (stride == sizeof(uint16_t)) {
+                const uint16_t* source = reinterpret_cast<const uint16_t*>(data);
+                std::copy(source, source + count, indices.begin());
+            }
+            else {
+                std::memcpy(indices.data(), data, size);
+            }
+
+            const uint32_t vertexCount = indices.empty() ? 0 : *std::max_element(indices.begin(), indices.end()) + 1;
+            encoded.resize(meshopt_encodeIndexBufferBound(count, vertexCount));
+            encoded.resize(meshopt_encodeIndexBuffer(encoded.data(), encoded.size(), indices.data(), count));
+            break;
+        }
+
+        default:
+            encoded.assign(data, data + size);
+            break;
+    }
+
+    // keep streams 4 byte aligned within the file
+    streamData.resize((streamData.size() + 3) & ~static_cast<size_t>(3));
+
+    stream.offset = streamData.size();
+    stream.size = static_cast<uint32_t>(encoded.size());
+    streamData.insert(streamData.end(), encoded.begin(), encoded.end());
+
+    return stream;
+}
+
+/*
+Stream data is written directly after the header, followed by the table of contents.  The offsets recorded while adding
+streams are relative to the start of the stream data and are adjusted here.
+*/
+void MeshPackWriter::write(const std::string& path) const {
+    std::ofstream file(path, std::ios::binary);
+
+    if (!file) {
+        throw std::runtime_error("Unable to write file: " + path);
+    }
+
+    const uint64_t streamOffset = sizeof(MeshPackHeader);
+    const uint64_t entryOffset = (streamOffset + streamData.size() + 7) & ~static_cast<uint64_t>(7);
+
+    if (entryOffset > UINT32_MAX) {
+        throw std::runtime_error("Mesh pack is too large: " + path);
+    }
+
+    MeshPackHeader header;
+    header.magic = MeshPack::MAGIC;
+    header.version = MeshPack::VERSION;
+    header.entryCount = static_cast<uint32_t>(entries.size());
+    header.entryOffset = static_cast<uint32_t>(entryOffset);
+
+    std::vector<MeshPackEntry> toc = entries;
+    for (auto& entry : toc) {
+        entry.vertexStream.offset += streamOffset;
+        entry.elementStream.offset += streamOffset;
+    }
+
+    const std::vector<char> padding(static_cast<size_t>(entryOffset - streamOffset - streamData.size()), 0);
+
+    file.write(reinterpret_cast<const char*>(&header), sizeof(MeshPackHeader));
+    file.write(reinterpret_cast<const char*>(streamData.data()), streamData.size());
+    file.write(padding.data(), padding.size());
+    file.write(reinterpret_cast<const char*>(toc.data()), toc.size() * sizeof(MeshPackEntry));
+
+    if (!file) {
+        throw std::runtime_error("Error writing file: " + path);
+    }
+}
+
+}
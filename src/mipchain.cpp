@@ -0,0 +1,263 @@
+#include "vkdev/mipchain.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#if defined(__AVX2__)
+#define VKDEV_MIP_AVX2
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define VKDEV_MIP_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace vkdev::MipChain {
+
+// Linear values are encoded to sRGB through a table indexed by the square root of the value, which spreads the steep
+// start of the curve over many entries so that every entry is within a tenth of a step of the exact encoding.
+static const uint32_t ENCODE_TABLE_SCALE = 4096;
+
+struct SrgbTables {
+    // The first 256 entries convert sRGB to linear and the next 256 convert alpha to [0, 1], so that the SIMD kernels can
+    // convert a whole pixel with one lookup by offsetting the index of its alpha channel.
+    float decode[512];
+
+    // sRGB code of the linear value (i / ENCODE_TABLE_SCALE)^2
+    int32_t encode[ENCODE_TABLE_SCALE + 1];
+
+    SrgbTables() {
+        for (uint32_t i = 0; i < 256; i++) {
+            const double value = i / 255.0;
+            decode[i] = static_cast<float>(value <= 0.04045 ? value / 12.92 : std::pow((value + 0.055) / 1.055, 2.4));
+            decode[256 + i] = static_cast<float>(value);
+        }
+
+        for (uint32_t i = 0; i <= ENCODE_TABLE_SCALE; i++) {
+            const double root = static_cast<double>(i) / ENCODE_TABLE_SCALE;
+            const double value = root * root;
+            const double encoded = value <= 0.0031308 ? value * 12.92 : 1.055 * std::pow(value, 1.0 / 2.4) - 0.055;
+            encode[i] = static_cast<int32_t>(std::lround(encoded * 255.0));
+        }
+    }
+};
+
+static const SrgbTables& getSrgbTables() {
+    static const SrgbTables tables;
+    return tables;
+}
+
+uint32_t getLevelCount(uint32_t width, uint32_t height) {
+    uint32_t levelCount = 1;
+
+    for (uint32_t size = std::max(width, height); size > 1; size >>= 1) {
+        levelCount++;
+    }
+
+    return levelCount;
+}
+
+const char* getSimdName() {
+#if defined(VKDEV_MIP_AVX2)
+    return "avx2";
+#elif defined(VKDEV_MIP_SSE2)
+    return "sse2";
+#else
+    return "scalar";
+#endif
+}
+
+// Filters destination pixels [begin, end) of a row.  This handles the pixels the SIMD kernels leave over as well as
+// sources one pixel wide, where the horizontal pair is clamped to the single column.
+static void downsampleRowScalar(const uint8_t* row0, const uint8_t* row1, uint32_t sourceWidth, uint8_t* destination, uint32_t begin, uint32_t end, bool srgb) {
+    const SrgbTables& tables = getSrgbTables();
+
+    for (uint32_t x = begin; x < end; x++) {
+        const uint32_t x0 = x * 2;
+        const uint32_t x1 = std::min(x0 + 1, sourceWidth - 1);
+
+        for (uint32_t channel = 0; channel < 4; channel++) {
+            const uint8_t a = row0[x0 * 4 + channel];
+            const uint8_t b = row0[x1 * 4 + channel];
+            const uint8_t c = row1[x0 * 4 + channel];
+            const uint8_t d = row1[x1 * 4 + channel];
+
+            if (!srgb) {
+                destination[x * 4 + channel] = static_cast<uint8_t>((a + b + c + d + 2) >> 2);
+                continue;
+            }
+
+            // summed in the same order as the SIMD kernels so that every path produces identical results
+            const float* decode = channel == 3 ? tables.decode + 256 : tables.decode;
+            const float value = ((decode[a] + decode[c]) + (decode[b] + decode[d])) * 0.25f;
+
+            destination[x * 4 + channel] = channel == 3
+                ? static_cast<uint8_t>(std::lrint(value * 255.0f))
+                : static_cast<uint8_t>(tables.encode[std::lrint(std::sqrt(value) * ENCODE_TABLE_SCALE)]);
+        }
+    }
+}
+
+#if defined(VKDEV_MIP_AVX2)
+
+// 8 destination pixels per iteration.  Returns the number of pixels written.
+static uint32_t downsampleRowUnorm(const uint8_t* row0, const uint8_t* row1, uint8_t* destination, uint32_t width) {
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i rounding = _mm256_set1_epi16(2);
+    uint32_t x = 0;
+
+    for (; x + 8 <= width; x += 8) {
+        __m256i sums[2];
+
+        for (uint32_t half = 0; half < 2; half++) {
+            const __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(row0 + (x * 2 + half * 8) * 4));
+            const __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(row1 + (x * 2 + half * 8) * 4));
+
+            // vertical sums of each pixel widened to 16 bits, within each lane low holds pixels 0 and 1 and high pixels 2 and 3
+            const __m256i low = _mm256_add_epi16(_mm256_unpacklo_epi8(a, zero), _mm256_unpacklo_epi8(b, zero));
+            const __m256i high = _mm256_add_epi16(_mm256_unpackhi_epi8(a, zero), _mm256_unpackhi_epi8(b, zero));
+
+            // adds horizontal neighbors, leaving two destination pixels in each lane
+            sums[half] = _mm256_add_epi16(_mm256_unpacklo_epi64(low, high), _mm256_unpackhi_epi64(low, high));
+            sums[half] = _mm256_srli_epi16(_mm256_add_epi16(sums[half], rounding), 2);
+        }
+
+        // packing works within lanes, which interleaves the pairs of pixels from each half
+        const __m256i packed = _mm256_packus_epi16(sums[0], sums[1]);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(destination + x * 4), _mm256_permute4x64_epi64(packed, _MM_SHUFFLE(3, 1, 2, 0)));
+    }
+
+    return x;
+}
+
+// Two destination pixels per iteration.  Table lookups are done with scalar loads, since gathers are slower than
+// separate loads on many CPUs.
+static uint32_t downsampleRowSrgb(const uint8_t* row0, const uint8_t* row1, uint8_t* destination, uint32_t width) {
+    const SrgbTables& tables = getSrgbTables();
+    const __m256 quarter = _mm256_set1_ps(0.25f);
+    const __m256 encodeScale = _mm256_set1_ps(static_cast<float>(ENCODE_TABLE_SCALE));
+    const __m256 alphaScale = _mm256_set1_ps(255.0f);
+    uint32_t x = 0;
+
+    // converts two pixels which are the given number of bytes apart
+    auto decode = [&tables](const uint8_t* pixels, uint32_t stride) {
+        const uint8_t* next = pixels + stride;
+        return _mm256_setr_ps(tables.decode[pixels[0]], tables.decode[pixels[1]], tables.decode[pixels[2]], tables.decode[256 + pixels[3]],
+            tables.decode[next[0]], tables.decode[next[1]], tables.decode[next[2]], tables.decode[256 + next[3]]);
+    };
+
+    for (; x + 2 <= width; x += 2) {
+        // the first half of each vector belongs to destination pixel x and the second half to x + 1
+        const __m256 left = _mm256_add_ps(decode(row0 + x * 8, 8), decode(row1 + x * 8, 8));
+        const __m256 right = _mm256_add_ps(decode(row0 + x * 8 + 4, 8), decode(row1 + x * 8 + 4, 8));
+        const __m256 value = _mm256_mul_ps(_mm256_add_ps(left, right), quarter);
+
+        alignas(32) int32_t indices[8];
+        alignas(32) int32_t alpha[8];
+        _mm256_store_si256(reinterpret_cast<__m256i*>(indices), _mm256_cvtps_epi32(_mm256_mul_ps(_mm256_sqrt_ps(value), encodeScale)));
+        _mm256_store_si256(reinterpret_cast<__m256i*>(alpha), _mm256_cvtps_epi32(_mm256_mul_ps(value, alphaScale)));
+
+        for (uint32_t i = 0; i < 8; i += 4) {
+            uint8_t* pixel = destination + x * 4 + i;
+            pixel[0] = static_cast<uint8_t>(tables.encode[indices[i]]);
+            pixel[1] = static_cast<uint8_t>(tables.encode[indices[i + 1]]);
+            pixel[2] = static_cast<uint8_t>(tables.encode[indices[i + 2]]);
+            pixel[3] = static_cast<uint8_t>(alpha[i + 3]);
+        }
+    }
+
+    return x;
+}
+
+#elif defined(VKDEV_MIP_SSE2)
+
+// 4 destination pixels per iteration.  Returns the number of pixels written.
+static uint32_t downsampleRowUnorm(const uint8_t* row0, const uint8_t* row1, uint8_t* destination, uint32_t width) {
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i rounding = _mm_set1_epi16(2);
+    uint32_t x = 0;
+
+    for (; x + 4 <= width; x += 4) {
+        __m128i sums[2];
+
+        for (uint32_t half = 0; half < 2; half++) {
+            const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row0 + (x * 2 + half * 4) * 4));
+            const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row1 + (x * 2 + half * 4) * 4));
+
+            // vertical sums of each pixel widened to 16 bits, low holds pixels 0 and 1 and high pixels 2 and 3
+            const __m128i low = _mm_add_epi16(_mm_unpacklo_epi8(a, zero), _mm_unpacklo_epi8(b, zero));
+            const __m128i high = _mm_add_epi16(_mm_unpackhi_epi8(a, zero), _mm_unpackhi_epi8(b, zero));
+
+            sums[half] = _mm_add_epi16(_mm_unpacklo_epi64(low, high), _mm_unpackhi_epi64(low, high));
+            sums[half] = _mm_srli_epi16(_mm_add_epi16(sums[half], rounding), 2);
+        }
+
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(destination + x * 4), _mm_packus_epi16(sums[0], sums[1]));
+    }
+
+    return x;
+}
+
+// One destination pixel per iteration.  SSE2 has no gather, so only the filtering and encoding math is vectorized.
+static uint32_t downsampleRowSrgb(const uint8_t* row0, const uint8_t* row1, uint8_t* destination, uint32_t width) {
+    const SrgbTables& tables = getSrgbTables();
+    const __m128 quarter = _mm_set1_ps(0.25f);
+    const __m128 encodeScale = _mm_set1_ps(static_cast<float>(ENCODE_TABLE_SCALE));
+    const __m128 alphaScale = _mm_set1_ps(255.0f);
+
+    auto decode = [&tables](const uint8_t* pixel) {
+        return _mm_setr_ps(tables.decode[pixel[0]], tables.decode[pixel[1]], tables.decode[pixel[2]], tables.decode[256 + pixel[3]]);
+    };
+
+    for (uint32_t x = 0; x < width; x++) {
+        const __m128 left = _mm_add_ps(decode(row0 + x * 8), decode(row1 + x * 8));
+        const __m128 right = _mm_add_ps(decode(row0 + x * 8 + 4), decode(row1 + x * 8 + 4));
+        const __m128 value = _mm_mul_ps(_mm_add_ps(left, right), quarter);
+
+        alignas(16) int32_t indices[4];
+        alignas(16) int32_t alpha[4];
+        _mm_store_si128(reinterpret_cast<__m128i*>(indices), _mm_cvtps_epi32(_mm_mul_ps(_mm_sqrt_ps(value), encodeScale)));
+        _mm_store_si128(reinterpret_cast<__m128i*>(alpha), _mm_cvtps_epi32(_mm_mul_ps(value, alphaScale)));
+
+        destination[x * 4 + 0] = static_cast<uint8_t>(tables.encode[indices[0]]);
+        destination[x * 4 + 1] = static_cast<uint8_t>(tables.encode[indices[1]]);
+        destination[x * 4 + 2] = static_cast<uint8_t>(tables.encode[indices[2]]);
+        destination[x * 4 + 3] = static_cast<uint8_t>(alpha[3]);
+    }
+
+    return width;
+}
+
+#else
+
+static uint32_t downsampleRowUnorm(const uint8_t*, const uint8_t*, uint8_t*, uint32_t) {
+    return 0;
+}
+
+static uint32_t downsampleRowSrgb(const uint8_t*, const uint8_t*, uint8_t*, uint32_t) {
+    return 0;
+}
+
+#endif
+
+void downsample(const uint8_t* source, uint32_t sourceWidth, uint32_t sourceHeight, uint8_t* destination, uint32_t firstRow, uint32_t lastRow, bool srgb) {
+    const uint32_t width = std::max(sourceWidth / 2, 1U);
+    const size_t sourcePitch = static_cast<size_t>(sourceWidth) * 4;
+    const size_t pitch = static_cast<size_t>(width) * 4;
+
+    for (uint32_t y = firstRow; y < lastRow; y++) {
+        const uint8_t* row0 = source + sourcePitch * (y * 2);
+        const uint8_t* row1 = source + sourcePitch * std::min(y * 2 + 1, sourceHeight - 1);
+        uint8_t* row = destination + pitch * y;
+
+        // the kernels read horizontal pairs of pixels, which a single column does not have
+        uint32_t filtered = 0;
+        if (sourceWidth > 1) {
+            filtered = srgb ? downsampleRowSrgb(row0, row1, row, width) : downsampleRowUnorm(row0, row1, row, width);
+        }
+
+        downsampleRowScalar(row0, row1, sourceWidth, row, filtered, width, srgb);
+    }
+}
+
+}
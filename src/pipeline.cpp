@@ -7,7 +7,8 @@ void Pipeline::cleanup() {
     vkDestroyPipelineLayout(device.logical, layout, nullptr);
 }
 
-std::unique_ptr<Pipeline> createDefaultPipeline(Device& device, Shader& shader, MeshDescription& meshDescription, SwapChainRenderTarget& renderTarget) {
+std::unique_ptr<Pipeline> createDefaultPipeline(Device& device, Shader& shader, MeshDescription& meshDescription, RenderTarget& renderTarget,
+                                                const std::vector<VkDescriptorSetLayout>& additionalSetLayouts) {
     auto pipeline = std::make_unique<Pipeline>(device);
 
     // shader stage describes which shader is our vertex / fragment shader
@@ -25,11 +26,13 @@ std::unique_ptr<Pipeline> createDefaultPipeline(Device& device, Shader& shader,
 
     VkPipelineShaderStageCreateInfo shaderStages[] = { vertexStage, fragmentStage };
 
-    // describe the input format of vertex data
+    // describe the input format of vertex data, along with any streams which are advanced per instance
+    const std::vector<VkVertexInputBindingDescription> bindingDescriptions = meshDescription.getBindingDescriptions();
+
     VkPipelineVertexInputStateCreateInfo vertexInput = {};
     vertexInput.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
-    vertexInput.vertexBindingDescriptionCount = 1;
-    vertexInput.pVertexBindingDescriptions = &meshDescription.bindingDescription;
+    vertexInput.vertexBindingDescriptionCount = static_cast<uint32_t>(bindingDescriptions.size());
+    vertexInput.pVertexBindingDescriptions = bindingDescriptions.data();
     vertexInput.vertexAttributeDescriptionCount = static_cast<uint32_t>(meshDescription.attributeDescriptions.size());
     vertexInput.pVertexAttributeDescriptions = meshDescription.attributeDescriptions.data();
 
@@ -59,14 +62,14 @@ std::unique_ptr<Pipeline> createDefaultPipeline(Device& device, Shader& shader,
     VkViewport viewport = {};
     viewport.x = 0.0f;
     viewport.y = 0.0f;
-    viewport.width = static_cast<float>(renderTarget.swapchain->extent.width);
-    viewport.height = static_cast<float>(renderTarget.swapchain->extent.height);
+    viewport.width = static_cast<float>(renderTarget.extent.width);
+    viewport.height = static_cast<float>(renderTarget.extent.height);
     viewport.minDepth = 0.0f;
     viewport.maxDepth = 1.0f;
 
     VkRect2D scissor = {};
     scissor.offset = { 0,0 };
-    scissor.extent = renderTarget.swapchain->extent;
+    scissor.extent = renderTarget.extent;
 
     VkPipelineViewportStateCreateInfo viewportState = {};
     viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
@@ -122,10 +125,13 @@ std::unique_ptr<Pipeline> createDefaultPipeline(Device& device, Shader& shader,
     colorBlending.blendConstants[2] = 0.0f; // Optional
     colorBlending.blendConstants[3] = 0.0f; // Optional
 
+    std::vector<VkDescriptorSetLayout> setLayouts = { shader.descriptorLayout };
+    setLayouts.insert(setLayouts.end(), additionalSetLayouts.begin(), additionalSetLayouts.end());
+
     VkPipelineLayoutCreateInfo pipelineLayoutInfo = {};
     pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-    pipelineLayoutInfo.setLayoutCount = 1; // Optional
-    pipelineLayoutInfo.pSetLayouts = &shader.descriptorLayout;
+    pipelineLayoutInfo.setLayoutCount = static_cast<uint32_t>(setLayouts.size());
+    pipelineLayoutInfo.pSetLayouts = setLayouts.data();
     pipelineLayoutInfo.pushConstantRangeCount = 0; // Optional
     pipelineLayoutInfo.pPushConstantRanges = nullptr; // Optional
 
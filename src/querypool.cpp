@@ -0,0 +1,188 @@
+#include "vkdev/querypool.h"
+
+#include "vkdev/commandpool.h"
+
+#include <array>
+#include <stdexcept>
+#include <vector>
+
+namespace vkdev {
+
+void TimestampQueryPool::create(CommandPool& commandPool, uint32_t slotCount_, uint32_t maxScopes_) {
+    slotCount = slotCount_;
+    maxScopes = maxScopes_;
+    uploadSlot = slotCount;
+
+    // timestamps are only supported on queues that report a non zero number of valid bits
+    uint32_t queueFamilyCount = 0;
+    vkGetPhysicalDeviceQueueFamilyProperties(device.physical, &queueFamilyCount, nullptr);
+
+    std::vector<VkQueueFamilyProperties> queueFamilyProperties(queueFamilyCount);
+    vkGetPhysicalDeviceQueueFamilyProperties(device.physical, &queueFamilyCount, queueFamilyProperties.data());
+
+    const uint32_t validBits = queueFamilyProperties[commandPool.queue.index].timestampValidBits;
+    supported = validBits > 0;
+
+    if (!supported) {
+        return;
+    }
+
+    timestampMask = validBits >= 64 ? ~0ULL : ((1ULL << validBits) - 1);
+
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(device.physical, &properties);
+    timestampPeriod = static_cast<double>(properties.limits.timestampPeriod);
+
+    // each scope requires a begin and end query.  The final slot is reserved for uploads
+    const uint32_t queryCount = (slotCount + 1) * maxScopes * 2;
+
+    VkQueryPoolCreateInfo queryPoolInfo = {};
+    queryPoolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+    queryPoolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+    queryPoolInfo.queryCount = queryCount;
+
+    if (vkCreateQueryPool(device.logical, &queryPoolInfo, nullptr, &handle) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create timestamp query pool");
+    }
+
+    // queries must be reset before they are first used or read.  After this every query is in the unavailable state.
+    auto commandBuffer = commandPool.createSingleUseBuffer();
+    commandBuffer.start();
+    vkCmdResetQueryPool(commandBuffer.handle, handle, 0, queryCount);
+    commandBuffer.submit();
+}
+
+void TimestampQueryPool::cleanup() {
+    if (handle != VK_NULL_HANDLE) {
+        vkDestroyQueryPool(device.logical, handle, nullptr);
+        handle = VK_NULL_HANDLE;
+    }
+
+    scopeNames.clear();
+    results.clear();
+}
+
+uint32_t TimestampQueryPool::getScopeIndex(const std::string& name) {
+    for (uint32_t i = 0; i < scopeNames.size(); i++) {
+        if (scopeNames[i] == name) {
+            return i;
+        }
+    }
+
+    if (scopeNames.size() == maxScopes) {
+        throw std::runtime_error("timestamp query pool scope limit exceeded: " + name);
+    }
+
+    scopeNames.push_back(name);
+    return static_cast<uint32_t>(scopeNames.size() - 1);
+}
+
+void TimestampQueryPool::reset(VkCommandBuffer commandBuffer, uint32_t slot) {
+    if (!supported) {
+        return;
+    }
+
+    vkCmdResetQueryPool(commandBuffer, handle, queryIndex(slot, 0, 0), maxScopes * 2);
+}
+
+void TimestampQueryPool::beginScope(VkCommandBuffer commandBuffer, uint32_t slot, const std::string& name, VkPipelineStageFlagBits stage) {
+    if (!supported) {
+        return;
+    }
+
+    vkCmdWriteTimestamp(commandBuffer, stage, handle, queryIndex(slot, getScopeIndex(name), 0));
+}
+
+void TimestampQueryPool::endScope(VkCommandBuffer commandBuffer, uint32_t slot, const std::string& name, VkPipelineStageFlagBits stage) {
+    if (!supported) {
+        return;
+    }
+
+    vkCmdWriteTimestamp(commandBuffer, stage, handle, queryIndex(slot, getScopeIndex(name), 1));
+}
+
+double TimestampQueryPool::ticksToMilliseconds(uint64_t begin, uint64_t end) const {
+    const uint64_t ticks = ((end & timestampMask) - (begin & timestampMask)) & timestampMask;
+    return static_cast<double>(ticks) * timestampPeriod / 1000000.0;
+}
+
+bool TimestampQueryPool::collect(uint32_t slot) {
+    if (!supported || scopeNames.empty()) {
+        return false;
+    }
+
+    // with the availability bit each query writes a pair of values: the timestamp followed by its availability
+    const uint32_t queryCount = static_cast<uint32_t>(scopeNames.size()) * 2;
+    std::vector<uint64_t> queryResults(queryCount * 2);
+
+    // VK_NOT_READY is expected if some queries have not been written yet.  Results of available queries are still written.
+    VkResult result = vkGetQueryPoolResults(device.logical, handle, queryIndex(slot, 0, 0), queryCount,
+        queryResults.size() * sizeof(uint64_t), queryResults.data(), 2 * sizeof(uint64_t),
+        VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WITH_AVAILABILITY_BIT);
+
+    if (result != VK_SUCCESS && result != VK_NOT_READY) {
+        throw std::runtime_error("failed to read timestamp query results");
+    }
+
+    bool collected = false;
+
+    for (size_t i = 0; i < scopeNames.size(); i++) {
+        const uint64_t* begin = &queryResults[i * 4];
+        const uint64_t* end = &queryResults[i * 4 + 2];
+
+        if (begin[1] != 0 && end[1] != 0) {
+            results[scopeNames[i]] = ticksToMilliseconds(begin[0], end[0]);
+            collected = true;
+        }
+    }
+
+    return collected;
+}
+
+void TimestampQueryPool::beginUpload(VkCommandBuffer commandBuffer) {
+    if (!supported) {
+        return;
+    }
+
+    vkCmdResetQueryPool(commandBuffer, handle, queryIndex(uploadSlot, 0, 0), 2);
+    vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, handle, queryIndex(uploadSlot, 0, 0));
+}
+
+void TimestampQueryPool::endUpload(VkCommandBuffer commandBuffer) {
+    if (!supported) {
+        return;
+    }
+
+    vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, handle, queryIndex(uploadSlot, 0, 1));
+}
+
+void TimestampQueryPool::collectUpload() {
+    if (!supported) {
+        return;
+    }
+
+    std::array<uint64_t, 4> queryResults = {};
+    VkResult result = vkGetQueryPoolResults(device.logical, handle, queryIndex(uploadSlot, 0, 0), 2,
+        sizeof(queryResults), queryResults.data(), 2 * sizeof(uint64_t),
+        VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WITH_AVAILABILITY_BIT);
+
+    if (result != VK_SUCCESS && result != VK_NOT_READY) {
+        throw std::runtime_error("failed to read upload timestamp query results");
+    }
+
+    if (queryResults[1] != 0 && queryResults[3] != 0) {
+        const double milliseconds = ticksToMilliseconds(queryResults[0], queryResults[2]);
+
+        results["upload"] = milliseconds;
+        totalUploadMilliseconds += milliseconds;
+        uploadCount += 1;
+    }
+}
+
+double TimestampQueryPool::getMilliseconds(const std::string& name) const {
+    auto result = results.find(name);
+
+    return result != results.end() ? result->second : 0.0;
+}
+
+}
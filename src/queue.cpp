@@ -38,4 +38,28 @@ namespace vkdev {
         
         throw std::runtime_error("Unable to find presentation queue index");
     }
-}
\ No newline at end of file
+
+    // Queue families that support transfer but not graphics typically map to dedicated DMA engines which can copy data
+    // while the graphics queue is busy rendering.  Families that also lack compute support are preferred as they are the most specialized.
+    uint32_t Queue::findTransferQueueIndex(VkPhysicalDevice physicalDevice) {
+        uint32_t queueFamilyCount = 0;
+        vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, nullptr);
+
+        std::vector<VkQueueFamilyProperties> queueFamilyProperties(queueFamilyCount);
+        vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, queueFamilyProperties.data());
+
+        const VkQueueFlags excludedFlagSets[] = { VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT, VK_QUEUE_GRAPHICS_BIT };
+
+        for (const VkQueueFlags excludedFlags : excludedFlagSets) {
+            for (size_t i = 0; i < queueFamilyProperties.size(); i++) {
+                const VkQueueFlags flags = queueFamilyProperties[i].queueFlags;
+
+                if ((flags & VK_QUEUE_TRANSFER_BIT) && !(flags & excludedFlags)) {
+                    return static_cast<uint32_t>(i);
+                }
+            }
+        }
+
+        return findGraphicsQueueIndex(physicalDevice);
+    }
+}
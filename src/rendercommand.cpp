@@ -1,78 +1,236 @@
 #include "vkdev/rendercommand.h"
 
+#include <algorithm>
 #include <array>
+#include <exception>
+#include <stdexcept>
 
 namespace vkdev {
 
-void RenderCommand::create(SwapChainRenderTarget& renderTarget, Pipeline& pipeline, Mesh& mesh, Descriptor& descriptor) {
-    commandBuffers.resize(renderTarget.framebuffers.size());
+void RenderCommand::create(RenderTarget& renderTarget_, uint32_t frameCount, TimestampQueryPool* timestamps_) {
+    renderTarget = &renderTarget_;
+    timestamps = timestamps_;
+    commandBuffers.resize(frameCount);
 
-    VkCommandBufferAllocateInfo allocInfo = {};
-    allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-    allocInfo.commandPool = commandPool.handle;
-    allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-    allocInfo.commandBufferCount = static_cast<uint32_t>(commandBuffers.size());
+    for (uint32_t i = 0; i < frameCount; i++) {
+        // the buffers are short lived, being recorded again every frame
+        commandPools.push_back(std::make_unique<CommandPool>(device, queue));
+        commandPools.back()->create(VK_COMMAND_POOL_CREATE_TRANSIENT_BIT);
 
-    if (vkAllocateCommandBuffers(device.logical, &allocInfo, commandBuffers.data()) != VK_SUCCESS) {
-        throw std::runtime_error("failed to allocate command buffers");
+        VkCommandBufferAllocateInfo allocInfo = {};
+        allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        allocInfo.commandPool = commandPools.back()->handle;
+        allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+        allocInfo.commandBufferCount = 1;
+
+        if (vkAllocateCommandBuffers(device.logical, &allocInfo, &commandBuffers[i]) != VK_SUCCESS) {
+            throw std::runtime_error("failed to allocate command buffers");
+        }
     }
 
-    for (size_t i = 0; i < commandBuffers.size(); i++) {
-        VkCommandBufferBeginInfo beginInfo = {};
-        beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-        beginInfo.flags = 0;
-        beginInfo.pInheritanceInfo = nullptr;
+    maxRanges = jobSystem == nullptr ? 1 : (threadCount > 0 ? threadCount : jobSystem->getThreadCount());
+    rangeStats.resize(maxRanges);
+
+    // a single range is always recorded inline, so it has no need for secondary buffers
+    if (maxRanges == 1) {
+        return;
+    }
+
+    secondaryBuffers.resize(frameCount * maxRanges);
+
+    for (uint32_t i = 0; i < frameCount * maxRanges; i++) {
+        rangePools.push_back(std::make_unique<CommandPool>(device, queue));
+        rangePools.back()->create(VK_COMMAND_POOL_CREATE_TRANSIENT_BIT);
+
+        VkCommandBufferAllocateInfo allocInfo = {};
+        allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        allocInfo.commandPool = rangePools.back()->handle;
+        allocInfo.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+        allocInfo.commandBufferCount = 1;
 
-        if (vkBeginCommandBuffer(commandBuffers[i], &beginInfo) != VK_SUCCESS) {
-            throw std::runtime_error("failed to begin command buffer recording");
+        if (vkAllocateCommandBuffers(device.logical, &allocInfo, &secondaryBuffers[i]) != VK_SUCCESS) {
+            throw std::runtime_error("failed to allocate secondary command buffers");
         }
+    }
+}
 
-        VkRenderPassBeginInfo renderPassInfo = {};
-        renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-        renderPassInfo.renderPass = renderTarget.renderPass;
-        renderPassInfo.framebuffer = renderTarget.framebuffers[i];
+VkCommandBuffer RenderCommand::record(uint32_t frameIndex, uint32_t imageIndex, RenderQueue& renderQueue) {
+    auto recordStart = Clock::now();
 
-        renderPassInfo.renderArea.offset = {0, 0};
-        renderPassInfo.renderArea.extent = renderTarget.swapchain->extent;
+    commandPools[frameIndex]->reset();
+    VkCommandBuffer commandBuffer = commandBuffers[frameIndex];
 
-        // clear value order should correspond to order of attachments.
-        std::array<VkClearValue, 2> clearValues = {};
-        clearValues[0].color = {0.0f, 0.0f, 0.0f, 1.0f};
-        clearValues[1].depthStencil = {1.0f,
-                                       0}; // The range of depths in the depth buffer is 0.0 to 1.0 in Vulkan, where 1.0 lies at the far view plane and 0.0 at the near view plane.
+    VkCommandBufferBeginInfo beginInfo = {};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    beginInfo.pInheritanceInfo = nullptr;
 
-        renderPassInfo.clearValueCount = static_cast<uint32_t>(clearValues.size());
-        renderPassInfo.pClearValues = clearValues.data();
+    if (vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS) {
+        throw std::runtime_error("failed to begin command buffer recording");
+    }
 
-        vkCmdBeginRenderPass(commandBuffers[i], &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
-        vkCmdBindPipeline(commandBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline.handle);
+    // query resets must happen outside of a render pass
+    if (timestamps) {
+        timestamps->reset(commandBuffer, frameIndex);
+        timestamps->beginScope(commandBuffer, frameIndex, "frame");
+    }
 
-        VkBuffer vertexBuffers[] = {mesh.vertexBuffer.buffer};
-        VkDeviceSize offsets[] = {0};
+    // GPU culled packets have their draws written by a dispatch, which must happen outside of the render pass
+    if (renderQueue.hasComputeWork()) {
+        if (timestamps) {
+            timestamps->beginScope(commandBuffer, frameIndex, "gpu_cull");
+        }
 
-        vkCmdBindVertexBuffers(commandBuffers[i], 0, 1, vertexBuffers, offsets);
+        renderQueue.recordCompute(commandBuffer, frameIndex);
 
-        // note that the current sample model has index count > 65535 so we use uint32_t
-        //vkCmdBindIndexBuffer(_commandBuffers[i], _indexBuffer, 0, VK_INDEX_TYPE_UINT16);
-        vkCmdBindIndexBuffer(commandBuffers[i], mesh.indexBuffer.buffer, 0, VK_INDEX_TYPE_UINT32);
+        if (timestamps) {
+            timestamps->endScope(commandBuffer, frameIndex, "gpu_cull");
+        }
+    }
+
+    VkRenderPassBeginInfo renderPassInfo = {};
+    renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+    renderPassInfo.renderPass = renderTarget->renderPass;
+    renderPassInfo.framebuffer = renderTarget->framebuffers[imageIndex];
+
+    renderPassInfo.renderArea.offset = {0, 0};
+    renderPassInfo.renderArea.extent = renderTarget->extent;
+
+    // clear value order should correspond to order of attachments.
+    std::array<VkClearValue, 2> clearValues = {};
+    clearValues[0].color = {0.0f, 0.0f, 0.0f, 1.0f};
+    clearValues[1].depthStencil = {1.0f,
+                                   0}; // The range of depths in the depth buffer is 0.0 to 1.0 in Vulkan, where 1.0 lies at the far view plane and 0.0 at the near view plane.
+
+    renderPassInfo.clearValueCount = static_cast<uint32_t>(clearValues.size());
+    renderPassInfo.pClearValues = clearValues.data();
+
+    if (timestamps) {
+        timestamps->beginScope(commandBuffer, frameIndex, "main_pass");
+    }
+
+    const size_t packetCount = renderQueue.size();
+    const size_t rangeCount = packetCount < parallelThreshold ? 1 : std::min<size_t>(maxRanges, packetCount / std::max<size_t>(parallelThreshold / 2, 1));
+    lastRangeCount = static_cast<uint32_t>(rangeCount);
 
-        // descriptor sets are not unique to graphics pipeline.  Therefore we need to specify we are binding to graphics (as opposed to compute)
-        vkCmdBindDescriptorSets(commandBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline.layout, 0, 1,
-                                &descriptor.descriptorSets[i], 0, nullptr);
+    if (rangeCount <= 1) {
+        vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+        stats = renderQueue.record(commandBuffer, frameIndex, 0, packetCount);
+    }
+    else {
+        // a subpass recorded with secondary buffers may not contain any other commands
+        vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+
+        const size_t rangeSize = (packetCount + rangeCount - 1) / rangeCount;
+        const VkFramebuffer framebuffer = renderTarget->framebuffers[imageIndex];
+
+        // jobs must not throw, errors are passed back to the calling thread once every range has finished
+        std::vector<std::exception_ptr> errors(rangeCount);
+        JobCounter counter;
+
+        for (size_t i = 1; i < rangeCount; i++) {
+            const size_t first = std::min(i * rangeSize, packetCount);
+            const size_t count = std::min(first + rangeSize, packetCount) - first;
+
+            jobSystem->run([this, &renderQueue, &errors, frameIndex, framebuffer, first, count, i]() {
+                try {
+                    recordSecondary(frameIndex, static_cast<uint32_t>(i), framebuffer, renderQueue, first, count);
+                }
+                catch (...) {
+                    errors[i] = std::current_exception();
+                }
+            }, &counter);
+        }
 
-        vkCmdDrawIndexed(commandBuffers[i], static_cast<uint32_t>(mesh.elementCount), 1, 0, 0, 0);
+        // the calling thread records the first range
+        try {
+            recordSecondary(frameIndex, 0, framebuffer, renderQueue, 0, std::min(rangeSize, packetCount));
+        }
+        catch (...) {
+            errors[0] = std::current_exception();
+        }
 
-        vkCmdEndRenderPass(commandBuffers[i]);
+        jobSystem->wait(counter);
 
-        if (vkEndCommandBuffer(commandBuffers[i]) != VK_SUCCESS) {
-            throw std::runtime_error("failed to record command buffer");
+        for (const auto& error : errors) {
+            if (error) {
+                std::rethrow_exception(error);
+            }
         }
+
+        vkCmdExecuteCommands(commandBuffer, static_cast<uint32_t>(rangeCount), &secondaryBuffers[frameIndex * maxRanges]);
+
+        // each range starts with nothing bound, so binds at the start of a range are counted again
+        stats = {};
+        for (size_t i = 0; i < rangeCount; i++) {
+            stats.packetCount += rangeStats[i].packetCount;
+            stats.pipelineBinds += rangeStats[i].pipelineBinds;
+            stats.descriptorBinds += rangeStats[i].descriptorBinds;
+            stats.meshBinds += rangeStats[i].meshBinds;
+            stats.drawCount += rangeStats[i].drawCount;
+        }
+    }
+
+    vkCmdEndRenderPass(commandBuffer);
+
+    if (timestamps) {
+        timestamps->endScope(commandBuffer, frameIndex, "main_pass");
+        timestamps->endScope(commandBuffer, frameIndex, "frame");
     }
+
+    if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS) {
+        throw std::runtime_error("failed to record command buffer");
+    }
+
+    lastRecordMilliseconds = std::chrono::duration<double, std::chrono::milliseconds::period>(Clock::now() - recordStart).count();
+    maxRecordMilliseconds = std::max(maxRecordMilliseconds, lastRecordMilliseconds);
+    totalRecordMilliseconds += lastRecordMilliseconds;
+    recordCount += 1;
+
+    return commandBuffer;
 }
 
-void RenderCommand::cleanup(){
-    vkFreeCommandBuffers(device.logical, commandPool.handle, static_cast<uint32_t>(commandBuffers.size()), commandBuffers.data());
+void RenderCommand::recordSecondary(uint32_t frameIndex, uint32_t range, VkFramebuffer framebuffer, const RenderQueue& renderQueue, size_t first, size_t count) {
+    rangePools[frameIndex * maxRanges + range]->reset();
+    VkCommandBuffer commandBuffer = secondaryBuffers[frameIndex * maxRanges + range];
+
+    // secondary buffers executed within a render pass must name the render pass they continue
+    VkCommandBufferInheritanceInfo inheritanceInfo = {};
+    inheritanceInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+    inheritanceInfo.renderPass = renderTarget->renderPass;
+    inheritanceInfo.subpass = 0;
+    inheritanceInfo.framebuffer = framebuffer;
+
+    VkCommandBufferBeginInfo beginInfo = {};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT | VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    beginInfo.pInheritanceInfo = &inheritanceInfo;
+
+    if (vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS) {
+        throw std::runtime_error("failed to begin secondary command buffer recording");
+    }
+
+    rangeStats[range] = renderQueue.record(commandBuffer, frameIndex, first, count);
+
+    if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS) {
+        throw std::runtime_error("failed to record secondary command buffer");
+    }
 }
 
+void RenderCommand::cleanup(){
+    // destroying a pool frees the command buffers allocated from it
+    for (auto& commandPool : commandPools) {
+        commandPool->cleanup();
+    }
+
+    for (auto& commandPool : rangePools) {
+        commandPool->cleanup();
+    }
+
+    commandPools.clear();
+    commandBuffers.clear();
+    rangePools.clear();
+    secondaryBuffers.clear();
+}
 
 }
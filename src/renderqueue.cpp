@@ -0,0 +1,200 @@
+#include "vkdev/renderqueue.h"
+
+#include <array>
+#include <cstring>
+#include <stdexcept>
+
+namespace vkdev {
+
+void RenderQueue::create(uint32_t maxPackets_) {
+    maxPackets = maxPackets_;
+
+    packets.reserve(maxPackets);
+    keys.reserve(maxPackets);
+}
+
+void RenderQueue::cleanup() {
+    clear();
+    resetIds();
+}
+
+void RenderQueue::clear() {
+    packets.clear();
+    keys.clear();
+    order.clear();
+    gpuCulledPacketCount = 0;
+}
+
+void RenderQueue::resetIds() {
+    pipelineIds.clear();
+    descriptorIds.clear();
+    meshIds.clear();
+}
+
+uint32_t RenderQueue::getId(std::unordered_map<const void*, uint32_t>& ids, const void* object) {
+    auto result = ids.find(object);
+
+    if (result == ids.end()) {
+        result = ids.emplace(object, static_cast<uint32_t>(ids.size())).first;
+    }
+
+    return result->second;
+}
+
+uint64_t RenderQueue::makeKey(uint32_t pipelineId, uint32_t descriptorId, uint32_t meshId, float depth) {
+    // the bits of a non negative float order the same way as its value, the most significant of them are kept
+    uint32_t depthBits = 0;
+    if (depth > 0.0f) {
+        memcpy(&depthBits, &depth, sizeof(depth));
+    }
+
+    uint64_t key = static_cast<uint64_t>(pipelineId & ((1U << PIPELINE_BITS) - 1));
+    key = (key << DESCRIPTOR_BITS) | (descriptorId & ((1U << DESCRIPTOR_BITS) - 1));
+    key = (key << MESH_BITS) | (meshId & ((1U << MESH_BITS) - 1));
+    key = (key << DEPTH_BITS) | (depthBits >> (31 - DEPTH_BITS));
+
+    return key;
+}
+
+uint32_t RenderQueue::submit(const DrawPacket& packet) {
+    if (packets.size() == maxPackets) {
+        throw std::runtime_error("render queue packet capacity exceeded");
+    }
+
+    const uint32_t handle = static_cast<uint32_t>(packets.size());
+
+    packets.push_back(packet);
+    keys.push_back(makeKey(getId(pipelineIds, packet.pipeline), getId(descriptorIds, packet.descriptor), getId(meshIds, packet.mesh), packet.depth));
+    order.push_back(handle);
+
+    if (packet.gpuCuller) {
+        gpuCulledPacketCount += 1;
+    }
+
+    return handle;
+}
+
+void RenderQueue::sort() {
+    const size_t count = keys.size();
+
+    // keys are kept in submission order, the sort reorders a copy of them alongside the packet indices
+    sortKeys.assign(keys.begin(), keys.end());
+    keyScratch.resize(count);
+    orderScratch.resize(count);
+
+    for (size_t i = 0; i < count; i++) {
+        order[i] = static_cast<uint32_t>(i);
+    }
+
+    for (uint32_t shift = 0; shift < 64; shift += 8) {
+        std::array<uint32_t, 256> histogram = {};
+
+        for (size_t i = 0; i < count; i++) {
+            histogram[(sortKeys[i] >> shift) & 0xFF] += 1;
+        }
+
+        // every key has the same digit, so this pass would not change the order
+        if (count == 0 || histogram[(sortKeys[0] >> shift) & 0xFF] == count) {
+            continue;
+        }
+
+        uint32_t offset = 0;
+        for (auto& bucket : histogram) {
+            const uint32_t bucketCount = bucket;
+            bucket = offset;
+            offset += bucketCount;
+        }
+
+        for (size_t i = 0; i < count; i++) {
+            const uint32_t destination = histogram[(sortKeys[i] >> shift) & 0xFF]++;
+            keyScratch[destination] = sortKeys[i];
+            orderScratch[destination] = order[i];
+        }
+
+        sortKeys.swap(keyScratch);
+        order.swap(orderScratch);
+    }
+}
+
+void RenderQueue::recordCompute(VkCommandBuffer commandBuffer, uint32_t frameIndex) {
+    for (const auto& packet : packets) {
+        if (packet.gpuCuller) {
+            packet.gpuCuller->recordCull(commandBuffer, frameIndex);
+        }
+    }
+}
+
+RenderQueueStats RenderQueue::record(VkCommandBuffer commandBuffer, uint32_t frameIndex, size_t first, size_t count) const {
+    RenderQueueStats stats;
+    stats.packetCount = static_cast<uint32_t>(count);
+
+    const Pipeline* boundPipeline = nullptr;
+    const Descriptor* boundDescriptor = nullptr;
+    uint32_t boundDynamicOffset = 0;
+    const Mesh* boundMesh = nullptr;
+
+    for (size_t i = first; i < first + count; i++) {
+        const DrawPacket& packet = packets[order[i]];
+
+        if (packet.pipeline != boundPipeline) {
+            vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, packet.pipeline->handle);
+            boundPipeline = packet.pipeline;
+            stats.pipelineBinds += 1;
+
+            // the new pipeline's layout may not be compatible with the bound descriptor set
+            boundDescriptor = nullptr;
+        }
+
+        if (packet.instanceBatcher) {
+            // the batcher binds a mesh and descriptor for each of its batches
+            packet.instanceBatcher->record(commandBuffer, frameIndex, packet.pipeline->layout, packet.dynamicOffset);
+
+            const Mesh* batchMesh = nullptr;
+            const Descriptor* batchDescriptor = nullptr;
+
+            for (const auto& batch : packet.instanceBatcher->getBatches()) {
+                stats.meshBinds += batch.mesh != batchMesh ? 1 : 0;
+                stats.descriptorBinds += batch.descriptor != batchDescriptor ? 1 : 0;
+                stats.drawCount += 1;
+
+                batchMesh = batch.mesh;
+                batchDescriptor = batch.descriptor;
+            }
+
+            boundDescriptor = nullptr;
+            boundMesh = nullptr;
+            continue;
+        }
+
+        if (packet.descriptor != boundDescriptor || packet.dynamicOffset != boundDynamicOffset) {
+            // descriptor sets are not unique to graphics pipeline.  Therefore we need to specify we are binding to graphics (as opposed to compute)
+            // the dynamic offset selects this frame's uniform data within the arena
+            vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, packet.pipeline->layout, 0, 1, &packet.descriptor->descriptorSet, 1, &packet.dynamicOffset);
+            boundDescriptor = packet.descriptor;
+            boundDynamicOffset = packet.dynamicOffset;
+            stats.descriptorBinds += 1;
+        }
+
+        if (packet.mesh != boundMesh) {
+            const VkDeviceSize offset = 0;
+            vkCmdBindVertexBuffers(commandBuffer, 0, 1, &packet.mesh->vertexBuffer.buffer, &offset);
+            vkCmdBindIndexBuffer(commandBuffer, packet.mesh->indexBuffer.buffer, 0, packet.mesh->indexType());
+            boundMesh = packet.mesh;
+            stats.meshBinds += 1;
+        }
+
+        if (packet.gpuCuller) {
+            packet.gpuCuller->recordDraw(commandBuffer, frameIndex, packet.pipeline->layout);
+        }
+        else {
+            const MeshLod& meshLod = packet.mesh->lods[packet.lod];
+            vkCmdDrawIndexed(commandBuffer, meshLod.indexCount, packet.instanceCount, meshLod.firstIndex, meshLod.vertexOffset, 0);
+        }
+
+        stats.drawCount += 1;
+    }
+
+    return stats;
+}
+
+}
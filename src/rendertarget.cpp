@@ -1,43 +1,62 @@
 #include "vkdev/rendertarget.h"
 
 #include <array>
+#include <limits>
 #include <memory>
+#include <stdexcept>
 
 namespace vkdev {
 
-void SwapChainRenderTarget::create(SwapChain& swapchain_, CommandPool& commandPool) {
+VkFormat RenderTarget::findDepthFormat(Device& device) {
     // this will retrieve the format we will use to create the depth buffer image
     // note that we are requiring that the format support a stencil buffer component
-    const VkFormat depthFormat = Image::findSupportedFormat(
+    return Image::findSupportedFormat(
         device,
         { VK_FORMAT_D32_SFLOAT, VK_FORMAT_D32_SFLOAT_S8_UINT, VK_FORMAT_D24_UNORM_S8_UINT },
         VK_IMAGE_TILING_OPTIMAL,
         VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT
     );
+}
+
+void SwapChainRenderTarget::create(SwapChain& swapchain_) {
+    const VkFormat depthFormat = findDepthFormat(device);
 
     swapchain = &swapchain_;
+    extent = swapchain->extent;
+    colorFormat = swapchain->imageFormat;
 
-    createImages(commandPool, depthFormat);
-    createRenderPass(depthFormat);
-    createFramebuffers();
+    createImages(depthFormat);
+    createRenderPass(depthFormat, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR); // signals we need this in a format that can be presented to the screen via swapchain.
+    createFramebuffers(swapchain->imageViews);
 }
 
-void SwapChainRenderTarget::createImages(CommandPool& commandPool, VkFormat depthFormat) {
+// the multisampled color and depth images are used by the same subpass so they need separate memory slots
+enum AttachmentSlot : uint32_t {
+    MsaaColor = 0,
+    Depth = 1
+};
+
+// Neither image is read after the render pass, so both are transient.  The render pass transitions them from undefined layout.
+// Their memory is kept by the attachment allocator when the render target is cleaned up so it can be reused after a resize.
+void RenderTarget::createImages(VkFormat depthFormat) {
     depthImage = std::make_unique<vkdev::Image>(device);
-    depthImage->create(swapchain->extent.width, swapchain->extent.height, 1, msaaSampleCount, depthFormat, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+    attachmentAllocator.createImage(*depthImage, AttachmentSlot::Depth, extent, msaaSampleCount, depthFormat, VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT | VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT);
     depthImage->createView(VK_IMAGE_ASPECT_DEPTH_BIT);
-    depthImage->transitionLayout(commandPool, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL);  // note this is optional in this case
 
     // create the multisampled color image buffer.  Note that multisampled images should not have multiple mip levels (enforced by the spec)
     // We are only ever rendering one image at a time, so only one multisampled image is needed
     msaaColorImage = std::make_unique<vkdev::Image>(device);
-    msaaColorImage->create(swapchain->extent.width, swapchain->extent.height, 1, msaaSampleCount, swapchain->imageFormat, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT | VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+    attachmentAllocator.createImage(*msaaColorImage, AttachmentSlot::MsaaColor, extent, msaaSampleCount, colorFormat, VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT | VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT);
     msaaColorImage->createView(VK_IMAGE_ASPECT_COLOR_BIT);
 }
 
-void SwapChainRenderTarget::createRenderPass(VkFormat depthFormat) {
+void RenderTarget::cleanupAttachmentMemory() {
+    attachmentAllocator.cleanup();
+}
+
+void RenderTarget::createRenderPass(VkFormat depthFormat, VkImageLayout finalLayout) {
     VkAttachmentDescription colorAttachment = {};
-    colorAttachment.format = swapchain->imageFormat;
+    colorAttachment.format = colorFormat;
     colorAttachment.samples = msaaSampleCount; // multisampling
 
     // These apply to color and depth data
@@ -63,14 +82,14 @@ void SwapChainRenderTarget::createRenderPass(VkFormat depthFormat) {
     // this is not required for depth attachments because they are not presented to the screen!
     // If MSAA is disabled then we should not create a resolve attachment.  Doing so will cause validation error
     VkAttachmentDescription colorAttachmentResolve = {};
-    colorAttachmentResolve.format = swapchain->imageFormat;
+    colorAttachmentResolve.format = colorFormat;
     colorAttachmentResolve.samples = VK_SAMPLE_COUNT_1_BIT; // we need to convert the image to 1 sample per pixel
     colorAttachmentResolve.loadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
     colorAttachmentResolve.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
     colorAttachmentResolve.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
     colorAttachmentResolve.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
     colorAttachmentResolve.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-    colorAttachmentResolve.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR; // signals we need this in a format that can be presented to the screen via swapchain.
+    colorAttachmentResolve.finalLayout = finalLayout;
 
     std::array<VkAttachmentDescription, 3> attachmentDescriptions = { colorAttachment, depthAttachment, colorAttachmentResolve };
 
@@ -119,29 +138,29 @@ void SwapChainRenderTarget::createRenderPass(VkFormat depthFormat) {
     }
 }
 
-void SwapChainRenderTarget::createFramebuffers() {
-    framebuffers.resize(swapchain->imageViews.size());
+void RenderTarget::createFramebuffers(const std::vector<VkImageView>& resolveViews) {
+    framebuffers.resize(resolveViews.size());
 
-    for (size_t i = 0; i < swapchain->imageViews.size(); i++) {
+    for (size_t i = 0; i < resolveViews.size(); i++) {
         // The color attachment differs for every swap chain image, but the same depth image can be used by all of them because only a single subpass is running at the same time due to our semaphores
-        std::array<VkImageView, 3> attachments = { msaaColorImage->view, depthImage->view, swapchain->imageViews[i] };
+        std::array<VkImageView, 3> attachments = { msaaColorImage->view, depthImage->view, resolveViews[i] };
 
         VkFramebufferCreateInfo framebufferInfo = {};
         framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
         framebufferInfo.renderPass = renderPass;
         framebufferInfo.attachmentCount = static_cast<uint32_t>(attachments.size());
         framebufferInfo.pAttachments = attachments.data();
-        framebufferInfo.width = swapchain->extent.width;
-        framebufferInfo.height = swapchain->extent.height;
+        framebufferInfo.width = extent.width;
+        framebufferInfo.height = extent.height;
         framebufferInfo.layers = 1;
 
         if (vkCreateFramebuffer(device.logical, &framebufferInfo, nullptr, &framebuffers[i]) != VK_SUCCESS) {
-            throw std::runtime_error("failed to create framebuffer for swap chain images");
+            throw std::runtime_error("failed to create framebuffer for render target images");
         }
     }
 }
 
-void SwapChainRenderTarget::cleanup() {
+void RenderTarget::cleanup() {
     depthImage->cleanup();
     msaaColorImage->cleanup();
 
@@ -149,7 +168,87 @@ void SwapChainRenderTarget::cleanup() {
         vkDestroyFramebuffer(device.logical, framebuffer, nullptr);
     }
 
+    framebuffers.clear();
+
     vkDestroyRenderPass(device.logical, renderPass, nullptr);
 }
 
-}
\ No newline at end of file
+void OffscreenRenderTarget::create(const VkExtent2D& extent_, VkFormat colorFormat_, uint32_t imageCount) {
+    const VkFormat depthFormat = findDepthFormat(device);
+
+    extent = extent_;
+    colorFormat = colorFormat_;
+
+    createImages(depthFormat);
+
+    // the resolve images take the place of the swap chain images.  They are left in transfer source layout so their contents can be read back if needed.
+    std::vector<VkImageView> resolveViews;
+    for (uint32_t i = 0; i < imageCount; i++) {
+        auto& colorImage = colorImages.emplace_back(std::make_unique<vkdev::Image>(device));
+        colorImage->create(extent.width, extent.height, 1, VK_SAMPLE_COUNT_1_BIT, colorFormat, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, MemoryCategory::Attachment);
+        colorImage->createView(VK_IMAGE_ASPECT_COLOR_BIT);
+        resolveViews.push_back(colorImage->view);
+    }
+
+    createRenderPass(depthFormat, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL);
+    createFramebuffers(resolveViews);
+}
+
+void OffscreenRenderTarget::cleanup() {
+    RenderTarget::cleanup();
+
+    for (auto& colorImage : colorImages) {
+        colorImage->cleanup();
+    }
+
+    colorImages.clear();
+}
+
+void OffscreenRenderTarget::createSyncObjects() {
+    inFlightFences.resize(colorImages.size());
+
+    VkFenceCreateInfo fenceInfo = {};
+    fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+    fenceInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
+
+    for (size_t i = 0; i < inFlightFences.size(); i++) {
+        if (vkCreateFence(device.logical, &fenceInfo, nullptr, &inFlightFences[i]) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create offscreen frame fences");
+        }
+    }
+}
+
+void OffscreenRenderTarget::cleanupSyncObjects() {
+    for (auto fence : inFlightFences) {
+        vkDestroyFence(device.logical, fence, nullptr);
+    }
+
+    inFlightFences.clear();
+}
+
+// each color image is used by exactly one frame in flight, so the frame index doubles as the image index
+VkResult OffscreenRenderTarget::aquireFrame(uint32_t& index) {
+    vkWaitForFences(device.logical, 1, &inFlightFences[currentFrameIndex], VK_TRUE, std::numeric_limits<uint64_t>::max());
+
+    index = static_cast<uint32_t>(currentFrameIndex);
+    return VK_SUCCESS;
+}
+
+VkResult OffscreenRenderTarget::drawFrame(uint32_t imageIndex, VkCommandBuffer commandBuffer) {
+    VkSubmitInfo submitInfo = {};
+    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submitInfo.commandBufferCount = 1;
+    submitInfo.pCommandBuffers = &commandBuffer;
+
+    vkResetFences(device.logical, 1, &inFlightFences[imageIndex]);
+
+    if (vkQueueSubmit(device.graphicsQueue.handle, 1, &submitInfo, inFlightFences[imageIndex]) != VK_SUCCESS) {
+        throw std::runtime_error("error submitting draw command");
+    }
+
+    currentFrameIndex = (currentFrameIndex + 1) % inFlightFences.size();
+
+    return VK_SUCCESS;
+}
+
+}
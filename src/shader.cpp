@@ -93,7 +93,7 @@ void Shader::create(const ShaderData& data) {
     fragmentShader = createShaderModule(data.fragmentShaderCode, device);
 
     // temp
-    info.uniforms.push_back({ "UniformBufferObject", VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_VERTEX_BIT, 192 });
+    info.uniforms.push_back({ "UniformBufferObject", VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, VK_SHADER_STAGE_VERTEX_BIT, 192 });
     info.uniforms.push_back({ "texSampler", VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT, 0 });
 
     descriptorLayout = createDescriptorSetLayout(device, info);
@@ -0,0 +1,76 @@
+#include "vkdev/stagingring.h"
+
+namespace vkdev {
+
+void StagingRing::create(VkDeviceSize capacity) {
+    // CPU_ONLY memory is host coherent so writes do not need to be flushed
+    buffer.createMapped(capacity, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VmaMemoryUsage::VMA_MEMORY_USAGE_CPU_ONLY, MemoryCategory::Staging);
+
+    head = 0;
+    tail = 0;
+    hasUnretired = false;
+    retired.clear();
+}
+
+void StagingRing::cleanup() {
+    buffer.cleanup();
+    retired.clear();
+}
+
+bool StagingRing::allocate(VkDeviceSize size, VkDeviceSize alignment, Allocation& allocation) {
+    const VkDeviceSize capacity = buffer.size;
+
+    if (isEmpty()) {
+        head = 0;
+        tail = 0;
+    }
+
+    VkDeviceSize offset = (head + alignment - 1) / alignment * alignment;
+
+    if (isEmpty() || head > tail) {
+        // the free space is from head to the end of the buffer and from the start of the buffer to tail
+        if (offset + size > capacity) {
+            if (!isEmpty() && size > tail) {
+                return false;
+            }
+
+            // the remainder of the buffer is skipped.  It is reclaimed when tail moves past the region that wrapped
+            offset = 0;
+
+            if (size > capacity) {
+                return false;
+            }
+        }
+    }
+    else if (offset + size > tail) {
+        // the free space is between head and tail.  If they are equal the ring is full.
+        return false;
+    }
+
+    head = offset + size;
+    hasUnretired = true;
+
+    allocation.offset = offset;
+    allocation.size = size;
+    allocation.data = static_cast<uint8_t*>(buffer.mapped) + offset;
+
+    return true;
+}
+
+void StagingRing::retire(uint64_t batchId) {
+    if (!hasUnretired) {
+        return;
+    }
+
+    retired.push_back({ batchId, head });
+    hasUnretired = false;
+}
+
+void StagingRing::release(uint64_t completedBatchId) {
+    while (!retired.empty() && retired.front().batchId <= completedBatchId) {
+        tail = retired.front().end;
+        retired.pop_front();
+    }
+}
+
+}
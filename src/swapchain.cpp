@@ -3,6 +3,7 @@
 
 #include <optional>
 #include <algorithm>
+#include <limits>
 #include <stdexcept>
 
 namespace vkdev {
@@ -56,10 +57,11 @@ namespace vkdev {
         return availableFormats[0];
     }
 
-    VkPresentModeKHR chooseSwapPresentMode(const std::vector<VkPresentModeKHR>& availablePresentModes) {
-        for (const auto& availablePresentMode : availablePresentModes) {
-            if (availablePresentMode == VK_PRESENT_MODE_MAILBOX_KHR) {
-                return availablePresentMode;
+    // FIFO is the only present mode that is guaranteed to be supported
+    VkPresentModeKHR chooseSwapPresentMode(const std::vector<VkPresentModeKHR>& availablePresentModes, VkPresentModeKHR preferredPresentMode) {
+        for (const auto candidatePresentMode : { preferredPresentMode, VK_PRESENT_MODE_MAILBOX_KHR }) {
+            if (std::find(availablePresentModes.begin(), availablePresentModes.end(), candidatePresentMode) != availablePresentModes.end()) {
+                return candidatePresentMode;
             }
         }
 
@@ -81,7 +83,7 @@ namespace vkdev {
         SwapChainSupportInfo info = SwapChainSupportInfo::getForDevice(device.physical, surface);
 
         auto surfaceFormat = chooseSwapSurfaceFormat(info.formats);
-        auto presentMode = chooseSwapPresentMode(info.presentModes);
+        presentMode = chooseSwapPresentMode(info.presentModes, preferredPresentMode);
         extent = chooseSwapExtent(info.surfaceCapabilities, framebufferSize);
 
         // need to determine how many images to have int he swap chain.  Recommendation is to use one more than the minimum
@@ -154,7 +156,7 @@ namespace vkdev {
     }
 
     void SwapChain::cleanupSyncObjects() {
-        for (int i = 0; i < MAX_SIMULTANEOUS_FRAMES; i++) {
+        for (size_t i = 0; i < inFlightFences.size(); i++) {
             vkDestroySemaphore(device.logical, renderFinishedSemaphores[i], nullptr);
             vkDestroySemaphore(device.logical, imageAvailableSemaphores[i], nullptr);
             vkDestroyFence(device.logical, inFlightFences[i], nullptr);
@@ -162,9 +164,9 @@ namespace vkdev {
     }
 
     void SwapChain::createSyncObjects() {
-        imageAvailableSemaphores.resize(MAX_SIMULTANEOUS_FRAMES);
-        renderFinishedSemaphores.resize(MAX_SIMULTANEOUS_FRAMES);
-        inFlightFences.resize(MAX_SIMULTANEOUS_FRAMES);
+        imageAvailableSemaphores.resize(framesInFlight);
+        renderFinishedSemaphores.resize(framesInFlight);
+        inFlightFences.resize(framesInFlight);
         inFlightImages.resize(images.size(), VK_NULL_HANDLE);
 
         VkSemaphoreCreateInfo semaphoreInfo = {};
@@ -174,7 +176,7 @@ namespace vkdev {
         fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
         fenceInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
 
-        for (int i = 0; i < MAX_SIMULTANEOUS_FRAMES; i++) {
+        for (uint32_t i = 0; i < framesInFlight; i++) {
             if (vkCreateSemaphore(device.logical, &semaphoreInfo, nullptr, &imageAvailableSemaphores[i]) != VK_SUCCESS ||
                 vkCreateSemaphore(device.logical, &semaphoreInfo, NULL, &renderFinishedSemaphores[i]) != VK_SUCCESS ||
                 vkCreateFence(device.logical, &fenceInfo, nullptr, &inFlightFences[i]) != VK_SUCCESS) {
@@ -183,9 +185,11 @@ namespace vkdev {
         }
     }
 
-    VkResult SwapChain::aquireFrame(uint32_t& index) {
+    void SwapChain::waitForFrame() {
         vkWaitForFences(device.logical, 1, &inFlightFences[currentFrameIndex], VK_TRUE, std::numeric_limits<uint64_t>::max());
+    }
 
+    VkResult SwapChain::aquireFrame(uint32_t& index) {
         // get the next available image from the swap chain and signal the semaphore when its available
         // if there is an error we may need to recreate the swap chain.  I.E. Window is resized, etc.
         // we do not recreate swap chain in suboptimal state here because we have already acquired an image.  suboptimal return code is still considered a successful return value
@@ -253,7 +257,7 @@ namespace vkdev {
             throw std::runtime_error("failed to present swap chain image");
         }
 
-        currentFrameIndex = (currentFrameIndex + 1) % vkdev::SwapChain::MAX_SIMULTANEOUS_FRAMES;
+        currentFrameIndex = (currentFrameIndex + 1) % framesInFlight;
 
         return result;
     }
@@ -1,58 +1,424 @@
 #include "vkdev/texture.h"
 
+#include "vkdev/jobsystem.h"
+#include "vkdev/mipchain.h"
+#include "vkdev/textureformat.h"
+
 #define STB_IMAGE_IMPLEMENTATION
 #include <stb_image.h>
 
 #include <algorithm>
 #include <stdexcept>
 #include <cmath>
+#include <cstring>
+#include <fstream>
 
-namespace vkdev::Texture {
+namespace vkdev {
 
-Image createFromFile(const std::string& path, Device& device, CommandPool& commandPool) {
-    Image textureImage{ device };
+void TextureData::PixelDeleter::operator()(uint8_t* data) const {
+    stbi_image_free(data);
+}
+
+static bool isKtx2(const std::string& path) {
+    const std::string extension = ".ktx2";
+    return path.size() >= extension.size() && path.compare(path.size() - extension.size(), extension.size(), extension) == 0;
+}
+
+void TextureData::loadFromFile(const std::string& path) {
+    if (isKtx2(path)) {
+        loadKtx2(path);
+        return;
+    }
+
+    int imageWidth, imageHeight, numChannels;
+    stbi_uc* pixelData = stbi_load(path.c_str(), &imageWidth, &imageHeight, &numChannels, STBI_rgb_alpha);
+
+    if (!pixelData) {
+        throw std::runtime_error("failed to load texture image: " + path);
+    }
+
+    pixels.reset(pixelData);
+    width = static_cast<uint32_t>(imageWidth);
+    height = static_cast<uint32_t>(imageHeight);
+    format = VK_FORMAT_R8G8B8A8_UNORM;
+    generateMipmaps = true;
+
+    data = pixels.get();
+    size = static_cast<VkDeviceSize>(width) * height * 4;
+    levels = { { 0, size } };
+}
+
+// the fixed size portion of a KTX2 file, see the KTX 2.0 specification for the meaning of each field
+struct Ktx2Header {
+    uint8_t identifier[12];
+    uint32_t vkFormat;
+    uint32_t typeSize;
+    uint32_t pixelWidth;
+    uint32_t pixelHeight;
+    uint32_t pixelDepth;
+    uint32_t layerCount;
+    uint32_t faceCount;
+    uint32_t levelCount;
+    uint32_t supercompressionScheme;
+    uint32_t dfdByteOffset;
+    uint32_t dfdByteLength;
+    uint32_t kvdByteOffset;
+    uint32_t kvdByteLength;
+    uint64_t sgdByteOffset;
+    uint64_t sgdByteLength;
+};
+
+// the header is followed by one of these for each mip level, starting with level 0
+struct Ktx2Level {
+    uint64_t byteOffset;
+    uint64_t byteLength;
+    uint64_t uncompressedByteLength;
+};
+
+static_assert(sizeof(Ktx2Header) == 80, "KTX2 header must match the file layout");
+static_assert(sizeof(Ktx2Level) == 24, "KTX2 level index must match the file layout");
+
+static const uint8_t KTX2_IDENTIFIER[12] = { 0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n' };
+
+void TextureData::loadKtx2(const std::string& path) {
+    MappedFile mappedFile;
+    mappedFile.open(path);
+
+    Ktx2Header header;
+    if (mappedFile.size() < sizeof(header)) {
+        throw std::runtime_error("KTX2 file is truncated: " + path);
+    }
+
+    memcpy(&header, mappedFile.data(), sizeof(header));
+
+    if (memcmp(header.identifier, KTX2_IDENTIFIER, sizeof(KTX2_IDENTIFIER)) != 0) {
+        throw std::runtime_error("file is not a KTX2 texture: " + path);
+    }
+
+    if (header.supercompressionScheme != 0) {
+        throw std::runtime_error("supercompressed KTX2 textures are not supported: " + path);
+    }
+
+    // a format of 0 indicates Basis Universal data, which must be transcoded before it can be uploaded
+    const VkFormat textureFormat = static_cast<VkFormat>(header.vkFormat);
+    if (TextureFormat::getBlockSize(textureFormat) == 0) {
+        throw std::runtime_error("KTX2 texture format is not supported: " + path);
+    }
+
+    if (header.pixelWidth == 0 || header.pixelHeight == 0 || header.pixelDepth != 0 || header.layerCount > 1 || header.faceCount != 1) {
+        throw std::runtime_error("only 2D KTX2 textures are supported: " + path);
+    }
 
-    int width, height, numChannels;
-    stbi_uc* pixels = stbi_load(path.c_str(), &width, &height, &numChannels, STBI_rgb_alpha);
+    // a level count of 0 requests that the loader generates the mip levels
+    const bool generateLevels = header.levelCount == 0;
+    const uint32_t levelCount = std::max(header.levelCount, 1U);
+    const uint32_t maxLevelCount = static_cast<uint32_t>(std::floor(std::log2(std::max(header.pixelWidth, header.pixelHeight)))) + 1;
 
-    if (!pixels) {
-        throw std::runtime_error("failed to load texture image.");
+    if (levelCount > maxLevelCount) {
+        throw std::runtime_error("KTX2 texture has more mip levels than its size allows: " + path);
     }
 
-    uint32_t mipLevels = static_cast<uint32_t>(std::floor(std::log2(std::max(width, height)))) + 1;
+    if (generateLevels && TextureFormat::isBlockCompressed(textureFormat)) {
+        throw std::runtime_error("KTX2 texture must provide the mip levels of block compressed formats: " + path);
+    }
+
+    if (mappedFile.size() < sizeof(header) + sizeof(Ktx2Level) * levelCount) {
+        throw std::runtime_error("KTX2 file is truncated: " + path);
+    }
+
+    std::vector<ImageLevel> textureLevels(levelCount);
 
-    // we follow the convention of creating the staging buffer, mapping memory then transferring to destination buffer
-    VkDeviceSize imageSize = width * height * 4;
-    vkdev::Buffer stagingBuffer{ device };
+    for (uint32_t level = 0; level < levelCount; level++) {
+        Ktx2Level levelIndex;
+        memcpy(&levelIndex, mappedFile.data() + sizeof(header) + sizeof(Ktx2Level) * level, sizeof(levelIndex));
 
-    stagingBuffer.createWithData(pixels, imageSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VmaMemoryUsage::VMA_MEMORY_USAGE_CPU_ONLY);
+        const uint64_t expectedSize = TextureFormat::getImageSize(textureFormat, std::max(header.pixelWidth >> level, 1U), std::max(header.pixelHeight >> level, 1U));
 
-    stbi_image_free(pixels);
+        if (levelIndex.byteLength != expectedSize) {
+            throw std::runtime_error("KTX2 mip level size does not match its dimensions: " + path);
+        }
 
-    // note that since we are generating mipmaps via vkCmdBlitImage we need to inform vulkan that image buffer will be both a source and destination of image operations
-    const VkImageUsageFlags usageFlags = VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
-    const VkFormat imageFormat = VK_FORMAT_R8G8B8A8_UNORM;
+        if (levelIndex.byteOffset > mappedFile.size() || levelIndex.byteLength > mappedFile.size() - levelIndex.byteOffset) {
+            throw std::runtime_error("KTX2 file is truncated: " + path);
+        }
 
-    textureImage.create(static_cast<uint32_t>(width), static_cast<uint32_t>(height), mipLevels, VK_SAMPLE_COUNT_1_BIT, imageFormat, VK_IMAGE_TILING_OPTIMAL, usageFlags, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+        textureLevels[level] = { levelIndex.byteOffset, levelIndex.byteLength };
+    }
+
+    // the levels are addressed relative to the start of the file
+    pixels.reset();
+    storage.clear();
+    file = std::move(mappedFile);
 
-    // note: image was created with undefined layout in createImage function above we will transition the image into a state where it can have the data loaded into it.
-    textureImage.transitionLayout(commandPool, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
-    textureImage.loadBufferData(commandPool, stagingBuffer);
+    width = header.pixelWidth;
+    height = header.pixelHeight;
+    format = textureFormat;
+    levels = std::move(textureLevels);
+    generateMipmaps = generateLevels;
+
+    data = file.data();
+    size = file.size();
+}
 
-    if (textureImage.mipLevels > 1) {
-        // note that this function will transition all mipmap levels to optimal read format.  in lieu of this function, mipmap levels could be loaded in manually
-        textureImage.generateMipmaps(commandPool);
+TextureData TextureData::decompress() const {
+    if (!TextureFormat::canDecompress(format)) {
+        throw std::runtime_error("texture format can not be decompressed");
+    }
+
+    const VkExtent2D blockExtent = TextureFormat::getBlockExtent(format);
+    const uint32_t blockSize = TextureFormat::getBlockSize(format);
+
+    TextureData result;
+    result.width = width;
+    result.height = height;
+    result.format = TextureFormat::getDecompressedFormat(format);
+    result.generateMipmaps = generateMipmaps;
+
+    VkDeviceSize resultSize = 0;
+    for (uint32_t level = 0; level < levels.size(); level++) {
+        const VkDeviceSize levelSize = static_cast<VkDeviceSize>(std::max(width >> level, 1U)) * std::max(height >> level, 1U) * 4;
+        result.levels.push_back({ resultSize, levelSize });
+        resultSize += levelSize;
+    }
+
+    result.storage.resize(static_cast<size_t>(resultSize));
+
+    for (uint32_t level = 0; level < levels.size(); level++) {
+        const uint32_t levelWidth = std::max(width >> level, 1U);
+        const uint32_t levelHeight = std::max(height >> level, 1U);
+        const uint32_t blocksWide = (levelWidth + blockExtent.width - 1) / blockExtent.width;
+        const uint32_t blocksHigh = (levelHeight + blockExtent.height - 1) / blockExtent.height;
+
+        const uint8_t* block = data + levels[level].offset;
+        uint8_t* destination = result.storage.data() + result.levels[level].offset;
+
+        for (uint32_t blockY = 0; blockY < blocksHigh; blockY++) {
+            for (uint32_t blockX = 0; blockX < blocksWide; blockX++, block += blockSize) {
+                uint8_t texels[4 * 4 * 4];
+                TextureFormat::decompressBlock(format, block, texels);
+
+                // blocks on the right and bottom edges may extend past the image
+                const uint32_t x = blockX * 4;
+                const uint32_t y = blockY * 4;
+                const uint32_t copyWidth = std::min(4U, levelWidth - x);
+                const uint32_t copyHeight = std::min(4U, levelHeight - y);
+
+                for (uint32_t row = 0; row < copyHeight; row++) {
+                    memcpy(destination + (static_cast<size_t>(y + row) * levelWidth + x) * 4, texels + row * 16, copyWidth * 4);
+                }
+            }
+        }
+    }
+
+    result.data = result.storage.data();
+    result.size = resultSize;
+
+    return result;
+}
+
+// 8 bit RGBA in either channel order, which the filtering and the KTX2 data format descriptor both handle
+static bool isRgba8(VkFormat format) {
+    switch (format) {
+    case VK_FORMAT_R8G8B8A8_UNORM:
+    case VK_FORMAT_R8G8B8A8_SRGB:
+    case VK_FORMAT_B8G8R8A8_UNORM:
+    case VK_FORMAT_B8G8R8A8_SRGB:
+        return true;
+
+    default:
+        return false;
+    }
+}
+
+void TextureData::buildMipChain(JobSystem* jobSystem) {
+    if (!isRgba8(format)) {
+        throw std::runtime_error("mip chains can only be built for RGBA8 textures");
+    }
+
+    const bool srgb = TextureFormat::isSrgb(format);
+    const uint32_t levelCount = MipChain::getLevelCount(width, height);
+
+    std::vector<ImageLevel> chainLevels(levelCount);
+    VkDeviceSize chainSize = 0;
+
+    for (uint32_t level = 0; level < levelCount; level++) {
+        chainLevels[level].offset = chainSize;
+        chainLevels[level].size = static_cast<VkDeviceSize>(std::max(width >> level, 1U)) * std::max(height >> level, 1U) * 4;
+        chainSize += chainLevels[level].size;
+    }
+
+    std::vector<uint8_t> chain(static_cast<size_t>(chainSize));
+    memcpy(chain.data(), data + levels[0].offset, static_cast<size_t>(levels[0].size));
+
+    // each level is built from the one before it, so only the rows within a level are filtered in parallel
+    for (uint32_t level = 1; level < levelCount; level++) {
+        const uint8_t* source = chain.data() + chainLevels[level - 1].offset;
+        uint8_t* destination = chain.data() + chainLevels[level].offset;
+        const uint32_t sourceWidth = std::max(width >> (level - 1), 1U);
+        const uint32_t sourceHeight = std::max(height >> (level - 1), 1U);
+        const uint32_t levelHeight = std::max(height >> level, 1U);
+
+        auto downsampleRows = [&](size_t begin, size_t end) {
+            MipChain::downsample(source, sourceWidth, sourceHeight, destination, static_cast<uint32_t>(begin), static_cast<uint32_t>(end), srgb);
+        };
+
+        if (jobSystem) {
+            jobSystem->parallelFor(levelHeight, 16, downsampleRows);
+        }
+        else {
+            downsampleRows(0, levelHeight);
+        }
+    }
+
+    pixels.reset();
+    file.cleanup();
+    storage = std::move(chain);
+
+    data = storage.data();
+    size = chainSize;
+    levels = std::move(chainLevels);
+    generateMipmaps = false;
+}
+
+/*
+KTX2 files must describe their format with a data format descriptor even though the loader only reads vkFormat.  This
+writes the basic descriptor block for 8 bit RGBA data, whose samples are listed in the order they are stored.
+*/
+static std::vector<uint32_t> getRgba8DataFormatDescriptor(VkFormat format) {
+    const bool srgb = TextureFormat::isSrgb(format);
+    const bool bgra = format == VK_FORMAT_B8G8R8A8_UNORM || format == VK_FORMAT_B8G8R8A8_SRGB;
+
+    // channel ids of the RGBSDA color model
+    const uint32_t red = 0, green = 1, blue = 2, alpha = 15;
+    const uint32_t channels[4] = { bgra ? blue : red, green, bgra ? red : blue, alpha };
+
+    const uint32_t sampleCount = 4;
+    const uint32_t blockSize = 24 + 16 * sampleCount;
+
+    std::vector<uint32_t> descriptor;
+    descriptor.push_back(4 + blockSize);              // total size
+    descriptor.push_back(0);                          // Khronos vendor, basic descriptor type
+    descriptor.push_back(2 | (blockSize << 16));      // version 2
+    descriptor.push_back(1 | (1 << 8) | ((srgb ? 2 : 1) << 16)); // RGBSDA color model, BT.709 primaries, sRGB or linear transfer
+    descriptor.push_back(0);                          // 1x1x1 texel blocks
+    descriptor.push_back(4);                          // 4 bytes per texel in plane 0
+    descriptor.push_back(0);
+
+    for (uint32_t sample = 0; sample < sampleCount; sample++) {
+        // alpha is always stored linearly, which must be flagged when the transfer function is sRGB
+        const uint32_t linearFlag = (srgb && channels[sample] == alpha) ? 0x10 : 0;
+
+        descriptor.push_back((sample * 8) | (7 << 16) | ((channels[sample] | linearFlag) << 24)); // bit offset, bit length - 1, channel
+        descriptor.push_back(0);   // sample position
+        descriptor.push_back(0);   // lower
+        descriptor.push_back(255); // upper
+    }
+
+    return descriptor;
+}
+
+void TextureData::writeKtx2(const std::string& path) const {
+    if (!isRgba8(format)) {
+        throw std::runtime_error("only RGBA8 textures can be written to KTX2 files");
+    }
+
+    const std::vector<uint32_t> descriptor = getRgba8DataFormatDescriptor(format);
+    const uint32_t levelCount = static_cast<uint32_t>(levels.size());
+
+    Ktx2Header header = {};
+    memcpy(header.identifier, KTX2_IDENTIFIER, sizeof(KTX2_IDENTIFIER));
+    header.vkFormat = static_cast<uint32_t>(format);
+    header.typeSize = 1;
+    header.pixelWidth = width;
+    header.pixelHeight = height;
+    header.faceCount = 1;
+    header.levelCount = generateMipmaps ? 0 : levelCount;
+    header.dfdByteOffset = static_cast<uint32_t>(sizeof(Ktx2Header) + sizeof(Ktx2Level) * levelCount);
+    header.dfdByteLength = static_cast<uint32_t>(descriptor.size() * sizeof(uint32_t));
+
+    // The specification stores the smallest level first.  Every level of RGBA8 data is a multiple of 4 bytes, so the
+    // levels need no padding between them.
+    std::vector<Ktx2Level> levelIndex(levelCount);
+    uint64_t offset = header.dfdByteOffset + header.dfdByteLength;
+
+    for (uint32_t level = levelCount; level-- > 0;) {
+        levelIndex[level].byteOffset = offset;
+        levelIndex[level].byteLength = levels[level].size;
+        levelIndex[level].uncompressedByteLength = levels[level].size;
+        offset += levels[level].size;
+    }
+
+    std::ofstream output(path, std::ios::binary);
+
+    if (!output) {
+        throw std::runtime_error("Unable to write file: " + path);
+    }
+
+    output.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    output.write(reinterpret_cast<const char*>(levelIndex.data()), sizeof(Ktx2Level) * levelCount);
+    output.write(reinterpret_cast<const char*>(descriptor.data()), header.dfdByteLength);
+
+    for (uint32_t level = levelCount; level-- > 0;) {
+        output.write(reinterpret_cast<const char*>(data + levels[level].offset), static_cast<std::streamsize>(levels[level].size));
+    }
+
+    if (!output) {
+        throw std::runtime_error("Error writing file: " + path);
+    }
+}
+
+namespace Texture {
+
+bool isFormatSupported(Device& device, VkFormat format) {
+    VkFormatProperties formatProperties;
+    vkGetPhysicalDeviceFormatProperties(device.physical, format, &formatProperties);
+
+    return (formatProperties.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT) != 0;
+}
+
+Image create(const TextureData& data, Device& device, UploadManager& uploadManager) {
+    if (!isFormatSupported(device, data.format)) {
+        if (!TextureFormat::canDecompress(data.format)) {
+            throw std::runtime_error("device does not support the texture's format");
+        }
+
+        return create(data.decompress(), device, uploadManager);
+    }
+
+    Image textureImage{ device };
+
+    const uint32_t mipLevels = data.generateMipmaps
+        ? static_cast<uint32_t>(std::floor(std::log2(std::max(data.width, data.height)))) + 1
+        : static_cast<uint32_t>(data.levels.size());
+
+    // note that if we are generating mipmaps via vkCmdBlitImage we need to inform vulkan that image buffer will be both a source and destination of image operations
+    VkImageUsageFlags usageFlags = VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+    if (data.generateMipmaps) {
+        usageFlags |= VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+    }
+
+    textureImage.create(data.width, data.height, mipLevels, VK_SAMPLE_COUNT_1_BIT, data.format, VK_IMAGE_TILING_OPTIMAL, usageFlags, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, MemoryCategory::Texture);
+
+    // the data is copied into staging memory immediately so it can be freed before the upload is submitted
+    if (data.generateMipmaps) {
+        uploadManager.uploadImage(data.getData() + data.levels[0].offset, data.levels[0].size, textureImage, true);
     }
     else {
-        // now that the data is copied into the image, transition it to optimal read format
-        textureImage.transitionLayout(commandPool, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+        uploadManager.uploadImageLevels(data.getData(), data.levels, textureImage);
     }
 
     textureImage.createView(VK_IMAGE_ASPECT_COLOR_BIT);
 
-    stagingBuffer.cleanup();
-
     return textureImage;
 }
 
+Image createFromFile(const std::string& path, Device& device, UploadManager& uploadManager) {
+    TextureData data;
+    data.loadFromFile(path);
+
+    return create(data, device, uploadManager);
+}
+
+}
+
 }
@@ -0,0 +1,470 @@
+#include "vkdev/textureformat.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+namespace vkdev::TextureFormat {
+
+// block dimensions of the ASTC formats, in the order they are declared in VkFormat.  Each has a UNORM and an SRGB variant.
+static const VkExtent2D ASTC_BLOCK_EXTENTS[] = {
+    { 4, 4 }, { 5, 4 }, { 5, 5 }, { 6, 5 }, { 6, 6 }, { 8, 5 }, { 8, 6 }, { 8, 8 },
+    { 10, 5 }, { 10, 6 }, { 10, 8 }, { 10, 10 }, { 12, 10 }, { 12, 12 }
+};
+
+static bool isAstc(VkFormat format) {
+    return format >= VK_FORMAT_ASTC_4x4_UNORM_BLOCK && format <= VK_FORMAT_ASTC_12x12_SRGB_BLOCK;
+}
+
+VkExtent2D getBlockExtent(VkFormat format) {
+    if (isAstc(format)) {
+        return ASTC_BLOCK_EXTENTS[(format - VK_FORMAT_ASTC_4x4_UNORM_BLOCK) / 2];
+    }
+
+    return isBlockCompressed(format) ? VkExtent2D{ 4, 4 } : VkExtent2D{ 1, 1 };
+}
+
+uint32_t getBlockSize(VkFormat format) {
+    switch (format) {
+    case VK_FORMAT_R8_UNORM:
+        return 1;
+
+    case VK_FORMAT_R8G8_UNORM:
+        return 2;
+
+    case VK_FORMAT_R8G8B8A8_UNORM:
+    case VK_FORMAT_R8G8B8A8_SRGB:
+    case VK_FORMAT_B8G8R8A8_UNORM:
+    case VK_FORMAT_B8G8R8A8_SRGB:
+        return 4;
+
+    case VK_FORMAT_R16G16B16A16_SFLOAT:
+        return 8;
+
+    case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+    case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+    case VK_FORMAT_BC1_RGBA_UNORM_BLOCK:
+    case VK_FORMAT_BC1_RGBA_SRGB_BLOCK:
+    case VK_FORMAT_BC4_UNORM_BLOCK:
+        return 8;
+
+    case VK_FORMAT_BC3_UNORM_BLOCK:
+    case VK_FORMAT_BC3_SRGB_BLOCK:
+    case VK_FORMAT_BC5_UNORM_BLOCK:
+    case VK_FORMAT_BC7_UNORM_BLOCK:
+    case VK_FORMAT_BC7_SRGB_BLOCK:
+        return 16;
+
+    default:
+        return isAstc(format) ? 16 : 0;
+    }
+}
+
+uint64_t getImageSize(VkFormat format, uint32_t width, uint32_t height) {
+    const VkExtent2D blockExtent = getBlockExtent(format);
+    const uint64_t blocksWide = (width + blockExtent.width - 1) / blockExtent.width;
+    const uint64_t blocksHigh = (height + blockExtent.height - 1) / blockExtent.height;
+
+    return blocksWide * blocksHigh * getBlockSize(format);
+}
+
+bool isBlockCompressed(VkFormat format) {
+    return (format >= VK_FORMAT_BC1_RGB_UNORM_BLOCK && format <= VK_FORMAT_BC7_SRGB_BLOCK) || isAstc(format);
+}
+
+bool isSrgb(VkFormat format) {
+    switch (format) {
+    case VK_FORMAT_R8G8B8A8_SRGB:
+    case VK_FORMAT_B8G8R8A8_SRGB:
+    case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+    case VK_FORMAT_BC1_RGBA_SRGB_BLOCK:
+    case VK_FORMAT_BC3_SRGB_BLOCK:
+    case VK_FORMAT_BC7_SRGB_BLOCK:
+        return true;
+
+    default:
+        // the SRGB variant of each ASTC block size follows its UNORM variant
+        return isAstc(format) && (format - VK_FORMAT_ASTC_4x4_UNORM_BLOCK) % 2 == 1;
+    }
+}
+
+bool canDecompress(VkFormat format) {
+    switch (format) {
+    case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+    case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+    case VK_FORMAT_BC1_RGBA_UNORM_BLOCK:
+    case VK_FORMAT_BC1_RGBA_SRGB_BLOCK:
+    case VK_FORMAT_BC3_UNORM_BLOCK:
+    case VK_FORMAT_BC3_SRGB_BLOCK:
+    case VK_FORMAT_BC4_UNORM_BLOCK:
+    case VK_FORMAT_BC5_UNORM_BLOCK:
+    case VK_FORMAT_BC7_UNORM_BLOCK:
+    case VK_FORMAT_BC7_SRGB_BLOCK:
+        return true;
+
+    default:
+        return false;
+    }
+}
+
+VkFormat getDecompressedFormat(VkFormat format) {
+    return isSrgb(format) ? VK_FORMAT_R8G8B8A8_SRGB : VK_FORMAT_R8G8B8A8_UNORM;
+}
+
+// expands a 5 or 6 bit color channel to 8 bits by replicating its high bits
+static inline uint8_t expandBits(uint32_t value, uint32_t bits) {
+    value <<= 8 - bits;
+    return static_cast<uint8_t>(value | (value >> bits));
+}
+
+// Decodes a BC1 color block.  Blocks with c0 <= c1 encode three colors and transparent black, unless the block is part
+// of a BC3 block which always encodes four colors.
+static void decodeColorBlock(const uint8_t* block, uint8_t* texels, bool alwaysFourColors, bool hasAlpha) {
+    const uint32_t c0 = block[0] | (block[1] << 8);
+    const uint32_t c1 = block[2] | (block[3] << 8);
+
+    uint8_t colors[4][4];
+    for (uint32_t i = 0; i < 2; i++) {
+        const uint32_t c = i == 0 ? c0 : c1;
+        colors[i][0] = expandBits((c >> 11) & 0x1F, 5);
+        colors[i][1] = expandBits((c >> 5) & 0x3F, 6);
+        colors[i][2] = expandBits(c & 0x1F, 5);
+        colors[i][3] = 255;
+    }
+
+    for (uint32_t channel = 0; channel < 3; channel++) {
+        if (c0 > c1 || alwaysFourColors) {
+            colors[2][channel] = static_cast<uint8_t>((2 * colors[0][channel] + colors[1][channel] + 1) / 3);
+            colors[3][channel] = static_cast<uint8_t>((colors[0][channel] + 2 * colors[1][channel] + 1) / 3);
+        }
+        else {
+            colors[2][channel] = static_cast<uint8_t>((colors[0][channel] + colors[1][channel] + 1) / 2);
+            colors[3][channel] = 0;
+        }
+    }
+
+    colors[2][3] = 255;
+    colors[3][3] = (c0 > c1 || alwaysFourColors || !hasAlpha) ? 255 : 0;
+
+    const uint32_t indices = block[4] | (block[5] << 8) | (block[6] << 16) | (static_cast<uint32_t>(block[7]) << 24);
+    for (uint32_t i = 0; i < 16; i++) {
+        memcpy(texels + i * 4, colors[(indices >> (i * 2)) & 3], 4);
+    }
+}
+
+// decodes a BC4 block into one channel of the texels, which is also how BC3 stores alpha and BC5 stores each channel
+static void decodeChannelBlock(const uint8_t* block, uint8_t* texels, uint32_t channel) {
+    uint8_t values[8];
+    values[0] = block[0];
+    values[1] = block[1];
+
+    if (values[0] > values[1]) {
+        for (uint32_t i = 1; i < 7; i++) {
+            values[i + 1] = static_cast<uint8_t>(((7 - i) * values[0] + i * values[1] + 3) / 7);
+        }
+    }
+    else {
+        for (uint32_t i = 1; i < 5; i++) {
+            values[i + 1] = static_cast<uint8_t>(((5 - i) * values[0] + i * values[1] + 2) / 5);
+        }
+
+        values[6] = 0;
+        values[7] = 255;
+    }
+
+    uint64_t indices = 0;
+    for (uint32_t i = 0; i < 6; i++) {
+        indices |= static_cast<uint64_t>(block[2 + i]) << (i * 8);
+    }
+
+    for (uint32_t i = 0; i < 16; i++) {
+        texels[i * 4 + channel] = values[(indices >> (i * 3)) & 7];
+    }
+}
+
+// reads bits from a 128 bit block starting at the least significant bit of its first byte
+class BlockBitReader {
+public:
+    explicit BlockBitReader(const uint8_t* block) {
+        memcpy(&low, block, 8);
+        memcpy(&high, block + 8, 8);
+    }
+
+    uint32_t read(uint32_t count) {
+        if (count == 0) {
+            return 0;
+        }
+
+        const uint32_t value = static_cast<uint32_t>(low & ((1ULL << count) - 1));
+        low = (low >> count) | (count < 64 ? high << (64 - count) : 0);
+        high >>= count;
+
+        return value;
+    }
+
+private:
+    uint64_t low = 0;
+    uint64_t high = 0;
+};
+
+struct Bc7Mode {
+    uint32_t subsetCount;
+    uint32_t partitionBits;
+    uint32_t rotationBits;
+    uint32_t indexSelectionBits;
+    uint32_t colorBits;
+    uint32_t alphaBits;
+    uint32_t endpointPBits; // a p-bit for every endpoint
+    uint32_t sharedPBits;   // a p-bit shared by both endpoints of a subset
+    uint32_t indexBits;
+    uint32_t secondaryIndexBits;
+};
+
+static const Bc7Mode BC7_MODES[8] = {
+    { 3, 4, 0, 0, 4, 0, 1, 0, 3, 0 },
+    { 2, 6, 0, 0, 6, 0, 0, 1, 3, 0 },
+    { 3, 6, 0, 0, 5, 0, 0, 0, 2, 0 },
+    { 2, 6, 0, 0, 7, 0, 1, 0, 2, 0 },
+    { 1, 0, 2, 1, 5, 6, 0, 0, 2, 3 },
+    { 1, 0, 2, 0, 7, 8, 0, 0, 2, 2 },
+    { 1, 0, 0, 0, 7, 7, 1, 0, 4, 0 },
+    { 2, 6, 0, 0, 5, 5, 1, 0, 2, 0 }
+};
+
+// bit i is set when texel i belongs to the second subset
+static const uint16_t BC7_PARTITIONS_2[64] = {
+    0xCCCC, 0x8888, 0xEEEE, 0xECC8, 0xC880, 0xFEEC, 0xFEC8, 0xEC80, 0xC800, 0xFFEC, 0xFE80, 0xE800, 0xFFE8, 0xFF00, 0xFFF0, 0xF000,
+    0xF710, 0x008E, 0x7100, 0x08CE, 0x008C, 0x7310, 0x3100, 0x8CCE, 0x088C, 0x3110, 0x6666, 0x366C, 0x17E8, 0x0FF0, 0x718E, 0x399C,
+    0xAAAA, 0xF0F0, 0x5A5A, 0x33CC, 0x3C3C, 0x55AA, 0x9696, 0xA55A, 0x73CE, 0x13C8, 0x324C, 0x3BDC, 0x6996, 0xC33C, 0x9966, 0x0660,
+    0x0272, 0x04E4, 0x4E40, 0x2720, 0xC936, 0x936C, 0x39C6, 0x639C, 0x9336, 0x9CC6, 0x817E, 0xE718, 0xCCF0, 0x0FCC, 0x7744, 0xEE22
+};
+
+// two bits per texel holding the subset it belongs to
+static const uint32_t BC7_PARTITIONS_3[64] = {
+    0xAA685050, 0x6A5A5040, 0x5A5A4200, 0x5450A0A8, 0xA5A50000, 0xA0A05050, 0x5555A0A0, 0x5A5A5050,
+    0xAA550000, 0xAA555500, 0xAAAA5500, 0x90909090, 0x94949494, 0xA4A4A4A4, 0xA9A59450, 0x2A0A4250,
+    0xA5945040, 0x0A425054, 0xA5A5A500, 0x55A0A0A0, 0xA8A85454, 0x6A6A4040, 0xA4A45000, 0x1A1A0500,
+    0x0050A4A4, 0xAAA59090, 0x14696914, 0x69691400, 0xA08585A0, 0xAA821414, 0x50A4A450, 0x6A5A0200,
+    0xA9A58000, 0x5090A0A8, 0xA8A09050, 0x24242424, 0x00AA5500, 0x24924924, 0x24499224, 0x50A50A50,
+    0x500AA550, 0xAAAA4444, 0x66660000, 0xA5A0A5A0, 0x50A050A0, 0x69286928, 0x44AAAA44, 0x66666600,
+    0xAA444444, 0x54A854A8, 0x95809580, 0x96969600, 0xA85454A8, 0x80959580, 0xAA141414, 0x96960000,
+    0xAAAA1414, 0xA05050A0, 0xA0A5A5A0, 0x96000000, 0x40804080, 0xA9A8A9A8, 0xAAAAAA44, 0x2A4A5254
+};
+
+// the index of every subset's anchor texel is stored with one bit less, the first subset's anchor is always texel 0
+static const uint8_t BC7_ANCHORS_2[64] = {
+    15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15,
+    15, 2, 8, 2, 2, 8, 8, 15, 2, 8, 2, 2, 8, 8, 2, 2,
+    15, 15, 6, 8, 2, 8, 15, 15, 2, 8, 2, 2, 2, 15, 15, 6,
+    6, 2, 6, 8, 15, 15, 2, 2, 15, 15, 15, 15, 15, 2, 2, 15
+};
+
+static const uint8_t BC7_ANCHORS_3_SECOND[64] = {
+    3, 3, 15, 15, 8, 3, 15, 15, 8, 8, 6, 6, 6, 5, 3, 3,
+    3, 3, 8, 15, 3, 3, 6, 10, 5, 8, 8, 6, 8, 5, 15, 15,
+    8, 15, 3, 5, 6, 10, 8, 15, 15, 3, 15, 5, 15, 15, 15, 15,
+    3, 15, 5, 5, 5, 8, 5, 10, 5, 10, 8, 13, 15, 12, 3, 3
+};
+
+static const uint8_t BC7_ANCHORS_3_THIRD[64] = {
+    15, 8, 8, 3, 15, 15, 3, 8, 15, 15, 15, 15, 15, 15, 15, 8,
+    15, 8, 15, 3, 15, 8, 15, 8, 3, 15, 6, 10, 15, 15, 10, 8,
+    15, 3, 15, 10, 10, 8, 9, 10, 6, 15, 8, 15, 3, 6, 6, 8,
+    15, 3, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 3, 15, 15, 8
+};
+
+static const uint8_t BC7_WEIGHTS_2[4] = { 0, 21, 43, 64 };
+static const uint8_t BC7_WEIGHTS_3[8] = { 0, 9, 18, 27, 37, 46, 55, 64 };
+static const uint8_t BC7_WEIGHTS_4[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+static inline uint8_t bc7Interpolate(uint8_t e0, uint8_t e1, uint32_t index, uint32_t indexBits) {
+    const uint8_t* weights = indexBits == 2 ? BC7_WEIGHTS_2 : (indexBits == 3 ? BC7_WEIGHTS_3 : BC7_WEIGHTS_4);
+    const uint32_t weight = weights[index];
+
+    return static_cast<uint8_t>(((64 - weight) * e0 + weight * e1 + 32) >> 6);
+}
+
+static inline uint32_t bc7Subset(const Bc7Mode& mode, uint32_t partition, uint32_t texel) {
+    if (mode.subsetCount == 2) {
+        return (BC7_PARTITIONS_2[partition] >> texel) & 1;
+    }
+    else if (mode.subsetCount == 3) {
+        return (BC7_PARTITIONS_3[partition] >> (texel * 2)) & 3;
+    }
+
+    return 0;
+}
+
+static inline bool bc7IsAnchor(const Bc7Mode& mode, uint32_t partition, uint32_t texel) {
+    if (texel == 0) {
+        return true;
+    }
+    else if (mode.subsetCount == 2) {
+        return texel == BC7_ANCHORS_2[partition];
+    }
+    else if (mode.subsetCount == 3) {
+        return texel == BC7_ANCHORS_3_SECOND[partition] || texel == BC7_ANCHORS_3_THIRD[partition];
+    }
+
+    return false;
+}
+
+static void decodeBc7Block(const uint8_t* block, uint8_t* texels) {
+    // the mode is the position of the lowest set bit of the first byte
+    uint32_t modeIndex = 0;
+    while (modeIndex < 8 && !(block[0] & (1 << modeIndex))) {
+        modeIndex++;
+    }
+
+    // reserved modes decode to transparent black
+    if (modeIndex == 8) {
+        memset(texels, 0, 16 * 4);
+        return;
+    }
+
+    const Bc7Mode& mode = BC7_MODES[modeIndex];
+    BlockBitReader reader(block);
+    reader.read(modeIndex + 1);
+
+    const uint32_t partition = reader.read(mode.partitionBits);
+    const uint32_t rotation = reader.read(mode.rotationBits);
+    const uint32_t indexSelection = reader.read(mode.indexSelectionBits);
+
+    // endpoints are stored channel by channel, with both endpoints of every subset for each channel
+    const uint32_t endpointCount = mode.subsetCount * 2;
+    uint8_t endpoints[6][4] = {};
+
+    for (uint32_t channel = 0; channel < 3; channel++) {
+        for (uint32_t i = 0; i < endpointCount; i++) {
+            endpoints[i][channel] = static_cast<uint8_t>(reader.read(mode.colorBits));
+        }
+    }
+
+    for (uint32_t i = 0; i < endpointCount; i++) {
+        endpoints[i][3] = static_cast<uint8_t>(reader.read(mode.alphaBits));
+    }
+
+    uint32_t pBits[6] = {};
+    if (mode.endpointPBits) {
+        for (uint32_t i = 0; i < endpointCount; i++) {
+            pBits[i] = reader.read(1);
+        }
+    }
+    else if (mode.sharedPBits) {
+        for (uint32_t subset = 0; subset < mode.subsetCount; subset++) {
+            pBits[subset * 2] = pBits[subset * 2 + 1] = reader.read(1);
+        }
+    }
+
+    const bool hasPBits = mode.endpointPBits || mode.sharedPBits;
+    const uint32_t colorBits = mode.colorBits + (hasPBits ? 1 : 0);
+    const uint32_t alphaBits = mode.alphaBits + (hasPBits && mode.alphaBits ? 1 : 0);
+
+    for (uint32_t i = 0; i < endpointCount; i++) {
+        for (uint32_t channel = 0; channel < 4; channel++) {
+            const uint32_t bits = channel < 3 ? colorBits : alphaBits;
+
+            if (bits == 0) {
+                endpoints[i][channel] = 255;
+                continue;
+            }
+
+            uint32_t value = endpoints[i][channel];
+            if (hasPBits) {
+                value = (value << 1) | pBits[i];
+            }
+
+            endpoints[i][channel] = expandBits(value, bits);
+        }
+    }
+
+    uint32_t indices[16] = {};
+    uint32_t secondaryIndices[16] = {};
+
+    for (uint32_t i = 0; i < 16; i++) {
+        indices[i] = reader.read(mode.indexBits - (bc7IsAnchor(mode, partition, i) ? 1 : 0));
+    }
+
+    if (mode.secondaryIndexBits) {
+        for (uint32_t i = 0; i < 16; i++) {
+            secondaryIndices[i] = reader.read(mode.secondaryIndexBits - (i == 0 ? 1 : 0));
+        }
+    }
+
+    for (uint32_t i = 0; i < 16; i++) {
+        const uint32_t subset = bc7Subset(mode, partition, i);
+        const uint8_t* e0 = endpoints[subset * 2];
+        const uint8_t* e1 = endpoints[subset * 2 + 1];
+        uint8_t* texel = texels + i * 4;
+
+        if (mode.secondaryIndexBits) {
+            // mode 4 can swap which of its index sets is used for color and which for alpha
+            const bool swap = indexSelection != 0;
+            const uint32_t colorIndex = swap ? secondaryIndices[i] : indices[i];
+            const uint32_t colorIndexBits = swap ? mode.secondaryIndexBits : mode.indexBits;
+            const uint32_t alphaIndex = swap ? indices[i] : secondaryIndices[i];
+            const uint32_t alphaIndexBits = swap ? mode.indexBits : mode.secondaryIndexBits;
+
+            for (uint32_t channel = 0; channel < 3; channel++) {
+                texel[channel] = bc7Interpolate(e0[channel], e1[channel], colorIndex, colorIndexBits);
+            }
+
+            texel[3] = bc7Interpolate(e0[3], e1[3], alphaIndex, alphaIndexBits);
+        }
+        else {
+            for (uint32_t channel = 0; channel < 4; channel++) {
+                texel[channel] = bc7Interpolate(e0[channel], e1[channel], indices[i], mode.indexBits);
+            }
+        }
+
+        // rotation swaps alpha with one of the color channels
+        if (rotation > 0) {
+            std::swap(texel[3], texel[rotation - 1]);
+        }
+    }
+}
+
+void decompressBlock(VkFormat format, const uint8_t* block, uint8_t* texels) {
+    switch (format) {
+    case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+    case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+        decodeColorBlock(block, texels, false, false);
+        break;
+
+    case VK_FORMAT_BC1_RGBA_UNORM_BLOCK:
+    case VK_FORMAT_BC1_RGBA_SRGB_BLOCK:
+        decodeColorBlock(block, texels, false, true);
+        break;
+
+    case VK_FORMAT_BC3_UNORM_BLOCK:
+    case VK_FORMAT_BC3_SRGB_BLOCK:
+        decodeColorBlock(block + 8, texels, true, false);
+        decodeChannelBlock(block, texels, 3);
+        break;
+
+    case VK_FORMAT_BC4_UNORM_BLOCK:
+    case VK_FORMAT_BC5_UNORM_BLOCK:
+        for (uint32_t i = 0; i < 16; i++) {
+            texels[i * 4 + 1] = 0;
+            texels[i * 4 + 2] = 0;
+            texels[i * 4 + 3] = 255;
+        }
+
+        decodeChannelBlock(block, texels, 0);
+
+        if (format == VK_FORMAT_BC5_UNORM_BLOCK) {
+            decodeChannelBlock(block + 8, texels, 1);
+        }
+        break;
+
+    case VK_FORMAT_BC7_UNORM_BLOCK:
+    case VK_FORMAT_BC7_SRGB_BLOCK:
+        decodeBc7Block(block, texels);
+        break;
+
+    default:
+        throw std::runtime_error("texture format can not be decompressed on the CPU");
+    }
+}
+
+}
@@ -0,0 +1,439 @@
+#include "vkdev/texturestreamer.h"
+
+#include "vkdev/textureformat.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+namespace vkdev {
+
+void TextureStreamer::create(uint32_t framesInFlight_) {
+    framesInFlight = framesInFlight_;
+    frame = 1;
+}
+
+void TextureStreamer::cleanup() {
+    // nothing may still be copying into the images
+    uploadManager.flush();
+
+    for (auto& texture : textures) {
+        texture->tailImage->cleanup();
+
+        if (texture->detailImage) {
+            texture->detailImage->cleanup();
+        }
+
+        if (texture->pendingImage) {
+            texture->pendingImage->cleanup();
+        }
+    }
+
+    for (auto& retired : retiredImages) {
+        retired.image->cleanup();
+    }
+
+    textures.clear();
+    retiredImages.clear();
+    descriptorReplaceFrames.clear();
+    uploading = nullptr;
+    finishedUploads.clear();
+    residentSize = 0;
+    retiredSize = 0;
+}
+
+uint32_t TextureStreamer::add(TextureData&& data) {
+    auto texture = std::make_unique<StreamedTexture>();
+
+    if (!Texture::isFormatSupported(device, data.format)) {
+        if (!TextureFormat::canDecompress(data.format)) {
+            throw std::runtime_error("device does not support the texture's format");
+        }
+
+        texture->data = data.decompress();
+    }
+    else {
+        texture->data = std::move(data);
+    }
+
+    // every level must be available on the CPU to be streamed in
+    if (texture->data.generateMipmaps) {
+        texture->data.buildMipChain();
+    }
+
+    const TextureData& textureData = texture->data;
+    texture->levelCount = static_cast<uint32_t>(textureData.levels.size());
+    texture->tailLevel = texture->levelCount - 1;
+
+    for (uint32_t level = 0; level < texture->levelCount; level++) {
+        if (std::max(textureData.width >> level, 1U) <= tailSize && std::max(textureData.height >> level, 1U) <= tailSize) {
+            texture->tailLevel = level;
+            break;
+        }
+    }
+
+    texture->requestedLevel = texture->tailLevel;
+    texture->tailImage = createImage(*texture, texture->tailLevel, texture->levelCount);
+
+    // the tail is copied in full and is ready once the upload manager's current batch has completed
+    Image& tailImage = *texture->tailImage;
+    uploadManager.beginImageUpload(tailImage);
+
+    for (uint32_t level = texture->tailLevel; level < texture->levelCount; level++) {
+        const uint32_t mipLevel = level - texture->tailLevel;
+        uploadManager.uploadImageRows(textureData.getData() + textureData.levels[level].offset, textureData.levels[level].size, tailImage, mipLevel, 0, UploadManager::getBlockRowCount(tailImage, mipLevel));
+    }
+
+    uploadManager.finishImageUpload(tailImage, false);
+
+    residentSize += getLevelsSize(*texture, texture->tailLevel, texture->levelCount);
+    textures.push_back(std::move(texture));
+
+    return static_cast<uint32_t>(textures.size() - 1);
+}
+
+Image& TextureStreamer::getImage(uint32_t texture) {
+    StreamedTexture& streamedTexture = *textures.at(texture);
+    return streamedTexture.detailImage ? *streamedTexture.detailImage : *streamedTexture.tailImage;
+}
+
+void TextureStreamer::bind(uint32_t texture, Descriptor& descriptor, const std::string& uniformName) {
+    textures.at(texture)->bindings.push_back({ &descriptor, uniformName });
+
+    auto replaceFrame = std::find_if(descriptorReplaceFrames.begin(), descriptorReplaceFrames.end(), [&descriptor](const auto& entry) { return entry.first == &descriptor; });
+    if (replaceFrame == descriptorReplaceFrames.end()) {
+        descriptorReplaceFrames.emplace_back(&descriptor, 0);
+    }
+}
+
+void TextureStreamer::request(uint32_t texture, float screenPixels) {
+    StreamedTexture& streamedTexture = *textures.at(texture);
+
+    // the most detailed level needed is the smallest one with at least as many texels across as there are pixels
+    const float textureSize = static_cast<float>(std::max(streamedTexture.data.width, streamedTexture.data.height));
+    uint32_t level = 0;
+
+    if (screenPixels < textureSize) {
+        level = static_cast<uint32_t>(std::floor(std::log2(textureSize / std::max(screenPixels, 1.0f))));
+    }
+
+    level = std::min(level, streamedTexture.tailLevel);
+
+    if (streamedTexture.requestFrame == frame) {
+        streamedTexture.requestedLevel = std::min(streamedTexture.requestedLevel, level);
+    }
+    else {
+        streamedTexture.requestedLevel = level;
+        streamedTexture.requestFrame = frame;
+    }
+}
+
+uint32_t TextureStreamer::getResidentLevel(uint32_t texture) const {
+    return getResidentLevel(*textures.at(texture));
+}
+
+uint32_t TextureStreamer::getResidentLevel(const StreamedTexture& texture) {
+    return texture.detailImage ? texture.detailLevel : texture.tailLevel;
+}
+
+uint32_t TextureStreamer::getWantedLevel(const StreamedTexture& texture) const {
+    return texture.requestFrame == frame ? texture.requestedLevel : texture.tailLevel;
+}
+
+VkDeviceSize TextureStreamer::getLevelsSize(const StreamedTexture& texture, uint32_t firstLevel, uint32_t endLevel) {
+    VkDeviceSize size = 0;
+    for (uint32_t level = firstLevel; level < endLevel; level++) {
+        size += texture.data.levels[level].size;
+    }
+
+    return size;
+}
+
+VkDeviceSize TextureStreamer::getDetailSize(const StreamedTexture& texture, uint32_t firstLevel) {
+    return getLevelsSize(texture, firstLevel, texture.tailLevel);
+}
+
+std::unique_ptr<Image> TextureStreamer::createImage(const StreamedTexture& texture, uint32_t firstLevel, uint32_t endLevel) {
+    const TextureData& data = texture.data;
+
+    auto image = std::make_unique<Image>(device);
+    image->create(std::max(data.width >> firstLevel, 1U), std::max(data.height >> firstLevel, 1U), endLevel - firstLevel, VK_SAMPLE_COUNT_1_BIT, data.format,
+        VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, MemoryCategory::Texture);
+    image->createView(VK_IMAGE_ASPECT_COLOR_BIT);
+
+    return image;
+}
+
+bool TextureStreamer::canReplace(const StreamedTexture& texture) const {
+    for (const auto& binding : texture.bindings) {
+        for (const auto& replaceFrame : descriptorReplaceFrames) {
+            if (replaceFrame.first == binding.descriptor && replaceFrame.second == frame) {
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+// The replaced image may still be sampled by frames in flight.  The frame recorded after this update is the first one
+// which uses the new image, so the old one is safe to destroy once the fences of the following framesInFlight frames were waited on.
+void TextureStreamer::replaceDetailImage(StreamedTexture& texture, std::unique_ptr<Image> image, uint32_t level) {
+    const uint64_t retireFrame = frame + framesInFlight;
+
+    if (texture.detailImage) {
+        const VkDeviceSize size = getDetailSize(texture, texture.detailLevel);
+
+        // a trimmed texture's image was counted as retired when the trim began
+        if (!texture.trimming) {
+            residentSize -= size;
+            retiredSize += size;
+        }
+
+        retiredImages.push_back({ std::move(texture.detailImage), retireFrame, size });
+    }
+
+    texture.trimming = false;
+    texture.detailImage = std::move(image);
+    texture.detailLevel = level;
+
+    Image& current = texture.detailImage ? *texture.detailImage : *texture.tailImage;
+
+    for (const auto& binding : texture.bindings) {
+        binding.descriptor->replaceImage(binding.uniformName, current, retireFrame);
+
+        for (auto& replaceFrame : descriptorReplaceFrames) {
+            if (replaceFrame.first == binding.descriptor) {
+                replaceFrame.second = frame;
+            }
+        }
+    }
+}
+
+void TextureStreamer::releaseRetired() {
+    for (size_t i = 0; i < retiredImages.size();) {
+        if (retiredImages[i].retireFrame <= frame) {
+            retiredImages[i].image->cleanup();
+            retiredSize -= retiredImages[i].size;
+            retiredImages[i] = std::move(retiredImages.back());
+            retiredImages.pop_back();
+        }
+        else {
+            i++;
+        }
+    }
+
+    for (auto& replaceFrame : descriptorReplaceFrames) {
+        replaceFrame.first->releaseRetiredSets(frame);
+    }
+}
+
+void TextureStreamer::completeUploads() {
+    for (auto& texture : textures) {
+        if (texture->pendingImage && texture->batchId != 0 && canReplace(*texture) && uploadManager.isComplete(texture->batchId)) {
+            // the pending image was counted as resident when it was created
+            replaceDetailImage(*texture, std::move(texture->pendingImage), texture->pendingLevel);
+            texture->batchId = 0;
+        }
+    }
+}
+
+bool TextureStreamer::evict(const StreamedTexture* exclude) {
+    StreamedTexture* leastRecent = nullptr;
+
+    for (auto& texture : textures) {
+        if (texture.get() == exclude || !texture->detailImage || texture->pendingImage || !canReplace(*texture)) {
+            continue;
+        }
+
+        // textures are only evicted when they hold more levels than they need this frame
+        if (texture->detailLevel >= getWantedLevel(*texture)) {
+            continue;
+        }
+
+        if (!leastRecent || texture->requestFrame < leastRecent->requestFrame) {
+            leastRecent = texture.get();
+        }
+    }
+
+    if (!leastRecent) {
+        return false;
+    }
+
+    evictionCount++;
+
+    const uint32_t wantedLevel = getWantedLevel(*leastRecent);
+    const VkDeviceSize oldSize = getDetailSize(*leastRecent, leastRecent->detailLevel);
+    const VkDeviceSize newSize = getDetailSize(*leastRecent, wantedLevel);
+
+    // The tail is always resident, so a texture which is no longer requested drops back to it without copying anything.
+    // So does a texture whose trimmed image does not fit next to the retired images, which is streamed in again once it does.
+    if (wantedLevel == leastRecent->tailLevel || residentSize + retiredSize + newSize > memoryBudget) {
+        replaceDetailImage(*leastRecent, nullptr, 0);
+        return true;
+    }
+
+    // Otherwise the levels it still needs are copied into a smaller image on the GPU.  The old image is counted as retired
+    // right away since it is freed as soon as the new one is in use.
+    StreamedTexture& texture = *leastRecent;
+    texture.pendingImage = createImage(texture, wantedLevel, texture.tailLevel);
+    texture.pendingLevel = wantedLevel;
+    texture.copyLevel = wantedLevel;
+    texture.batchId = 0;
+    texture.trimming = true;
+
+    residentSize = residentSize - oldSize + newSize;
+    retiredSize += oldSize;
+
+    uploadManager.beginImageUpload(*texture.pendingImage);
+    finishImage(texture);
+    finishedUploads.push_back(&texture);
+
+    return true;
+}
+
+TextureStreamer::StreamedTexture* TextureStreamer::beginUpload() {
+    std::vector<StreamedTexture*> candidates;
+
+    for (auto& texture : textures) {
+        if (!texture->pendingImage && getWantedLevel(*texture) < getResidentLevel(*texture)) {
+            candidates.push_back(texture.get());
+        }
+    }
+
+    // only textures requested this frame want more levels, the ones missing the most detail go first
+    std::stable_sort(candidates.begin(), candidates.end(), [this](const StreamedTexture* a, const StreamedTexture* b) {
+        return getResidentLevel(*a) - getWantedLevel(*a) > getResidentLevel(*b) - getWantedLevel(*b);
+    });
+
+    for (StreamedTexture* texture : candidates) {
+        const uint32_t residentLevel = getResidentLevel(*texture);
+        uint32_t level = getWantedLevel(*texture);
+
+        while (residentSize + getDetailSize(*texture, level) > memoryBudget && evict(texture)) {}
+
+        // when the budget can not be met the texture is given as many levels as fit
+        while (level < residentLevel && residentSize + getDetailSize(*texture, level) > memoryBudget) {
+            level++;
+        }
+
+        if (level == residentLevel) {
+            continue;
+        }
+
+        // replaced images are only freed once the frames in flight using them have completed, so the upload waits for them
+        if (residentSize + retiredSize + getDetailSize(*texture, level) > memoryBudget) {
+            return nullptr;
+        }
+
+        texture->pendingImage = createImage(*texture, level, texture->tailLevel);
+        texture->pendingLevel = level;
+        texture->copyLevel = residentLevel;
+        texture->uploadLevel = residentLevel - 1;
+        texture->uploadBlockRow = 0;
+        texture->batchId = 0;
+        residentSize += getDetailSize(*texture, level);
+
+        uploadManager.beginImageUpload(*texture->pendingImage);
+
+        return texture;
+    }
+
+    return nullptr;
+}
+
+void TextureStreamer::finishImage(StreamedTexture& texture) {
+    Image& image = *texture.pendingImage;
+
+    if (texture.copyLevel < texture.tailLevel) {
+        uploadManager.finishImageUpload(image, *texture.detailImage, texture.copyLevel - texture.detailLevel, texture.copyLevel - texture.pendingLevel, texture.tailLevel - texture.copyLevel);
+    }
+    else {
+        uploadManager.finishImageUpload(image, false);
+    }
+}
+
+// Levels are staged from the smallest up, so the final rows recorded belong to the most detailed level
+bool TextureStreamer::uploadRows(StreamedTexture& texture, VkDeviceSize& frameUploadBytes) {
+    Image& image = *texture.pendingImage;
+    const TextureData& data = texture.data;
+
+    while (true) {
+        const uint32_t mipLevel = texture.uploadLevel - texture.pendingLevel;
+        const ImageLevel& level = data.levels[texture.uploadLevel];
+        const uint32_t blockRows = UploadManager::getBlockRowCount(image, mipLevel);
+        const VkDeviceSize rowPitch = level.size / blockRows;
+
+        const VkDeviceSize remainingBytes = uploadBytesPerFrame > frameUploadBytes ? uploadBytesPerFrame - frameUploadBytes : 0;
+        uint32_t rowCount = static_cast<uint32_t>(std::min(remainingBytes / rowPitch, static_cast<VkDeviceSize>(blockRows - texture.uploadBlockRow)));
+
+        if (rowCount == 0) {
+            if (frameUploadBytes > 0) {
+                return false;
+            }
+
+            rowCount = 1;
+        }
+
+        uploadManager.uploadImageRows(data.getData() + level.offset, level.size, image, mipLevel, texture.uploadBlockRow, rowCount);
+        frameUploadBytes += rowPitch * rowCount;
+        texture.uploadBlockRow += rowCount;
+
+        if (texture.uploadBlockRow < blockRows) {
+            continue;
+        }
+
+        if (texture.uploadLevel == texture.pendingLevel) {
+            finishImage(texture);
+            return true;
+        }
+
+        texture.uploadLevel--;
+        texture.uploadBlockRow = 0;
+    }
+}
+
+void TextureStreamer::update() {
+    releaseRetired();
+    completeUploads();
+
+    // requests may have dropped or the budget may have changed
+    while (residentSize > memoryBudget && evict(nullptr)) {}
+
+    VkDeviceSize frameUploadBytes = 0;
+
+    while (frameUploadBytes < uploadBytesPerFrame) {
+        if (!uploading) {
+            uploading = beginUpload();
+
+            if (!uploading) {
+                break;
+            }
+        }
+
+        if (!uploadRows(*uploading, frameUploadBytes)) {
+            break;
+        }
+
+        finishedUploads.push_back(uploading);
+        uploading = nullptr;
+    }
+
+    // trims only record copies, so they may need a submission of their own
+    if (frameUploadBytes > 0 || !finishedUploads.empty()) {
+        const uint64_t batchId = uploadManager.submit();
+
+        for (StreamedTexture* texture : finishedUploads) {
+            texture->batchId = batchId;
+        }
+
+        finishedUploads.clear();
+    }
+
+    totalUploadBytes += frameUploadBytes;
+    maxFrameUploadBytes = std::max(maxFrameUploadBytes, frameUploadBytes);
+
+    frame++;
+}
+
+}
@@ -0,0 +1,62 @@
+#include "vkdev/uniformarena.h"
+
+#include <stdexcept>
+
+namespace vkdev {
+
+static inline VkDeviceSize alignUp(VkDeviceSize value, VkDeviceSize alignment) {
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+void UniformArena::create(uint32_t frameCount, VkDeviceSize frameCapacity_) {
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(device.physical, &properties);
+
+    alignment = properties.limits.minUniformBufferOffsetAlignment;
+    frameCapacity = alignUp(frameCapacity_, alignment);
+
+    frameOffsets.resize(frameCount);
+    frameUsed.assign(frameCount, 0);
+
+    for (uint32_t i = 0; i < frameCount; i++) {
+        frameOffsets[i] = frameCapacity * i;
+    }
+
+    // CPU_TO_GPU requires host visible memory and prefers memory which is also device local
+    buffer.createMapped(frameCapacity * frameCount, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VmaMemoryUsage::VMA_MEMORY_USAGE_CPU_TO_GPU, MemoryCategory::Uniform);
+}
+
+void UniformArena::cleanup() {
+    buffer.cleanup();
+
+    frameOffsets.clear();
+    frameUsed.clear();
+}
+
+UniformArena::Allocation UniformArena::allocate(uint32_t frameIndex, VkDeviceSize size) {
+    const VkDeviceSize offset = alignUp(frameUsed[frameIndex], alignment);
+
+    if (offset + size > frameCapacity) {
+        throw std::runtime_error("uniform arena frame capacity exceeded");
+    }
+
+    frameUsed[frameIndex] = offset + size;
+
+    Allocation allocation;
+    allocation.offset = static_cast<uint32_t>(frameOffsets[frameIndex] + offset);
+    allocation.data = static_cast<uint8_t*>(buffer.mapped) + allocation.offset;
+
+    return allocation;
+}
+
+void UniformArena::reset(uint32_t frameIndex) {
+    frameUsed[frameIndex] = 0;
+}
+
+void UniformArena::flush(uint32_t frameIndex) {
+    if (frameUsed[frameIndex] > 0) {
+        vmaFlushAllocation(device.allocator, buffer.allocation, frameOffsets[frameIndex], frameUsed[frameIndex]);
+    }
+}
+
+}
@@ -0,0 +1,476 @@
+#include "vkdev/uploadmanager.h"
+
+#include "vkdev/querypool.h"
+#include "vkdev/textureformat.h"
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+
+namespace vkdev {
+
+void UploadManager::create(VkDeviceSize stagingCapacity) {
+    transferPool.create();
+    graphicsPool.create();
+    stagingRing.create(stagingCapacity);
+}
+
+void UploadManager::cleanup() {
+    flush();
+
+    stagingRing.cleanup();
+    transferPool.cleanup();
+    graphicsPool.cleanup();
+}
+
+VkCommandBuffer UploadManager::allocateCommandBuffer(CommandPool& commandPool) {
+    VkCommandBufferAllocateInfo allocInfo = {};
+    allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    allocInfo.commandPool = commandPool.handle;
+    allocInfo.commandBufferCount = 1;
+
+    VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+    if (vkAllocateCommandBuffers(device.logical, &allocInfo, &commandBuffer) != VK_SUCCESS) {
+        throw std::runtime_error("failed to allocate upload command buffer");
+    }
+
+    VkCommandBufferBeginInfo beginInfo = {};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+    vkBeginCommandBuffer(commandBuffer, &beginInfo);
+
+    return commandBuffer;
+}
+
+UploadManager::Batch& UploadManager::getRecordingBatch() {
+    if (recording) {
+        return *recording;
+    }
+
+    recording = std::make_unique<Batch>();
+    recording->id = nextBatchId++;
+    recording->transferCommands = allocateCommandBuffer(transferPool);
+
+    if (device.hasDedicatedTransferQueue()) {
+        recording->graphicsCommands = allocateCommandBuffer(graphicsPool);
+    }
+
+    // Only one batch is timed at a time since they share a single query slot.
+    // Both timestamps are written on the graphics queue so that they are comparable, which means for a dedicated transfer queue
+    // the begin timestamp is written by a separate command buffer submitted ahead of the transfer.
+    bool timingInProgress = false;
+    for (const auto& batch : pending) {
+        timingInProgress = timingInProgress || batch.timed;
+    }
+
+    if (timestamps && timestamps->isSupported() && !timingInProgress) {
+        recording->timed = true;
+
+        if (device.hasDedicatedTransferQueue()) {
+            recording->timingCommands = allocateCommandBuffer(graphicsPool);
+            timestamps->beginUpload(recording->timingCommands);
+        }
+        else {
+            timestamps->beginUpload(recording->transferCommands);
+        }
+    }
+
+    return *recording;
+}
+
+VkCommandBuffer UploadManager::ownershipCommands(Batch& batch) const {
+    return batch.graphicsCommands != VK_NULL_HANDLE ? batch.graphicsCommands : batch.transferCommands;
+}
+
+// offsets in the staging buffer must be a multiple of the texel or block size for buffer to image copies.  16 covers every
+// uncompressed format as well as BC and ASTC blocks
+static const VkDeviceSize STAGING_ALIGNMENT = 16;
+
+StagingRing::Allocation UploadManager::allocateStaging(VkDeviceSize size) {
+    StagingRing::Allocation allocation;
+
+    while (!stagingRing.allocate(size, STAGING_ALIGNMENT, allocation)) {
+        if (stagingRing.isEmpty()) {
+            throw std::runtime_error("staging allocation is larger than the staging ring");
+        }
+
+        // the ring is full.  The current batch owns some of it, so it must be submitted before it can be reclaimed.
+        if (pending.empty()) {
+            submit();
+        }
+
+        wait(pending.front().id);
+    }
+
+    return allocation;
+}
+
+void UploadManager::uploadBuffer(const void* data, VkDeviceSize size, Buffer& dst, VkAccessFlags dstAccess, VkPipelineStageFlags dstStage, VkDeviceSize dstOffset) {
+    const uint8_t* source = static_cast<const uint8_t*>(data);
+
+    for (VkDeviceSize chunkOffset = 0; chunkOffset < size; chunkOffset += getMaxChunkSize()) {
+        const VkDeviceSize chunkSize = std::min(getMaxChunkSize(), size - chunkOffset);
+
+        // allocating may submit the current batch, so the batch is retrieved afterwards
+        StagingRing::Allocation staging = allocateStaging(chunkSize);
+        memcpy(staging.data, source + chunkOffset, static_cast<size_t>(chunkSize));
+
+        Batch& batch = getRecordingBatch();
+
+        VkBufferCopy regionToCopy = {};
+        regionToCopy.srcOffset = staging.offset;
+        regionToCopy.dstOffset = dstOffset + chunkOffset;
+        regionToCopy.size = chunkSize;
+        vkCmdCopyBuffer(batch.transferCommands, stagingRing.buffer.buffer, dst.buffer, 1, &regionToCopy);
+
+        VkBufferMemoryBarrier barrier = {};
+        barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+        barrier.buffer = dst.buffer;
+        barrier.offset = regionToCopy.dstOffset;
+        barrier.size = chunkSize;
+        barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.dstAccessMask = dstAccess;
+        barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+
+        if (device.hasDedicatedTransferQueue()) {
+            // the release and acquire barriers must describe the same transfer of ownership
+            barrier.srcQueueFamilyIndex = device.transferQueue.index;
+            barrier.dstQueueFamilyIndex = device.graphicsQueue.index;
+
+            vkCmdPipelineBarrier(batch.transferCommands, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 0, nullptr, 1, &barrier, 0, nullptr);
+            vkCmdPipelineBarrier(batch.graphicsCommands, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, dstStage, 0, 0, nullptr, 1, &barrier, 0, nullptr);
+        }
+        else {
+            vkCmdPipelineBarrier(batch.transferCommands, VK_PIPELINE_STAGE_TRANSFER_BIT, dstStage, 0, 0, nullptr, 1, &barrier, 0, nullptr);
+        }
+    }
+}
+
+// Large images are copied a group of rows at a time.  If the copy spans several batches the ownership transfer and
+// mipmap generation are recorded in the batch containing the final rows, which is submitted after all of the others.
+void UploadManager::uploadImage(const void* data, VkDeviceSize size, Image& dst, bool generateMipmaps) {
+    beginImageUpload(dst);
+    recordImageLevel(static_cast<const uint8_t*>(data), size, dst, 0, 0, getBlockRowCount(dst, 0));
+    finishImageUpload(dst, generateMipmaps);
+}
+
+void UploadManager::uploadImageLevels(const void* data, const std::vector<ImageLevel>& levels, Image& dst) {
+    const uint8_t* source = static_cast<const uint8_t*>(data);
+
+    if (levels.size() != dst.mipLevels) {
+        throw std::runtime_error("image upload does not provide every mip level");
+    }
+
+    beginImageUpload(dst);
+
+    for (uint32_t level = 0; level < dst.mipLevels; level++) {
+        recordImageLevel(source + levels[level].offset, levels[level].size, dst, level, 0, getBlockRowCount(dst, level));
+    }
+
+    finishImageUpload(dst, false);
+}
+
+// the transition covers every mip level, so it is recorded ahead of the first copy
+void UploadManager::beginImageUpload(Image& dst) {
+    Batch& batch = getRecordingBatch();
+    dst.transitionLayout(batch.transferCommands, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+}
+
+void UploadManager::uploadImageRows(const void* levelData, VkDeviceSize levelSize, Image& dst, uint32_t mipLevel, uint32_t firstBlockRow, uint32_t blockRowCount) {
+    if (firstBlockRow + blockRowCount > getBlockRowCount(dst, mipLevel)) {
+        throw std::runtime_error("image upload rows are outside of the mip level");
+    }
+
+    recordImageLevel(static_cast<const uint8_t*>(levelData), levelSize, dst, mipLevel, firstBlockRow, blockRowCount);
+}
+
+uint32_t UploadManager::getBlockRowCount(const Image& image, uint32_t mipLevel) {
+    const uint32_t levelHeight = std::max(image.height >> mipLevel, 1U);
+    const uint32_t blockHeight = TextureFormat::getBlockExtent(image.format).height;
+
+    return (levelHeight + blockHeight - 1) / blockHeight;
+}
+
+// Block compressed images are copied a row of blocks at a time, since a copy may not start part way through a block
+void UploadManager::recordImageLevel(const uint8_t* source, VkDeviceSize size, Image& dst, uint32_t mipLevel, uint32_t firstBlockRow, uint32_t blockRowCount) {
+    const uint32_t levelHeight = std::max(dst.height >> mipLevel, 1U);
+    const uint32_t blockHeight = TextureFormat::getBlockExtent(dst.format).height;
+
+    const VkDeviceSize rowPitch = size / getBlockRowCount(dst, mipLevel);
+    const uint32_t blockRowsPerChunk = static_cast<uint32_t>(std::max(getMaxChunkSize() / rowPitch, VkDeviceSize(1)));
+
+    if (rowPitch > getMaxChunkSize()) {
+        throw std::runtime_error("image row is larger than the staging chunk size");
+    }
+
+    const uint32_t lastBlockRow = firstBlockRow + blockRowCount;
+
+    for (uint32_t blockRow = firstBlockRow; blockRow < lastBlockRow; blockRow += blockRowsPerChunk) {
+        const uint32_t chunkBlockRows = std::min(blockRowsPerChunk, lastBlockRow - blockRow);
+        const VkDeviceSize chunkSize = rowPitch * chunkBlockRows;
+
+        StagingRing::Allocation staging = allocateStaging(chunkSize);
+        memcpy(staging.data, source + rowPitch * blockRow, static_cast<size_t>(chunkSize));
+
+        Batch& batch = getRecordingBatch();
+
+        // the final block row may extend past the edge of the image
+        const uint32_t firstRow = blockRow * blockHeight;
+        const uint32_t rowCount = std::min(chunkBlockRows * blockHeight, levelHeight - firstRow);
+
+        dst.loadBufferRows(batch.transferCommands, stagingRing.buffer, staging.offset, firstRow, rowCount, mipLevel);
+    }
+}
+
+void UploadManager::acquireImage(Batch& batch, Image& dst) {
+    if (device.hasDedicatedTransferQueue()) {
+        // the image stays in transfer destination layout while ownership moves to the graphics queue
+        VkImageMemoryBarrier barrier = {};
+        barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+        barrier.image = dst.handle;
+        barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+        barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+        barrier.srcQueueFamilyIndex = device.transferQueue.index;
+        barrier.dstQueueFamilyIndex = device.graphicsQueue.index;
+        barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        barrier.subresourceRange.baseMipLevel = 0;
+        barrier.subresourceRange.levelCount = dst.mipLevels;
+        barrier.subresourceRange.baseArrayLayer = 0;
+        barrier.subresourceRange.layerCount = 1;
+        barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.dstAccessMask = 0;
+
+        vkCmdPipelineBarrier(batch.transferCommands, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+        barrier.srcAccessMask = 0;
+        barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT | VK_ACCESS_TRANSFER_WRITE_BIT;
+
+        vkCmdPipelineBarrier(batch.graphicsCommands, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+    }
+}
+
+void UploadManager::finishImageUpload(Image& dst, bool generateMipmaps) {
+    Batch& batch = getRecordingBatch();
+    acquireImage(batch, dst);
+
+    if (generateMipmaps && dst.mipLevels > 1) {
+        // note that this function will transition all mipmap levels to optimal read format.
+        dst.generateMipmaps(ownershipCommands(batch));
+    }
+    else {
+        dst.transitionLayout(ownershipCommands(batch), VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+    }
+}
+
+// Earlier frames may be sampling src, so its transition to a transfer source waits for the fragment shader.  Reads do not
+// need to be made available, so only the execution dependency is required in either direction.
+void UploadManager::finishImageUpload(Image& dst, Image& src, uint32_t srcMipLevel, uint32_t dstMipLevel, uint32_t levelCount) {
+    if (srcMipLevel + levelCount > src.mipLevels || dstMipLevel + levelCount > dst.mipLevels) {
+        throw std::runtime_error("image copy levels are outside of the image");
+    }
+
+    Batch& batch = getRecordingBatch();
+    acquireImage(batch, dst);
+
+    VkCommandBuffer commandBuffer = ownershipCommands(batch);
+
+    VkImageMemoryBarrier barrier = {};
+    barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    barrier.image = src.handle;
+    barrier.oldLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    barrier.subresourceRange.baseMipLevel = srcMipLevel;
+    barrier.subresourceRange.levelCount = levelCount;
+    barrier.subresourceRange.baseArrayLayer = 0;
+    barrier.subresourceRange.layerCount = 1;
+    barrier.srcAccessMask = 0;
+    barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+    std::vector<VkImageCopy> regions(levelCount);
+    for (uint32_t i = 0; i < levelCount; i++) {
+        VkImageCopy& region = regions[i];
+        region.srcSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        region.srcSubresource.mipLevel = srcMipLevel + i;
+        region.srcSubresource.baseArrayLayer = 0;
+        region.srcSubresource.layerCount = 1;
+        region.srcOffset = { 0, 0, 0 };
+        region.dstSubresource = region.srcSubresource;
+        region.dstSubresource.mipLevel = dstMipLevel + i;
+        region.dstOffset = { 0, 0, 0 };
+        region.extent = { std::max(src.width >> (srcMipLevel + i), 1U), std::max(src.height >> (srcMipLevel + i), 1U), 1 };
+    }
+
+    vkCmdCopyImage(commandBuffer, src.handle, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, dst.handle, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, levelCount, regions.data());
+
+    barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+    barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    barrier.srcAccessMask = 0;
+    barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+    // covers the copy as well as the rows copied from staging memory
+    dst.transitionLayout(commandBuffer, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+}
+
+uint64_t UploadManager::submit() {
+    if (!recording) {
+        return nextBatchId - 1;
+    }
+
+    Batch batch = std::move(*recording);
+    recording.reset();
+
+    if (batch.timed) {
+        timestamps->endUpload(ownershipCommands(batch));
+    }
+
+    stagingRing.retire(batch.id);
+
+    vkEndCommandBuffer(batch.transferCommands);
+
+    if (batch.graphicsCommands != VK_NULL_HANDLE) {
+        vkEndCommandBuffer(batch.graphicsCommands);
+    }
+
+    if (batch.timingCommands != VK_NULL_HANDLE) {
+        vkEndCommandBuffer(batch.timingCommands);
+
+        VkSubmitInfo timingSubmitInfo = {};
+        timingSubmitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+        timingSubmitInfo.commandBufferCount = 1;
+        timingSubmitInfo.pCommandBuffers = &batch.timingCommands;
+
+        if (vkQueueSubmit(device.graphicsQueue.handle, 1, &timingSubmitInfo, VK_NULL_HANDLE) != VK_SUCCESS) {
+            throw std::runtime_error("failed to submit upload timing commands");
+        }
+    }
+
+    VkFenceCreateInfo fenceInfo = {};
+    fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+
+    if (vkCreateFence(device.logical, &fenceInfo, nullptr, &batch.fence) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create upload fence");
+    }
+
+    VkSubmitInfo transferSubmitInfo = {};
+    transferSubmitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    transferSubmitInfo.commandBufferCount = 1;
+    transferSubmitInfo.pCommandBuffers = &batch.transferCommands;
+
+    if (device.hasDedicatedTransferQueue()) {
+        VkSemaphoreCreateInfo semaphoreInfo = {};
+        semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+
+        if (vkCreateSemaphore(device.logical, &semaphoreInfo, nullptr, &batch.transferComplete) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create upload semaphore");
+        }
+
+        transferSubmitInfo.signalSemaphoreCount = 1;
+        transferSubmitInfo.pSignalSemaphores = &batch.transferComplete;
+
+        if (vkQueueSubmit(device.transferQueue.handle, 1, &transferSubmitInfo, VK_NULL_HANDLE) != VK_SUCCESS) {
+            throw std::runtime_error("failed to submit upload to transfer queue");
+        }
+
+        // the graphics queue acquires ownership of the uploaded resources once the transfer queue has finished with them
+        const VkPipelineStageFlags waitStage = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+
+        VkSubmitInfo graphicsSubmitInfo = {};
+        graphicsSubmitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+        graphicsSubmitInfo.waitSemaphoreCount = 1;
+        graphicsSubmitInfo.pWaitSemaphores = &batch.transferComplete;
+        graphicsSubmitInfo.pWaitDstStageMask = &waitStage;
+        graphicsSubmitInfo.commandBufferCount = 1;
+        graphicsSubmitInfo.pCommandBuffers = &batch.graphicsCommands;
+
+        if (vkQueueSubmit(device.graphicsQueue.handle, 1, &graphicsSubmitInfo, batch.fence) != VK_SUCCESS) {
+            throw std::runtime_error("failed to submit upload ownership transfer to graphics queue");
+        }
+    }
+    else {
+        if (vkQueueSubmit(device.transferQueue.handle, 1, &transferSubmitInfo, batch.fence) != VK_SUCCESS) {
+            throw std::runtime_error("failed to submit upload");
+        }
+    }
+
+    const uint64_t batchId = batch.id;
+    pending.push_back(std::move(batch));
+
+    return batchId;
+}
+
+void UploadManager::releaseBatch(Batch& batch) {
+    if (batch.timed) {
+        timestamps->collectUpload();
+    }
+
+    stagingRing.release(batch.id);
+
+    vkFreeCommandBuffers(device.logical, transferPool.handle, 1, &batch.transferCommands);
+
+    if (batch.graphicsCommands != VK_NULL_HANDLE) {
+        vkFreeCommandBuffers(device.logical, graphicsPool.handle, 1, &batch.graphicsCommands);
+    }
+
+    if (batch.timingCommands != VK_NULL_HANDLE) {
+        vkFreeCommandBuffers(device.logical, graphicsPool.handle, 1, &batch.timingCommands);
+    }
+
+    if (batch.transferComplete != VK_NULL_HANDLE) {
+        vkDestroySemaphore(device.logical, batch.transferComplete, nullptr);
+    }
+
+    vkDestroyFence(device.logical, batch.fence, nullptr);
+
+    completedBatchId = batch.id;
+}
+
+// batches are submitted to the same queue in order, so they are reclaimed in order as well
+void UploadManager::reclaim(bool waitForAll) {
+    while (!pending.empty()) {
+        Batch& batch = pending.front();
+
+        if (waitForAll) {
+            vkWaitForFences(device.logical, 1, &batch.fence, VK_TRUE, std::numeric_limits<uint64_t>::max());
+        }
+        else if (vkGetFenceStatus(device.logical, batch.fence) != VK_SUCCESS) {
+            break;
+        }
+
+        releaseBatch(batch);
+        pending.pop_front();
+    }
+}
+
+bool UploadManager::isComplete(uint64_t batchId) {
+    if (batchId > completedBatchId) {
+        reclaim(false);
+    }
+
+    return batchId <= completedBatchId;
+}
+
+void UploadManager::wait(uint64_t batchId) {
+    while (!pending.empty() && completedBatchId < batchId) {
+        Batch& batch = pending.front();
+        vkWaitForFences(device.logical, 1, &batch.fence, VK_TRUE, std::numeric_limits<uint64_t>::max());
+        reclaim(false);
+    }
+}
+
+void UploadManager::flush() {
+    submit();
+    reclaim(true);
+}
+
+}
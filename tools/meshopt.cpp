@@ -0,0 +1,677 @@
+#include "vkdev/mesh.h"
+#include "vkdev/meshpack.h"
+
+#include <meshoptimizer.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+struct ToolOptions {
+    std::string inputPath;
+    std::string outputPath;
+    float overdrawThreshold = 1.05f;
+    uint32_t cacheSize = 16;
+    bool compress = true;
+    bool quantize = true;
+    uint32_t lodCount = 4;
+    float lodRatio = 0.5f;
+    float lodError = 0.01f;
+};
+
+// uncompressed vertex data with 32 bit indices which is operated on by the optimization passes
+struct WorkingMesh {
+    vkdev::MeshVertexAttributes vertexAttributes = vkdev::MeshVertexAttributes::Unset;
+    uint32_t vertexSize = 0;
+    uint32_t vertexCount = 0;
+    std::vector<uint8_t> vertices;
+    std::vector<uint32_t> indices;
+    uint32_t elementSize = sizeof(uint32_t);
+    vkdev::Bounds bounds;
+    float lodError = 0.0f;
+
+    // positions are always the first attribute when present
+    inline const float* positions() const {
+        return (vertexAttributes & vkdev::MeshVertexAttributes::Positions) ? reinterpret_cast<const float*>(vertices.data()) : nullptr;
+    }
+};
+
+inline bool isQuantized(const WorkingMesh& mesh) {
+    return (mesh.vertexAttributes & (vkdev::MeshVertexAttributes::QuantizedPositions | vkdev::MeshVertexAttributes::QuantizedNormals | vkdev::MeshVertexAttributes::QuantizedTexCoords)) != 0;
+}
+
+struct MeshStatistics {
+    uint32_t vertexCount = 0;
+    uint32_t triangleCount = 0;
+    float acmr = 0.0f;
+    float atvr = 0.0f;
+    float overdraw = 0.0f;
+    float overfetch = 0.0f;
+};
+
+bool hasExtension(const std::string& path, const std::string& extension) {
+    return path.size() >= extension.size() && path.compare(path.size() - extension.size(), extension.size(), extension) == 0;
+}
+
+std::string getStem(const std::string& path) {
+    const size_t slash = path.find_last_of("/\\");
+    const size_t start = slash == std::string::npos ? 0 : slash + 1;
+    const size_t dot = path.find_last_of('.');
+
+    return path.substr(start, dot == std::string::npos || dot < start ? std::string::npos : dot - start);
+}
+
+WorkingMesh loadModel(const std::string& path) {
+    vkdev::MeshData meshData;
+    meshData.loadFromFile(path);
+
+    if (meshData.vertexCount == 0 || meshData.vertexDataSize % meshData.vertexCount != 0) {
+        throw std::runtime_error("Vertex data size is not a multiple of the vertex count: " + path);
+    }
+
+    WorkingMesh mesh;
+    mesh.vertexAttributes = meshData.vertexAttributes;
+
+    // the optimization passes read positions, normals and texture coordinates as floats
+    if (isQuantized(mesh)) {
+        throw std::runtime_error("Input is already quantized: " + path);
+    }
+
+    mesh.vertexCount = meshData.vertexCount;
+    mesh.vertexSize = meshData.vertexDataSize / meshData.vertexCount;
+    mesh.vertices.assign(meshData.vertexData, meshData.vertexData + meshData.vertexDataSize);
+    mesh.elementSize = meshData.elementSize;
+    mesh.bounds = meshData.bounds;
+
+    mesh.indices.resize(meshData.elementCount);
+    if (meshData.elementSize == sizeof(uint16_t)) {
+        const uint16_t* source = reinterpret_cast<const uint16_t*>(meshData.elementData);
+        std::copy(source, source + meshData.elementCount, mesh.indices.begin());
+    }
+    else {
+        std::memcpy(mesh.indices.data(), meshData.elementData, meshData.elementDataSize);
+    }
+
+    return mesh;
+}
+
+/*
+Reads the positions, normals and texture coordinates of a Wavefront OBJ file.  Polygons are triangulated as fans.
+Every face corner becomes its own vertex, identical vertices are merged by the weld pass.
+*/
+WorkingMesh loadObj(const std::string& path) {
+    std::ifstream file(path);
+
+    if (!file) {
+        throw std::runtime_error("Unable to load file: " + path);
+    }
+
+    std::vector<glm::vec3> positions;
+    std::vector<glm::vec3> normals;
+    std::vector<glm::vec2> texCoords;
+
+    struct Corner {
+        int position = 0;
+        int texCoord = 0;
+        int normal = 0;
+    };
+
+    std::vector<Corner> corners;
+
+    // OBJ indices are one based and negative values are relative to the end of the list
+    auto resolveIndex = [](int index, size_t count) {
+        return index < 0 ? static_cast<int>(count) + index + 1 : index;
+    };
+
+    std::string line;
+    while (std::getline(file, line)) {
+        std::istringstream stream(line);
+        std::string type;
+        stream >> type;
+
+        if (type == "v") {
+            glm::vec3 position;
+            stream >> position.x >> position.y >> position.z;
+            positions.push_back(position);
+        }
+        else if (type == "vn") {
+            glm::vec3 normal;
+            stream >> normal.x >> normal.y >> normal.z;
+            normals.push_back(normal);
+        }
+        else if (type == "vt") {
+            glm::vec2 texCoord;
+            stream >> texCoord.x >> texCoord.y;
+            texCoords.push_back(texCoord);
+        }
+        else if (type == "f") {
+            std::vector<Corner> face;
+            std::string token;
+
+            while (stream >> token) {
+                Corner corner;
+                int* fields[3] = { &corner.position, &corner.texCoord, &corner.normal };
+                size_t field = 0;
+                size_t start = 0;
+
+                while (field < 3 && start <= token.size()) {
+                    const size_t end = std::min(token.find('/', start), token.size());
+                    if (end > start) {
+                        *fields[field] = std::atoi(token.substr(start, end - start).c_str());
+                    }
+                    field += 1;
+                    start = end + 1;
+                }
+
+                corner.position = resolveIndex(corner.position, positions.size());
+                corner.texCoord = resolveIndex(corner.texCoord, texCoords.size());
+                corner.normal = resolveIndex(corner.normal, normals.size());
+                face.push_back(corner);
+            }
+
+            for (size_t i = 2; i < face.size(); i++) {
+                corners.push_back(face[0]);
+                corners.push_back(face[i - 1]);
+                corners.push_back(face[i]);
+            }
+        }
+    }
+
+    if (corners.empty()) {
+        throw std::runtime_error("No faces found in file: " + path);
+    }
+
+    // attributes are only written if every face corner references one
+    const bool hasNormals = std::all_of(corners.begin(), corners.end(), [](const Corner& c) { return c.normal != 0; });
+    const bool hasTexCoords = std::all_of(corners.begin(), corners.end(), [](const Corner& c) { return c.texCoord != 0; });
+
+    WorkingMesh mesh;
+    uint32_t attributes = vkdev::MeshVertexAttributes::Positions;
+    mesh.vertexSize = 3 * sizeof(float);
+
+    if (hasNormals) {
+        attributes |= vkdev::MeshVertexAttributes::Normals;
+        mesh.vertexSize += 3 * sizeof(float);
+    }
+
+    if (hasTexCoords) {
+        attributes |= vkdev::MeshVertexAttributes::TexCoords;
+        mesh.vertexSize += 2 * sizeof(float);
+    }
+
+    mesh.vertexAttributes = static_cast<vkdev::MeshVertexAttributes>(attributes);
+    mesh.vertexCount = static_cast<uint32_t>(corners.size());
+    mesh.vertices.resize(static_cast<size_t>(mesh.vertexCount) * mesh.vertexSize);
+    mesh.indices.resize(corners.size());
+
+    mesh.bounds.min = glm::vec3(std::numeric_limits<float>::max());
+    mesh.bounds.max = glm::vec3(std::numeric_limits<float>::lowest());
+
+    for (size_t i = 0; i < corners.size(); i++) {
+        const Corner& corner = corners[i];
+        float* vertex = reinterpret_cast<float*>(mesh.vertices.data() + i * mesh.vertexSize);
+
+        auto outOfRange = [](int index, size_t count) {
+            return index < 1 || static_cast<size_t>(index) > count;
+        };
+
+        if (outOfRange(corner.position, positions.size()) ||
+            (hasNormals && outOfRange(corner.normal, normals.size())) ||
+            (hasTexCoords && outOfRange(corner.texCoord, texCoords.size()))) {
+            throw std::runtime_error("Face index out of range in file: " + path);
+        }
+
+        const glm::vec3& position = positions[corner.position - 1];
+        *vertex++ = position.x;
+        *vertex++ = position.y;
+        *vertex++ = position.z;
+
+        mesh.bounds.min = glm::min(mesh.bounds.min, position);
+        mesh.bounds.max = glm::max(mesh.bounds.max, position);
+
+        if (hasNormals) {
+            const glm::vec3& normal = normals[corner.normal - 1];
+            *vertex++ = normal.x;
+            *vertex++ = normal.y;
+            *vertex++ = normal.z;
+        }
+
+        // OBJ places the texture origin at the bottom left while Vulkan samples from the top left
+        if (hasTexCoords) {
+            const glm::vec2& texCoord = texCoords[corner.texCoord - 1];
+            *vertex++ = texCoord.x;
+            *vertex++ = 1.0f - texCoord.y;
+        }
+
+        mesh.indices[i] = static_cast<uint32_t>(i);
+    }
+
+    return mesh;
+}
+
+MeshStatistics analyze(const WorkingMesh& mesh, const ToolOptions& options) {
+    MeshStatistics statistics;
+    statistics.vertexCount = mesh.vertexCount;
+    statistics.triangleCount = static_cast<uint32_t>(mesh.indices.size() / 3);
+
+    const meshopt_VertexCacheStatistics cache = meshopt_analyzeVertexCache(mesh.indices.data(), mesh.indices.size(), mesh.vertexCount, options.cacheSize, 0, 0);
+    statistics.acmr = cache.acmr;
+    statistics.atvr = cache.atvr;
+
+    const meshopt_VertexFetchStatistics fetch = meshopt_analyzeVertexFetch(mesh.indices.data(), mesh.indices.size(), mesh.vertexCount, mesh.vertexSize);
+    statistics.overfetch = fetch.overfetch;
+
+    if (mesh.positions()) {
+        const meshopt_OverdrawStatistics overdraw = meshopt_analyzeOverdraw(mesh.indices.data(), mesh.indices.size(), mesh.positions(), mesh.vertexCount, mesh.vertexSize);
+        statistics.overdraw = overdraw.overdraw;
+    }
+
+    return statistics;
+}
+
+// merges vertices whose attributes are bitwise identical
+void weldVertices(WorkingMesh& mesh) {
+    std::vector<uint32_t> remap(mesh.vertexCount);
+    const size_t uniqueVertexCount = meshopt_generateVertexRemap(remap.data(), mesh.indices.data(), mesh.indices.size(), mesh.vertices.data(), mesh.vertexCount, mesh.vertexSize);
+
+    std::vector<uint8_t> vertices(uniqueVertexCount * mesh.vertexSize);
+    meshopt_remapVertexBuffer(vertices.data(), mesh.vertices.data(), mesh.vertexCount, mesh.vertexSize, remap.data());
+    meshopt_remapIndexBuffer(mesh.indices.data(), mesh.indices.data(), mesh.indices.size(), remap.data());
+
+    mesh.vertices = std::move(vertices);
+    mesh.vertexCount = static_cast<uint32_t>(uniqueVertexCount);
+}
+
+/*
+Triangles are first ordered for the post transform vertex cache.  The overdraw pass then reorders clusters of triangles
+so that front most geometry tends to be drawn first, as long as the cache efficiency does not get worse than the given
+threshold.  Finally vertices are ordered by first use so that vertex fetch is as linear as possible.
+*/
+void optimize(WorkingMesh& mesh, const ToolOptions& options) {
+    weldVertices(mesh);
+
+    meshopt_optimizeVertexCache(mesh.indices.data(), mesh.indices.data(), mesh.indices.size(), mesh.vertexCount);
+
+    if (mesh.positions()) {
+        meshopt_optimizeOverdraw(mesh.indices.data(), mesh.indices.data(), mesh.indices.size(), mesh.positions(), mesh.vertexCount, mesh.vertexSize, options.overdrawThreshold);
+    }
+
+    std::vector<uint8_t> vertices(mesh.vertices.size());
+    const size_t fetchedVertexCount = meshopt_optimizeVertexFetch(vertices.data(), mesh.indices.data(), mesh.indices.size(), mesh.vertices.data(), mesh.vertexCount, mesh.vertexSize);
+
+    // vertices which are not referenced by any triangle are dropped
+    vertices.resize(fetchedVertexCount * mesh.vertexSize);
+    mesh.vertices = std::move(vertices);
+    mesh.vertexCount = static_cast<uint32_t>(fetchedVertexCount);
+}
+
+// Maps a unit vector onto the octahedron |x| + |y| + |z| = 1 and unfolds the lower half over the upper half.
+// Zero length normals, which degenerate faces often have, are encoded as +Z.
+glm::vec2 encodeOctahedral(glm::vec3 normal) {
+    const float length = std::abs(normal.x) + std::abs(normal.y) + std::abs(normal.z);
+
+    if (length < std::numeric_limits<float>::epsilon()) {
+        return glm::vec2(0.0f);
+    }
+
+    normal /= length;
+
+    glm::vec2 encoded(normal.x, normal.y);
+
+    if (normal.z < 0.0f) {
+        encoded.x = (1.0f - std::abs(normal.y)) * (normal.x >= 0.0f ? 1.0f : -1.0f);
+        encoded.y = (1.0f - std::abs(normal.x)) * (normal.y >= 0.0f ? 1.0f : -1.0f);
+    }
+
+    return encoded;
+}
+
+// recomputes the bounds of the mesh so that every vertex is inside them
+void computeBounds(WorkingMesh& mesh) {
+    const float* positions = mesh.positions();
+
+    if (!positions || isQuantized(mesh)) {
+        return;
+    }
+
+    const size_t stride = mesh.vertexSize / sizeof(float);
+
+    mesh.bounds.min = glm::vec3(std::numeric_limits<float>::max());
+    mesh.bounds.max = glm::vec3(std::numeric_limits<float>::lowest());
+
+    for (uint32_t i = 0; i < mesh.vertexCount; i++) {
+        const float* position = positions + i * stride;
+        mesh.bounds.min = glm::min(mesh.bounds.min, glm::vec3(position[0], position[1], position[2]));
+        mesh.bounds.max = glm::max(mesh.bounds.max, glm::vec3(position[0], position[1], position[2]));
+    }
+}
+
+// repeating texture coordinates cannot be represented as unorm values
+bool texCoordsInUnitRange(const WorkingMesh& mesh) {
+    if (!(mesh.vertexAttributes & vkdev::MeshVertexAttributes::TexCoords) || isQuantized(mesh)) {
+        return false;
+    }
+
+    const size_t stride = mesh.vertexSize / sizeof(float);
+    const float* texCoords = reinterpret_cast<const float*>(mesh.vertices.data()) + stride - 2;
+
+    for (uint32_t i = 0; i < mesh.vertexCount; i++) {
+        const float* texCoord = texCoords + i * stride;
+
+        if (texCoord[0] < 0.0f || texCoord[0] > 1.0f || texCoord[1] < 0.0f || texCoord[1] > 1.0f) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/*
+Converts full precision attributes to their quantized encodings.  Positions are stored relative to the bounds of the
+mesh, so every LOD of a mesh must share the same bounds.  Likewise the texture coordinate encoding is decided by the
+caller so that all LODs use the same vertex format.
+*/
+void quantize(WorkingMesh& mesh, bool quantizeTexCoords) {
+    const uint32_t attributes = mesh.vertexAttributes;
+
+    if (isQuantized(mesh)) {
+        return;
+    }
+
+    const bool hasPositions = attributes & vkdev::MeshVertexAttributes::Positions;
+    const bool hasNormals = attributes & vkdev::MeshVertexAttributes::Normals;
+    const bool hasTexCoords = attributes & vkdev::MeshVertexAttributes::TexCoords;
+    quantizeTexCoords = quantizeTexCoords && hasTexCoords;
+
+    auto sourceVertex = [&mesh](uint32_t index) {
+        return reinterpret_cast<const float*>(mesh.vertices.data() + static_cast<size_t>(index) * mesh.vertexSize);
+    };
+
+    // flat axes are given a nonzero extent to avoid dividing by zero
+    const glm::vec3 extent = glm::max(mesh.bounds.max - mesh.bounds.min, glm::vec3(std::numeric_limits<float>::min()));
+
+    uint32_t quantizedAttributes = attributes;
+    uint32_t quantizedVertexSize = 0;
+
+    if (hasPositions) {
+        quantizedAttributes |= vkdev::MeshVertexAttributes::QuantizedPositions;
+        quantizedVertexSize += 4 * sizeof(uint16_t);
+    }
+
+    if (hasNormals) {
+        quantizedAttributes |= vkdev::MeshVertexAttributes::QuantizedNormals;
+        quantizedVertexSize += 2 * sizeof(int16_t);
+    }
+
+    if (quantizeTexCoords) {
+        quantizedAttributes |= vkdev::MeshVertexAttributes::QuantizedTexCoords;
+        quantizedVertexSize += 2 * sizeof(uint16_t);
+    }
+    else if (hasTexCoords) {
+        quantizedVertexSize += 2 * sizeof(float);
+    }
+
+    std::vector<uint8_t> vertices(static_cast<size_t>(mesh.vertexCount) * quantizedVertexSize);
+
+    for (uint32_t i = 0; i < mesh.vertexCount; i++) {
+        const float* source = sourceVertex(i);
+        uint8_t* destination = vertices.data() + static_cast<size_t>(i) * quantizedVertexSize;
+
+        if (hasPositions) {
+            const glm::vec3 normalized = (glm::vec3(source[0], source[1], source[2]) - mesh.bounds.min) / extent;
+            const uint16_t position[4] = {
+                static_cast<uint16_t>(meshopt_quantizeUnorm(normalized.x, 16)),
+                static_cast<uint16_t>(meshopt_quantizeUnorm(normalized.y, 16)),
+                static_cast<uint16_t>(meshopt_quantizeUnorm(normalized.z, 16)),
+                0
+            };
+
+            std::memcpy(destination, position, sizeof(position));
+            destination += sizeof(position);
+            source += 3;
+        }
+
+        if (hasNormals) {
+            const glm::vec2 encoded = encodeOctahedral(glm::vec3(source[0], source[1], source[2]));
+            const int16_t normal[2] = {
+                static_cast<int16_t>(meshopt_quantizeSnorm(encoded.x, 16)),
+                static_cast<int16_t>(meshopt_quantizeSnorm(encoded.y, 16))
+            };
+
+            std::memcpy(destination, normal, sizeof(normal));
+            destination += sizeof(normal);
+            source += 3;
+        }
+
+        if (quantizeTexCoords) {
+            const uint16_t texCoord[2] = {
+                static_cast<uint16_t>(meshopt_quantizeUnorm(source[0], 16)),
+                static_cast<uint16_t>(meshopt_quantizeUnorm(source[1], 16))
+            };
+
+            std::memcpy(destination, texCoord, sizeof(texCoord));
+        }
+        else if (hasTexCoords) {
+            std::memcpy(destination, source, 2 * sizeof(float));
+        }
+    }
+
+    mesh.vertexAttributes = static_cast<vkdev::MeshVertexAttributes>(quantizedAttributes);
+    mesh.vertexSize = quantizedVertexSize;
+    mesh.vertices = std::move(vertices);
+}
+
+/*
+Builds a chain of progressively simplified index buffers.  Every level is simplified from the full detail mesh rather
+than from the previous level, so that errors do not accumulate across levels.  The simplifier bounds its error relative
+to the extent of the mesh, so the error of each level is recorded in object space as its target error scaled by that
+extent, which is an upper bound on its deviation from the full detail mesh.
+The chain stops early once a level no longer removes a meaningful number of triangles.
+*/
+std::vector<WorkingMesh> buildLodChain(const WorkingMesh& mesh, const ToolOptions& options) {
+    std::vector<WorkingMesh> lods;
+    lods.push_back(mesh);
+
+    if (!mesh.positions() || isQuantized(mesh)) {
+        return lods;
+    }
+
+    const glm::vec3 extent = mesh.bounds.max - mesh.bounds.min;
+    const float meshScale = std::max(extent.x, std::max(extent.y, extent.z));
+
+    float targetError = options.lodError;
+    float targetIndexCount = static_cast<float>(mesh.indices.size());
+    size_t previousIndexCount = mesh.indices.size();
+
+    for (uint32_t level = 1; level < options.lodCount; level++) {
+        targetIndexCount *= options.lodRatio;
+
+        WorkingMesh lod = mesh;
+        lod.indices.resize(meshopt_simplify(lod.indices.data(), mesh.indices.data(), mesh.indices.size(), mesh.positions(), mesh.vertexCount, mesh.vertexSize, static_cast<size_t>(targetIndexCount) / 3 * 3, targetError));
+
+        if (lod.indices.empty() || lod.indices.size() > previousIndexCount * 0.95f) {
+            break;
+        }
+
+        previousIndexCount = lod.indices.size();
+
+        meshopt_optimizeVertexCache(lod.indices.data(), lod.indices.data(), lod.indices.size(), lod.vertexCount);
+
+        // vertices are compacted so that each level only contains the vertices it references
+        std::vector<uint8_t> vertices(lod.vertices.size());
+        lod.vertexCount = static_cast<uint32_t>(meshopt_optimizeVertexFetch(vertices.data(), lod.indices.data(), lod.indices.size(), lod.vertices.data(), lod.vertexCount, lod.vertexSize));
+        vertices.resize(static_cast<size_t>(lod.vertexCount) * lod.vertexSize);
+        lod.vertices = std::move(vertices);
+
+        lod.lodError = targetError * meshScale;
+        lods.push_back(std::move(lod));
+
+        targetError *= 2.0f;
+    }
+
+    return lods;
+}
+
+// converts the 32 bit working indices to the element size of the mesh
+std::vector<uint8_t> packElements(const WorkingMesh& mesh) {
+    std::vector<uint8_t> elements(mesh.indices.size() * mesh.elementSize);
+
+    if (mesh.elementSize == sizeof(uint16_t)) {
+        uint16_t* destination = reinterpret_cast<uint16_t*>(elements.data());
+        for (size_t i = 0; i < mesh.indices.size(); i++) {
+            destination[i] = static_cast<uint16_t>(mesh.indices[i]);
+        }
+    }
+    else {
+        std::memcpy(elements.data(), mesh.indices.data(), elements.size());
+    }
+
+    return elements;
+}
+
+vkdev::MeshData toMeshData(const WorkingMesh& mesh, const std::vector<uint8_t>& elements) {
+    vkdev::MeshData meshData;
+    meshData.vertexAttributes = mesh.vertexAttributes;
+    meshData.vertexData = mesh.vertices.data();
+    meshData.vertexDataSize = static_cast<uint32_t>(mesh.vertices.size());
+    meshData.vertexCount = mesh.vertexCount;
+    meshData.elementData = elements.data();
+    meshData.elementDataSize = static_cast<uint32_t>(elements.size());
+    meshData.elementCount = static_cast<uint32_t>(mesh.indices.size());
+    meshData.elementSize = mesh.elementSize;
+    meshData.bounds = mesh.bounds;
+    meshData.lodError = mesh.lodError;
+
+    return meshData;
+}
+
+/*
+Every level of a mesh is drawn from the same index buffer, so all levels use the element size of the first level.
+0xFFFF is reserved as the primitive restart index so it is never used as a vertex index.
+Only .vkpack files can store more than one level.
+*/
+void writeMesh(std::vector<WorkingMesh>& lods, const ToolOptions& options) {
+    const uint32_t elementSize = lods[0].vertexCount < 65536 ? sizeof(uint16_t) : sizeof(uint32_t);
+
+    for (auto& lod : lods) {
+        lod.elementSize = elementSize;
+    }
+
+    if (hasExtension(options.outputPath, ".vkpack")) {
+        vkdev::MeshPackWriter writer;
+
+        for (size_t i = 0; i < lods.size(); i++) {
+            const std::vector<uint8_t> elements = packElements(lods[i]);
+            writer.addMesh(getStem(options.inputPath), static_cast<uint32_t>(i), lods[i].lodError, toMeshData(lods[i], elements), options.compress);
+        }
+
+        writer.write(options.outputPath);
+    }
+    else {
+        if (lods.size() > 1) {
+            std::cout << "warning: .model files hold a single level of detail, only LOD 0 will be written" << std::endl;
+        }
+
+        const std::vector<uint8_t> elements = packElements(lods[0]);
+        toMeshData(lods[0], elements).writeToFile(options.outputPath);
+    }
+}
+
+void printStatistics(const char* label, const MeshStatistics& statistics) {
+    std::printf("%-8s vertices: %8u triangles: %8u ACMR: %.3f ATVR: %.3f overdraw: %.3f overfetch: %.3f\n",
+        label, statistics.vertexCount, statistics.triangleCount, statistics.acmr, statistics.atvr, statistics.overdraw, statistics.overfetch);
+}
+
+const char* USAGE = "usage: vkdev_meshopt <input.model|input.obj> <output.model|output.vkpack> [--cache-size N] [--overdraw-threshold F] [--no-compress] [--no-quantize] [--lods N] [--lod-ratio F] [--lod-error F]";
+
+// usage: vkdev_meshopt <input.model|input.obj> <output.model|output.vkpack> [--cache-size N] [--overdraw-threshold F] [--no-compress] [--no-quantize] [--lods N] [--lod-ratio F] [--lod-error F]
+int main(int argc, char** argv) {
+    ToolOptions options;
+    std::vector<std::string> paths;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--cache-size") == 0 && i + 1 < argc) {
+            options.cacheSize = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+        }
+        else if (strcmp(argv[i], "--overdraw-threshold") == 0 && i + 1 < argc) {
+            options.overdrawThreshold = static_cast<float>(std::strtod(argv[++i], nullptr));
+        }
+        else if (strcmp(argv[i], "--no-compress") == 0) {
+            options.compress = false;
+        }
+        else if (strcmp(argv[i], "--no-quantize") == 0) {
+            options.quantize = false;
+        }
+        else if (strcmp(argv[i], "--lods") == 0 && i + 1 < argc) {
+            options.lodCount = static_cast<uint32_t>(std::max(1UL, std::strtoul(argv[++i], nullptr, 10)));
+        }
+        else if (strcmp(argv[i], "--lod-ratio") == 0 && i + 1 < argc) {
+            options.lodRatio = static_cast<float>(std::strtod(argv[++i], nullptr));
+        }
+        else if (strcmp(argv[i], "--lod-error") == 0 && i + 1 < argc) {
+            options.lodError = static_cast<float>(std::strtod(argv[++i], nullptr));
+        }
+        else if (argv[i][0] != '-') {
+            paths.push_back(argv[i]);
+        }
+        else {
+            std::cerr << USAGE << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+
+    if (paths.size() != 2) {
+        std::cerr << USAGE << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    options.inputPath = paths[0];
+    options.outputPath = paths[1];
+
+    try {
+        WorkingMesh mesh = hasExtension(options.inputPath, ".obj") ? loadObj(options.inputPath) : loadModel(options.inputPath);
+
+        if (mesh.indices.size() % 3 != 0) {
+            throw std::runtime_error("Element count is not a multiple of 3: " + options.inputPath);
+        }
+
+        printStatistics("before", analyze(mesh, options));
+        optimize(mesh, options);
+        printStatistics("after", analyze(mesh, options));
+
+        computeBounds(mesh);
+        std::vector<WorkingMesh> lods = buildLodChain(mesh, options);
+
+        for (size_t i = 1; i < lods.size(); i++) {
+            const MeshStatistics statistics = analyze(lods[i], options);
+            std::printf("LOD %zu    vertices: %8u triangles: %8u error: %g\n", i, statistics.vertexCount, statistics.triangleCount, lods[i].lodError);
+        }
+
+        // statistics are gathered first since the analysis reads full precision positions
+        if (options.quantize) {
+            const bool quantizeTexCoords = texCoordsInUnitRange(mesh);
+
+            for (auto& lod : lods) {
+                quantize(lod, quantizeTexCoords);
+            }
+        }
+
+        writeMesh(lods, options);
+    }
+    catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
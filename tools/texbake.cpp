@@ -0,0 +1,178 @@
+#include "vkdev/jobsystem.h"
+#include "vkdev/mipchain.h"
+#include "vkdev/texture.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using Clock = std::chrono::high_resolution_clock;
+
+struct ToolOptions {
+    std::vector<std::string> inputPaths;
+    std::string outputDirectory; // empty writes each texture next to its source
+    bool srgb = false;
+    uint32_t threadCount = 0;
+    bool pinThreads = false;
+};
+
+struct BakeItem {
+    std::string inputPath;
+    std::string outputPath;
+    vkdev::TextureData texture;
+    std::exception_ptr error;
+};
+
+std::string getStem(const std::string& path) {
+    const size_t slash = path.find_last_of("/\\");
+    const size_t start = slash == std::string::npos ? 0 : slash + 1;
+    const size_t dot = path.find_last_of('.');
+
+    return path.substr(start, dot == std::string::npos || dot < start ? std::string::npos : dot - start);
+}
+
+std::string getOutputPath(const std::string& inputPath, const std::string& outputDirectory) {
+    if (!outputDirectory.empty()) {
+        return outputDirectory + "/" + getStem(inputPath) + ".ktx2";
+    }
+
+    const size_t slash = inputPath.find_last_of("/\\");
+    const std::string directory = slash == std::string::npos ? std::string() : inputPath.substr(0, slash + 1);
+
+    return directory + getStem(inputPath) + ".ktx2";
+}
+
+// Runs one job per item and returns the wall time.  Items which have already failed are skipped.  Jobs must not throw,
+// so errors are stored on the item.
+template <typename Function>
+double runPhase(vkdev::JobSystem& jobSystem, std::vector<BakeItem>& items, const Function& function) {
+    const auto start = Clock::now();
+    vkdev::JobCounter counter;
+
+    for (auto& item : items) {
+        if (item.error) {
+            continue;
+        }
+
+        jobSystem.run([&item, &function]() {
+            try {
+                function(item);
+            }
+            catch (...) {
+                item.error = std::current_exception();
+            }
+        }, &counter);
+    }
+
+    jobSystem.wait(counter);
+
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+const char* USAGE = "usage: vkdev_texbake <input>... [--output-dir path] [--srgb] [--threads N] [--pin-threads]";
+
+/*
+Bakes images into KTX2 files holding a full mip chain, so that the runtime copies every level straight into the image
+rather than generating them with blits.  Images are loaded, filtered and written in three phases, each running one job
+per image while the rows of each mip level are split across the job system as well.  Images are filtered and stored
+as is unless --srgb is given, which converts color to linear for filtering and tags the output as sRGB.  vulkantest
+renders to a UNORM target without converting from linear, so sRGB output only looks correct in renderers which do.
+usage: vkdev_texbake <input>... [--output-dir path] [--srgb] [--threads N] [--pin-threads]
+*/
+int main(int argc, char** argv) {
+    ToolOptions options;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--output-dir") == 0 && i + 1 < argc) {
+            options.outputDirectory = argv[++i];
+        }
+        else if (strcmp(argv[i], "--srgb") == 0) {
+            options.srgb = true;
+        }
+        else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            options.threadCount = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+        }
+        else if (strcmp(argv[i], "--pin-threads") == 0) {
+            options.pinThreads = true;
+        }
+        else if (argv[i][0] != '-') {
+            options.inputPaths.push_back(argv[i]);
+        }
+        else {
+            std::cerr << USAGE << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+
+    if (options.inputPaths.empty()) {
+        std::cerr << USAGE << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    std::vector<BakeItem> items(options.inputPaths.size());
+    for (size_t i = 0; i < items.size(); i++) {
+        items[i].inputPath = options.inputPaths[i];
+        items[i].outputPath = getOutputPath(options.inputPaths[i], options.outputDirectory);
+    }
+
+    vkdev::JobSystem jobSystem;
+    jobSystem.create(options.threadCount, options.pinThreads);
+    const uint32_t threadCount = jobSystem.getThreadCount();
+
+    const VkFormat format = options.srgb ? VK_FORMAT_R8G8B8A8_SRGB : VK_FORMAT_R8G8B8A8_UNORM;
+
+    const double loadSeconds = runPhase(jobSystem, items, [format](BakeItem& item) {
+        item.texture.loadFromFile(item.inputPath);
+
+        if (item.texture.format != VK_FORMAT_R8G8B8A8_UNORM && item.texture.format != VK_FORMAT_R8G8B8A8_SRGB) {
+            throw std::runtime_error("only RGBA8 images can be baked: " + item.inputPath);
+        }
+
+        // the pixels are unchanged, only how they are interpreted
+        item.texture.format = format;
+    });
+
+    const double bakeSeconds = runPhase(jobSystem, items, [&jobSystem](BakeItem& item) {
+        item.texture.buildMipChain(&jobSystem);
+    });
+
+    const double writeSeconds = runPhase(jobSystem, items, [](BakeItem& item) {
+        item.texture.writeKtx2(item.outputPath);
+    });
+
+    jobSystem.cleanup();
+
+    // throughput counts the source pixels, which are the bulk of the work
+    double sourcePixels = 0.0;
+    int failedCount = 0;
+
+    for (const auto& item : items) {
+        if (item.error) {
+            try {
+                std::rethrow_exception(item.error);
+            }
+            catch (const std::exception& e) {
+                std::cerr << e.what() << std::endl;
+            }
+
+            failedCount++;
+            continue;
+        }
+
+        sourcePixels += static_cast<double>(item.texture.width) * item.texture.height;
+        std::printf("%s -> %s (%ux%u, %zu levels)\n", item.inputPath.c_str(), item.outputPath.c_str(), item.texture.width, item.texture.height, item.texture.levels.size());
+    }
+
+    const double megapixels = sourcePixels / 1000000.0;
+    std::printf("load: %.1f ms  bake: %.1f ms  write: %.1f ms\n", loadSeconds * 1000.0, bakeSeconds * 1000.0, writeSeconds * 1000.0);
+    std::printf("baked %.2f MPixels in %.1f ms on %u thread(s) with %s kernels: %.1f MPixels/s\n", megapixels, bakeSeconds * 1000.0,
+        threadCount, vkdev::MipChain::getSimdName(), bakeSeconds > 0.0 ? megapixels / bakeSeconds : 0.0);
+
+    return failedCount > 0 ? EXIT_FAILURE : EXIT_SUCCESS;
+}